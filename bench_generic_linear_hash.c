@@ -0,0 +1,1323 @@
+/* benchmarks for generic_linear_hash
+ *
+ *  make bench
+ *  make bench BENCHARGS="-q -m ctrl"
+ *
+ * usage: bench_glh [-q] [-m mode] [-d dist] [-n max_elems]
+ *
+ *  -q            quick run, skip the table sizes larger than the LLC
+ *  -m mode       only run one table mode (see `modes` below, typed,
+ *                sharded, resize, snapshot, frozen, mutex, locked or rcu)
+ *  -d dist       only run one key distribution (sequential, uniform, zipfian)
+ *  -n max_elems  cap on the number of elements in the largest table
+ *
+ * for each table mode, key distribution and table size (from L1 resident
+ * up to 10x the last level cache) this measures insert (into a default
+ * sized table and one made with glh_reserve), get (hit and miss),
+ * get_batch, set, resize, iter (over the sparse resized table) and delete
+ *
+ * output is csv on stdout, lines starting with # are comments:
+ *
+ *  mode,op,dist,n,ops,ops_per_sec,p50_ns,p99_ns,p999_ns,dtlb_misses
+ *
+ * ops_per_sec comes from a pass where operations are not individually
+ * timed, the latency percentiles come from a second identical pass
+ * where every operation is timed (so include the timer overhead which
+ * is reported in a comment at the start)
+ *
+ * dtlb_misses counts data tlb load misses during the throughput pass,
+ * this is -1 where perf_event_open is unavailable or not permitted
+ *
+ * the +4k, +thp and +hugetlb modes back large arrays with
+ * glh_mmap_allocator using 4K pages, transparent huge pages or
+ * explicit huge pages respectively
+ *
+ * the typed and generic_ul modes compare a GLH_DECLARE table against
+ * a glh_table both holding unsigned long keys, for these only throughput
+ * of insert and get (hit and miss) is measured and latencies are 0
+ *
+ * the sharded mode spreads keys over SHARDS independent tables
+ * (glh_sharded) and also reports the longest single insert against
+ * a single table, as each shard's resize is only 1/SHARDS the size
+ *
+ * the resize_xN modes time doubling a table of n elements with
+ * glh_resize_parallel using N threads (resize_x1 is plain glh_resize),
+ * ops counts elements moved
+ *
+ * the snapshot mode compares starting up from n keys by inserting them
+ * all (rebuild) against glh_map of a snapshot written by glh_save
+ * followed by one lookup (mapped), and then get throughput of the
+ * mapped table, ops for start is the number of keys made available
+ *
+ * the frozen mode times glh_freeze of a default table of n keys
+ * (ops counts elements placed) and then get (hit and miss) against
+ * the frozen table, a comment reports the bytes of slots before and after
+ *
+ * the mutex_xN, locked_xN and rcu_xN modes run N threads against a
+ * single table, either a glh_table behind one global mutex, a glh_locked
+ * or a glh_rcu (whose lookups take no lock at all), for
+ * read_heavy (95% get, 5% set) and mixed (50% get, 50% set) workloads
+ * with uniform keys, only throughput is measured and latencies are 0
+ *
+ * insert and delete visit every key once, in order for sequential
+ * and in a random order for uniform and zipfian,
+ * the other operations draw keys from the named distribution
+ */
+
+/* for clock_gettime and the sysconf cache sizes */
+#define _GNU_SOURCE
+
+#include <stdio.h> /* printf, sprintf */
+#include <stdlib.h> /* calloc, free, exit, qsort, strtoul */
+#include <string.h> /* strlen, strcmp */
+#include <math.h> /* pow */
+#include <time.h> /* clock_gettime */
+#include <unistd.h> /* sysconf, mkstemp, close, unlink */
+#include <pthread.h> /* pthread_create, pthread_join, pthread_mutex_* */
+
+#ifdef __linux__
+#include <sys/syscall.h> /* syscall, SYS_perf_event_open */
+#include <sys/ioctl.h> /* ioctl */
+#include <linux/perf_event.h> /* perf_event_attr */
+#endif
+
+#include "generic_linear_hash.h"
+#include "generic_linear_hash_template.h"
+#include "generic_linear_hash_mmap.h"
+#include "generic_linear_hash_locked.h"
+#include "generic_linear_hash_rcu.h"
+#include "generic_linear_hash_sharded.h"
+#include "generic_linear_hash_parallel.h"
+#include "generic_linear_hash_snapshot.h"
+#include "generic_linear_hash_frozen.h"
+
+/* length of each generated key, including the null terminator */
+#define KEY_LEN 24
+
+/* number of keys looked up per glh_get_batch call */
+#define BATCH 64
+
+/* operations run by each thread in the mutex_xN, locked_xN and rcu_xN modes */
+#define THREAD_OPS (1000 * 1000)
+
+/* stripes used by the locked_xN modes */
+#define THREAD_STRIPES 256
+
+/* shards used by the sharded mode */
+#define SHARDS 64
+
+/* approximate bytes used per element, slot at 60% load plus key */
+#define BYTES_PER_ELEM 80
+
+/* skew used for the zipfian distribution */
+#define ZIPF_SKEW 0.99
+
+/* table modes we benchmark */
+struct mode {
+    const char *name;
+    unsigned int ctrl;
+    unsigned int pow2;
+    unsigned int robinhood;
+    unsigned int compact;
+    /* use glh_mmap_allocator(pages) rather than the default allocator */
+    unsigned int mmap;
+    enum glh_mmap_mode pages;
+};
+
+static const struct mode modes[] = {
+    {"linear",            0, 0, 0, 0, 0, glh_MMAP_PAGES},
+    {"ctrl",              1, 0, 0, 0, 0, glh_MMAP_PAGES},
+    {"pow2",              0, 1, 0, 0, 0, glh_MMAP_PAGES},
+    {"ctrl+pow2",         1, 1, 0, 0, 0, glh_MMAP_PAGES},
+    {"robinhood",         0, 1, 1, 0, 0, glh_MMAP_PAGES},
+    {"compact+pow2",      0, 1, 0, 1, 0, glh_MMAP_PAGES},
+    {"ctrl+pow2+4k",      1, 1, 0, 0, 1, glh_MMAP_PAGES},
+    {"ctrl+pow2+thp",     1, 1, 0, 0, 1, glh_MMAP_THP},
+    {"ctrl+pow2+hugetlb", 1, 1, 0, 0, 1, glh_MMAP_HUGETLB},
+};
+
+/* key distributions we benchmark */
+enum dist {
+    DIST_SEQUENTIAL,
+    DIST_UNIFORM,
+    DIST_ZIPFIAN
+};
+
+static const char *dist_names[] = {"sequential", "uniform", "zipfian"};
+
+static unsigned long int hash_func(const void *key_void){
+    const char *key = key_void;
+    /* our hash value */
+    unsigned long int hash = 0;
+    /* our iterator through the key */
+    size_t i = 0;
+    size_t key_len = strlen(key);
+
+    /* djb2, same as our tests and example */
+    for( i=0; i < key_len; ++i ){
+        hash = ((hash << 5) + hash) + key[i];
+    }
+
+    return hash;
+}
+
+static unsigned int equal_func(const void *a, const void *b){
+    return strcmp(a, b);
+}
+
+static unsigned long int ul_hash(unsigned long int key){
+    return key;
+}
+
+#define ul_eq(a, b) ((a) != (b))
+
+GLH_DECLARE(ul_table, unsigned long int, unsigned long int, ul_hash, ul_eq);
+
+/* the same for a glh_table where keys point to unsigned longs */
+static unsigned long int ul_hash_func(const void *key){
+    return *(const unsigned long int *) key;
+}
+
+static unsigned int ul_equal_func(const void *a, const void *b){
+    return *(const unsigned long int *) a != *(const unsigned long int *) b;
+}
+
+/* file descriptor counting data tlb misses, -1 if unavailable */
+static int dtlb_fd = -1;
+
+static void dtlb_open(void){
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB
+                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    dtlb_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+/* data tlb misses so far, or -1 if unavailable */
+static long long dtlb_read(void){
+    long long count = 0;
+
+    if( dtlb_fd < 0 || read(dtlb_fd, &count, sizeof(count)) != sizeof(count) ){
+        return -1;
+    }
+
+    return count;
+}
+
+/* data tlb misses since an earlier dtlb_read, or -1 if unavailable */
+static long long dtlb_since(long long start){
+    if( start < 0 ){
+        return -1;
+    }
+
+    return dtlb_read() - start;
+}
+
+/* current time in nanoseconds */
+static double now_ns(void){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* xorshift64* so that runs are repeatable */
+static unsigned long long rng_state = 88172645463325252ULL;
+
+static unsigned long long rng(void){
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+static void * xcalloc(size_t n, size_t size){
+    void *p = calloc(n, size);
+
+    if( ! p ){
+        puts("xcalloc: calloc failed");
+        exit(1);
+    }
+
+    return p;
+}
+
+/* generate n keys with the given prefix
+ * these are stored contiguously in KEY_LEN sized chunks
+ */
+static char * make_keys(const char *prefix, size_t n){
+    char *keys = 0;
+    size_t i = 0;
+
+    keys = xcalloc(n, KEY_LEN);
+
+    for( i=0; i < n; ++i ){
+        sprintf(&keys[i * KEY_LEN], "%s%lu", prefix, (unsigned long) i);
+    }
+
+    return keys;
+}
+
+/* fill order[0..n) with a random permutation of 0..n */
+static void shuffle(size_t *order, size_t n){
+    size_t i = 0;
+    size_t j = 0;
+    size_t tmp = 0;
+
+    for( i=0; i < n; ++i ){
+        order[i] = i;
+    }
+
+    for( i=n; i > 1; --i ){
+        j = rng() % i;
+        tmp = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = tmp;
+    }
+}
+
+/* fill order[0..n) with indices into 0..n drawn from dist */
+static void draw(size_t *order, size_t n, enum dist dist){
+    /* cumulative zipf probabilities */
+    double *cdf = 0;
+    /* maps zipf rank to key so hot keys are spread about */
+    size_t *rank = 0;
+    double total = 0;
+    double u = 0;
+    size_t i = 0;
+    size_t lo = 0;
+    size_t hi = 0;
+    size_t mid = 0;
+
+    switch( dist ){
+        case DIST_SEQUENTIAL:
+            for( i=0; i < n; ++i ){
+                order[i] = i;
+            }
+            break;
+
+        case DIST_UNIFORM:
+            for( i=0; i < n; ++i ){
+                order[i] = rng() % n;
+            }
+            break;
+
+        case DIST_ZIPFIAN:
+            cdf = xcalloc(n, sizeof(double));
+            rank = xcalloc(n, sizeof(size_t));
+            shuffle(rank, n);
+
+            for( i=0; i < n; ++i ){
+                total += 1.0 / pow(i + 1, ZIPF_SKEW);
+                cdf[i] = total;
+            }
+
+            for( i=0; i < n; ++i ){
+                u = (rng() >> 11) * (1.0 / 9007199254740992.0) * total;
+
+                /* first cdf entry >= u */
+                lo = 0;
+                hi = n - 1;
+                while( lo < hi ){
+                    mid = lo + (hi - lo) / 2;
+                    if( cdf[mid] < u ){
+                        lo = mid + 1;
+                    } else {
+                        hi = mid;
+                    }
+                }
+
+                order[i] = rank[lo];
+            }
+
+            free(cdf);
+            free(rank);
+            break;
+    }
+}
+
+static int cmp_latency(const void *a, const void *b){
+    float x = *(const float *) a;
+    float y = *(const float *) b;
+
+    return (x > y) - (x < y);
+}
+
+/* print a result line
+ * sorts latencies in place to find the percentiles
+ */
+static void report(const char *mode, const char *op, enum dist dist, size_t n,
+                   size_t ops, double elapsed_ns, float *latencies, size_t n_latencies,
+                   long long dtlb){
+    double p50 = 0;
+    double p99 = 0;
+    double p999 = 0;
+
+    if( n_latencies ){
+        qsort(latencies, n_latencies, sizeof(float), cmp_latency);
+        p50  = latencies[(size_t) (n_latencies * 0.5)];
+        p99  = latencies[(size_t) (n_latencies * 0.99)];
+        p999 = latencies[(size_t) (n_latencies * 0.999)];
+    }
+
+    printf("%s,%s,%s,%lu,%lu,%.0f,%.1f,%.1f,%.1f,%lld\n",
+           mode, op, dist_names[dist], (unsigned long) n, (unsigned long) ops,
+           ops / (elapsed_ns / 1e9), p50, p99, p999, dtlb);
+    fflush(stdout);
+}
+
+static struct glh_table * make_table(const struct mode *mode){
+    struct glh_table *table = 0;
+
+    table = glh_new_with_allocator(hash_func, equal_func, mode->mmap ? glh_mmap_allocator(mode->pages) : 0);
+    if( ! table
+        || ! glh_tune_ctrl(table, mode->ctrl)
+        || ! glh_tune_pow2(table, mode->pow2)
+        || ! glh_tune_robinhood(table, mode->robinhood)
+        || ! glh_tune_compact(table, mode->compact) ){
+        puts("make_table: failed to create table");
+        exit(1);
+    }
+
+    return table;
+}
+
+/* run every operation for one mode, distribution and size */
+static void bench(const struct mode *mode, enum dist dist, size_t n){
+    /* table used for throughput, operations are not timed individually */
+    struct glh_table *fast = 0;
+    /* table used for latency, every operation is timed */
+    struct glh_table *timed = 0;
+    /* table reserved up front, rebuilt for throughput and latency */
+    struct glh_table *reserved = 0;
+    char *keys = 0;
+    char *misses = 0;
+    /* order keys are inserted and deleted in */
+    size_t *once = 0;
+    /* order keys are read in */
+    size_t *reads = 0;
+    float *latencies = 0;
+    const char *batch_keys[BATCH];
+    void *batch_out[BATCH];
+    size_t i = 0;
+    size_t j = 0;
+    double start = 0;
+    double op_start = 0;
+    double elapsed = 0;
+    /* data tlb misses */
+    long long tlb = 0;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found = 0;
+    struct glh_iter it;
+    void *data = 0;
+
+    keys = make_keys("key ", n);
+    misses = make_keys("miss ", n);
+    once = xcalloc(n, sizeof(size_t));
+    reads = xcalloc(n, sizeof(size_t));
+    latencies = xcalloc(n, sizeof(float));
+
+    if( dist == DIST_SEQUENTIAL ){
+        draw(once, n, DIST_SEQUENTIAL);
+    } else {
+        shuffle(once, n);
+    }
+    draw(reads, n, dist);
+
+    fast = make_table(mode);
+    timed = make_table(mode);
+
+    /* insert */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        glh_insert(fast, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        glh_insert(timed, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+        latencies[i] = now_ns() - op_start;
+    }
+    report(mode->name, "insert", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* insert into tables already reserved for n elements */
+    reserved = make_table(mode);
+    if( ! glh_reserve(reserved, n) ){
+        puts("bench: failed to reserve table");
+        exit(1);
+    }
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        glh_insert(reserved, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    glh_destroy(reserved, 1, 0);
+    reserved = make_table(mode);
+    if( ! glh_reserve(reserved, n) ){
+        puts("bench: failed to reserve table");
+        exit(1);
+    }
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        glh_insert(reserved, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+        latencies[i] = now_ns() - op_start;
+    }
+    glh_destroy(reserved, 1, 0);
+    report(mode->name, "insert_reserved", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* get hit */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(fast, &keys[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        found += glh_get(timed, &keys[reads[i] * KEY_LEN]) != 0;
+        latencies[i] = now_ns() - op_start;
+    }
+    report(mode->name, "get_hit", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* get miss */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(fast, &misses[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        found += glh_get(timed, &misses[reads[i] * KEY_LEN]) != 0;
+        latencies[i] = now_ns() - op_start;
+    }
+    report(mode->name, "get_miss", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* get_batch, latency is per key averaged over each batch */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i + BATCH <= n; i += BATCH ){
+        for( j=0; j < BATCH; ++j ){
+            batch_keys[j] = &keys[reads[i + j] * KEY_LEN];
+        }
+        found += glh_get_batch(fast, batch_keys, BATCH, batch_out);
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i + BATCH <= n; i += BATCH ){
+        for( j=0; j < BATCH; ++j ){
+            batch_keys[j] = &keys[reads[i + j] * KEY_LEN];
+        }
+        op_start = now_ns();
+        found += glh_get_batch(timed, batch_keys, BATCH, batch_out);
+        latencies[i / BATCH] = (now_ns() - op_start) / BATCH;
+    }
+    report(mode->name, "get_batch", dist, n, i, elapsed, latencies, i / BATCH, tlb);
+
+    /* set */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        glh_set(fast, &keys[reads[i] * KEY_LEN], &keys[i * KEY_LEN]);
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        glh_set(timed, &keys[reads[i] * KEY_LEN], &keys[i * KEY_LEN]);
+        latencies[i] = now_ns() - op_start;
+    }
+    report(mode->name, "set", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* resize, a single doubling of the full table */
+    tlb = dtlb_read();
+    start = now_ns();
+    glh_resize(fast, fast->size * 2);
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    latencies[0] = elapsed;
+    report(mode->name, "resize", dist, n, 1, elapsed, latencies, 1, tlb);
+    glh_resize(timed, timed->size * 2);
+
+    /* iter, a single walk of the now sparse table */
+    tlb = dtlb_read();
+    start = now_ns();
+    glh_iter_init(&it, fast);
+    for( i=0; glh_iter_next(&it, 0, &data); ++i ){
+        found += data != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    latencies[0] = elapsed;
+    report(mode->name, "iter", dist, n, i, elapsed, latencies, 1, tlb);
+
+    /* delete */
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_delete(fast, &keys[once[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        found += glh_delete(timed, &keys[once[i] * KEY_LEN]) != 0;
+        latencies[i] = now_ns() - op_start;
+    }
+    report(mode->name, "delete", dist, n, n, elapsed, latencies, n, tlb);
+
+    /* every hit, batched hit, iterated element and delete should have succeeded */
+    if( found != 2 * (n + n + (n / BATCH) * BATCH) + n ){
+        printf("bench: expected %lu hits but saw %lu\n", (unsigned long) (2 * (n + n + (n / BATCH) * BATCH) + n), (unsigned long) found);
+        exit(1);
+    }
+
+    glh_destroy(fast, 1, 0);
+    glh_destroy(timed, 1, 0);
+    free(keys);
+    free(misses);
+    free(once);
+    free(reads);
+    free(latencies);
+}
+
+/* compare a typed GLH_DECLARE table against a glh_table
+ * with n random unsigned long keys
+ */
+static void bench_typed(size_t n){
+    struct ul_table *typed = 0;
+    struct glh_table *generic = 0;
+    unsigned long int *keys = 0;
+    unsigned long int *misses = 0;
+    size_t *reads = 0;
+    size_t i = 0;
+    unsigned long int value = 0;
+    double start = 0;
+    /* data tlb misses */
+    long long tlb = 0;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found = 0;
+
+    keys = xcalloc(n, sizeof(unsigned long int));
+    misses = xcalloc(n, sizeof(unsigned long int));
+    reads = xcalloc(n, sizeof(size_t));
+
+    /* odd keys are present and even keys are misses */
+    for( i=0; i < n; ++i ){
+        keys[i] = rng() | 1;
+        misses[i] = rng() & ~1UL;
+    }
+    draw(reads, n, DIST_UNIFORM);
+
+    typed = ul_table_new();
+    generic = glh_new(ul_hash_func, ul_equal_func);
+    if( ! typed || ! generic || ! glh_tune_pow2(generic, 1) || ! glh_tune_backshift(generic, 1) ){
+        puts("bench_typed: failed to create tables");
+        exit(1);
+    }
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        ul_table_insert(typed, keys[i], i);
+    }
+    report("typed", "insert", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        glh_insert(generic, (const char *) &keys[i], &keys[i]);
+    }
+    report("generic_ul", "insert", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += ul_table_get(typed, keys[reads[i]], &value);
+    }
+    report("typed", "get_hit", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(generic, (const char *) &keys[reads[i]]) != 0;
+    }
+    report("generic_ul", "get_hit", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += ul_table_get(typed, misses[reads[i]], &value);
+    }
+    report("typed", "get_miss", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(generic, (const char *) &misses[reads[i]]) != 0;
+    }
+    report("generic_ul", "get_miss", DIST_UNIFORM, n, n, now_ns() - start, 0, 0, dtlb_since(tlb));
+
+    /* random keys may repeat, so only check we found something */
+    if( ! found ){
+        puts("bench_typed: no keys were found");
+        exit(1);
+    }
+
+    ul_table_destroy(typed, 1);
+    glh_destroy(generic, 1, 0);
+    free(keys);
+    free(misses);
+    free(reads);
+}
+
+/* compare a glh_sharded against a single glh_table,
+ * mostly for the longest insert (a resize) each one sees
+ */
+static void bench_sharded(size_t n){
+    struct glh_sharded *fast = 0;
+    struct glh_sharded *timed = 0;
+    struct glh_table *single = 0;
+    char *keys = 0;
+    /* order keys are inserted in */
+    size_t *once = 0;
+    /* order keys are read in */
+    size_t *reads = 0;
+    float *latencies = 0;
+    size_t i = 0;
+    double start = 0;
+    double op_start = 0;
+    double elapsed = 0;
+    /* longest single insert into single and into timed */
+    double single_max = 0;
+    double sharded_max = 0;
+    /* data tlb misses */
+    long long tlb = 0;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found = 0;
+
+    keys = make_keys("key ", n);
+    once = xcalloc(n, sizeof(size_t));
+    reads = xcalloc(n, sizeof(size_t));
+    latencies = xcalloc(n, sizeof(float));
+    shuffle(once, n);
+    draw(reads, n, DIST_UNIFORM);
+
+    fast = glh_sharded_new(SHARDS, hash_func, equal_func);
+    timed = glh_sharded_new(SHARDS, hash_func, equal_func);
+    single = glh_new(hash_func, equal_func);
+    if( ! fast || ! timed || ! single ){
+        puts("bench_sharded: failed to create tables");
+        exit(1);
+    }
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        glh_sharded_insert(fast, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        glh_sharded_insert(timed, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+        latencies[i] = now_ns() - op_start;
+        if( latencies[i] > sharded_max ){
+            sharded_max = latencies[i];
+        }
+    }
+    report("sharded", "insert", DIST_UNIFORM, n, n, elapsed, latencies, n, tlb);
+
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        glh_insert(single, &keys[once[i] * KEY_LEN], &keys[once[i] * KEY_LEN]);
+        op_start = now_ns() - op_start;
+        if( op_start > single_max ){
+            single_max = op_start;
+        }
+    }
+    printf("# longest insert of %lu: single table %.0f ns, %d shards %.0f ns\n",
+           (unsigned long) n, single_max, SHARDS, sharded_max);
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_sharded_get(fast, &keys[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    for( i=0; i < n; ++i ){
+        op_start = now_ns();
+        found += glh_sharded_get(timed, &keys[reads[i] * KEY_LEN]) != 0;
+        latencies[i] = now_ns() - op_start;
+    }
+    report("sharded", "get_hit", DIST_UNIFORM, n, n, elapsed, latencies, n, tlb);
+
+    /* every read was of a key we inserted */
+    if( found != 2 * n ){
+        printf("bench_sharded: expected %lu hits but saw %lu\n", (unsigned long) (2 * n), (unsigned long) found);
+        exit(1);
+    }
+
+    glh_sharded_destroy(fast, 0);
+    glh_sharded_destroy(timed, 0);
+    glh_destroy(single, 1, 0);
+    free(keys);
+    free(once);
+    free(reads);
+    free(latencies);
+}
+
+/* time doubling a table of n keys with n_threads threads */
+static void bench_resize_mode(size_t n_threads, size_t n){
+    struct glh_table *table = 0;
+    char *keys = 0;
+    char name[32];
+    size_t i = 0;
+    double start = 0;
+    double elapsed = 0;
+
+    keys = make_keys("key ", n);
+
+    table = glh_new(hash_func, equal_func);
+    if( ! table || ! glh_tune_ctrl(table, 1) || ! glh_tune_pow2(table, 1) ){
+        puts("bench_resize_mode: failed to create table");
+        exit(1);
+    }
+    for( i=0; i < n; ++i ){
+        glh_insert(table, &keys[i * KEY_LEN], &keys[i * KEY_LEN]);
+    }
+
+    start = now_ns();
+    if( ! glh_resize_parallel(table, table->size * 2, n_threads) ){
+        puts("bench_resize_mode: failed to resize table");
+        exit(1);
+    }
+    elapsed = now_ns() - start;
+
+    sprintf(name, "resize_x%lu", (unsigned long) n_threads);
+    report(name, "resize", DIST_SEQUENTIAL, n, n, elapsed, 0, 0, -1);
+
+    glh_destroy(table, 1, 0);
+    free(keys);
+}
+
+/* scale the resize_xN modes from 1 thread up to one per cpu */
+static void bench_resize(size_t n){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t t = 0;
+
+    if( cpus < 1 ){
+        cpus = 1;
+    }
+
+    for( t=1; t < (size_t) cpus; t *= 2 ){
+        bench_resize_mode(t, n);
+    }
+    bench_resize_mode(cpus, n);
+
+    /* with one cpu this is only the cost of splitting the work */
+    if( cpus == 1 ){
+        bench_resize_mode(4, n);
+    }
+}
+
+/* start up with n keys by rebuilding the table and by mapping a snapshot */
+static void bench_snapshot(size_t n){
+    struct glh_table *table = 0;
+    struct glh_table *mapped = 0;
+    char path[] = "/tmp/bench_glh_snapshot_XXXXXX";
+    int fd = -1;
+    char *keys = 0;
+    /* order keys are read in */
+    size_t *reads = 0;
+    size_t i = 0;
+    double start = 0;
+    double elapsed = 0;
+    long long tlb = 0;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found = 0;
+
+    keys = make_keys("key ", n);
+    reads = xcalloc(n, sizeof(size_t));
+    draw(reads, n, DIST_UNIFORM);
+
+    start = now_ns();
+    table = glh_new(hash_func, equal_func);
+    for( i=0; table && i < n; ++i ){
+        glh_insert(table, &keys[i * KEY_LEN], (void *) (i + 1));
+    }
+    elapsed = now_ns() - start;
+    if( ! table ){
+        puts("bench_snapshot: failed to create table");
+        exit(1);
+    }
+    report("rebuild", "start", DIST_SEQUENTIAL, n, n, elapsed, 0, 0, -1);
+
+    fd = mkstemp(path);
+    if( fd < 0 || ! glh_save(table, fd) ){
+        puts("bench_snapshot: failed to save table");
+        exit(1);
+    }
+    close(fd);
+
+    start = now_ns();
+    mapped = glh_map(path, hash_func, equal_func);
+    found += mapped && glh_get(mapped, &keys[reads[0] * KEY_LEN]);
+    elapsed = now_ns() - start;
+    if( ! mapped ){
+        puts("bench_snapshot: failed to map snapshot");
+        exit(1);
+    }
+    report("mapped", "start", DIST_SEQUENTIAL, n, n, elapsed, 0, 0, -1);
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(mapped, &keys[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    report("mapped", "get_hit", DIST_UNIFORM, n, n, elapsed, 0, 0, tlb);
+
+    if( found != n + 1 ){
+        printf("bench_snapshot: expected %lu hits but saw %lu\n", (unsigned long) (n + 1), (unsigned long) found);
+        exit(1);
+    }
+
+    glh_destroy(mapped, 1, 0);
+    glh_destroy(table, 1, 0);
+    unlink(path);
+    free(keys);
+    free(reads);
+}
+
+/* freeze a table of n keys and time lookups against it */
+static void bench_frozen(size_t n){
+    struct glh_table *table = 0;
+    char *keys = 0;
+    char *misses = 0;
+    /* order keys are read in */
+    size_t *reads = 0;
+    size_t i = 0;
+    double start = 0;
+    double elapsed = 0;
+    long long tlb = 0;
+    /* bytes of entries before freezing */
+    size_t before = 0;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found = 0;
+
+    keys = make_keys("key ", n);
+    misses = make_keys("miss ", n);
+    reads = xcalloc(n, sizeof(size_t));
+    draw(reads, n, DIST_UNIFORM);
+
+    table = glh_new(hash_func, equal_func);
+    if( ! table ){
+        puts("bench_frozen: failed to create table");
+        exit(1);
+    }
+    for( i=0; i < n; ++i ){
+        glh_insert(table, &keys[i * KEY_LEN], &keys[i * KEY_LEN]);
+    }
+    before = table->size * sizeof(struct glh_entry);
+
+    start = now_ns();
+    if( ! glh_freeze(table) ){
+        puts("bench_frozen: failed to freeze table");
+        exit(1);
+    }
+    elapsed = now_ns() - start;
+    report("frozen", "freeze", DIST_SEQUENTIAL, n, n, elapsed, 0, 0, -1);
+    printf("# slots of %lu: %lu bytes before glh_freeze, %lu bytes after\n",
+           (unsigned long) n, (unsigned long) before,
+           (unsigned long) (table->size * sizeof(struct glh_entry) + table->n_seeds * sizeof(uint32_t)));
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(table, &keys[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    report("frozen", "get_hit", DIST_UNIFORM, n, n, elapsed, 0, 0, tlb);
+
+    tlb = dtlb_read();
+    start = now_ns();
+    for( i=0; i < n; ++i ){
+        found += glh_get(table, &misses[reads[i] * KEY_LEN]) != 0;
+    }
+    elapsed = now_ns() - start;
+    tlb = dtlb_since(tlb);
+    report("frozen", "get_miss", DIST_UNIFORM, n, n, elapsed, 0, 0, tlb);
+
+    if( found != n ){
+        printf("bench_frozen: expected %lu hits but saw %lu\n", (unsigned long) n, (unsigned long) found);
+        exit(1);
+    }
+
+    glh_destroy(table, 1, 0);
+    free(keys);
+    free(misses);
+    free(reads);
+}
+
+/* the ways bench_thread_mode can share a table between threads */
+enum thread_kind {
+    THREAD_MUTEX,
+    THREAD_LOCKED,
+    THREAD_RCU
+};
+
+static const char *thread_kind_names[] = {"mutex", "locked", "rcu"};
+
+/* lookups between each glh_rcu_quiescent in the rcu_xN modes */
+#define RCU_QUIESCENT_OPS 64
+
+/* one thread of the mutex_xN, locked_xN or rcu_xN modes */
+struct worker {
+    /* exactly one of locked, rcu or table is set */
+    struct glh_locked *locked;
+    struct glh_rcu *rcu;
+    struct glh_table *table;
+    /* protects table */
+    pthread_mutex_t *mutex;
+    const char *keys;
+    size_t n;
+    /* percentage of operations which are a set */
+    unsigned int write_pct;
+    /* per thread rng, rng() is not thread safe */
+    unsigned long long seed;
+    /* sink so the compiler cannot drop our lookups */
+    size_t found;
+};
+
+static void * work(void *arg){
+    struct worker *w = arg;
+    struct glh_rcu_reader *reader = 0;
+    const char *key = 0;
+    size_t i = 0;
+    unsigned int write = 0;
+
+    if( w->rcu ){
+        reader = glh_rcu_reader_register(w->rcu);
+        if( ! reader ){
+            puts("work: failed to register reader");
+            exit(1);
+        }
+    }
+
+    for( i=0; i < THREAD_OPS; ++i ){
+        /* xorshift64* as with rng() */
+        w->seed ^= w->seed >> 12;
+        w->seed ^= w->seed << 25;
+        w->seed ^= w->seed >> 27;
+
+        key = &w->keys[((w->seed * 2685821657736338717ULL) >> 16) % w->n * KEY_LEN];
+        write = (w->seed >> 8) % 100 < w->write_pct;
+
+        if( w->locked ){
+            if( write ){
+                w->found += glh_locked_set(w->locked, key, (void *) key) != 0;
+            } else {
+                w->found += glh_locked_get(w->locked, key) != 0;
+            }
+            continue;
+        }
+
+        if( w->rcu ){
+            if( write ){
+                w->found += glh_rcu_set(w->rcu, key, (void *) key) != 0;
+            } else {
+                w->found += glh_rcu_get(w->rcu, key) != 0;
+            }
+            if( i % RCU_QUIESCENT_OPS == 0 ){
+                glh_rcu_quiescent(w->rcu, reader);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(w->mutex);
+        if( write ){
+            w->found += glh_set(w->table, key, (void *) key) != 0;
+        } else {
+            w->found += glh_get(w->table, key) != 0;
+        }
+        pthread_mutex_unlock(w->mutex);
+    }
+
+    if( reader ){
+        glh_rcu_reader_unregister(w->rcu, reader);
+    }
+
+    return 0;
+}
+
+/* run n_threads threads over a table of n keys shared as kind */
+static void bench_thread_mode(enum thread_kind kind, unsigned int write_pct, size_t n_threads, size_t n){
+    struct glh_locked *striped = 0;
+    struct glh_rcu *rcu = 0;
+    struct glh_table *table = 0;
+    pthread_mutex_t mutex;
+    pthread_t *threads = 0;
+    struct worker *workers = 0;
+    char *keys = 0;
+    char name[32];
+    size_t found = 0;
+    size_t i = 0;
+    double start = 0;
+
+    keys = make_keys("key ", n);
+    threads = xcalloc(n_threads, sizeof(pthread_t));
+    workers = xcalloc(n_threads, sizeof(struct worker));
+    pthread_mutex_init(&mutex, 0);
+
+    if( kind == THREAD_LOCKED ){
+        striped = glh_locked_new(THREAD_STRIPES, hash_func, equal_func);
+        if( ! striped ){
+            puts("bench_thread_mode: failed to create table");
+            exit(1);
+        }
+        for( i=0; i < n; ++i ){
+            glh_locked_insert(striped, &keys[i * KEY_LEN], &keys[i * KEY_LEN]);
+        }
+    } else if( kind == THREAD_RCU ){
+        rcu = glh_rcu_new(hash_func, equal_func);
+        if( ! rcu ){
+            puts("bench_thread_mode: failed to create table");
+            exit(1);
+        }
+        for( i=0; i < n; ++i ){
+            glh_rcu_insert(rcu, &keys[i * KEY_LEN], &keys[i * KEY_LEN]);
+        }
+    } else {
+        table = glh_new(hash_func, equal_func);
+        if( ! table ){
+            puts("bench_thread_mode: failed to create table");
+            exit(1);
+        }
+        for( i=0; i < n; ++i ){
+            glh_insert(table, &keys[i * KEY_LEN], &keys[i * KEY_LEN]);
+        }
+    }
+
+    for( i=0; i < n_threads; ++i ){
+        workers[i].locked = striped;
+        workers[i].rcu = rcu;
+        workers[i].table = table;
+        workers[i].mutex = &mutex;
+        workers[i].keys = keys;
+        workers[i].n = n;
+        workers[i].write_pct = write_pct;
+        workers[i].seed = rng() | 1;
+        workers[i].found = 0;
+    }
+
+    start = now_ns();
+    for( i=0; i < n_threads; ++i ){
+        if( pthread_create(&threads[i], 0, work, &workers[i]) ){
+            puts("bench_thread_mode: failed to create thread");
+            exit(1);
+        }
+    }
+    for( i=0; i < n_threads; ++i ){
+        pthread_join(threads[i], 0);
+        found += workers[i].found;
+    }
+
+    sprintf(name, "%s_x%lu", thread_kind_names[kind], (unsigned long) n_threads);
+    report(name, write_pct < 50 ? "read_heavy" : "mixed", DIST_UNIFORM, n,
+           n_threads * THREAD_OPS, now_ns() - start, 0, 0, -1);
+
+    /* every key was present throughout */
+    if( found != n_threads * THREAD_OPS ){
+        printf("bench_thread_mode: expected %lu hits but saw %lu\n", (unsigned long) (n_threads * THREAD_OPS), (unsigned long) found);
+        exit(1);
+    }
+
+    if( striped ){
+        glh_locked_destroy(striped, 0);
+    } else if( rcu ){
+        glh_rcu_destroy(rcu, 0);
+    } else {
+        glh_destroy(table, 1, 0);
+    }
+    pthread_mutex_destroy(&mutex);
+    free(threads);
+    free(workers);
+    free(keys);
+}
+
+/* scale the mutex_xN, locked_xN and rcu_xN modes from 1 thread up to one per cpu
+ * only_mode of "mutex", "locked" or "rcu" selects just that one
+ */
+static void bench_threads(size_t n, const char *only_mode){
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int write_pcts[] = {5, 50};
+    size_t w = 0;
+    size_t t = 0;
+    unsigned int kind = 0;
+
+    if( cpus < 1 ){
+        cpus = 1;
+    }
+
+    for( w=0; w < sizeof(write_pcts) / sizeof(write_pcts[0]); ++w ){
+        for( kind=THREAD_MUTEX; kind <= THREAD_RCU; ++kind ){
+            if( only_mode && strcmp(only_mode, thread_kind_names[kind]) ){
+                continue;
+            }
+
+            /* powers of two and then every cpu */
+            for( t=1; t < (size_t) cpus; t *= 2 ){
+                bench_thread_mode(kind, write_pcts[w], t, n);
+            }
+            bench_thread_mode(kind, write_pcts[w], cpus, n);
+        }
+    }
+}
+
+/* size of a cache level in bytes, or fallback if we cannot tell */
+static size_t cache_size(int name, size_t fallback){
+    long size = -1;
+
+    if( name >= 0 ){
+        size = sysconf(name);
+    }
+
+    if( size <= 0 ){
+        return fallback;
+    }
+
+    return size;
+}
+
+int main(int argc, char **argv){
+    /* table sizes in elements */
+    size_t sizes[4];
+    const char *size_names[] = {"L1", "L2", "LLC", "10xLLC"};
+    size_t n_sizes = 4;
+    size_t max_elems = 8 * 1000 * 1000;
+    const char *only_mode = 0;
+    const char *only_dist = 0;
+    size_t l1 = 0;
+    size_t l2 = 0;
+    size_t llc = 0;
+    size_t i = 0;
+    size_t m = 0;
+    size_t d = 0;
+    double start = 0;
+    double overhead = 0;
+
+    for( i=1; i < (size_t) argc; ++i ){
+        if( ! strcmp(argv[i], "-q") ){
+            n_sizes = 3;
+        } else if( ! strcmp(argv[i], "-m") && i + 1 < (size_t) argc ){
+            only_mode = argv[++i];
+        } else if( ! strcmp(argv[i], "-d") && i + 1 < (size_t) argc ){
+            only_dist = argv[++i];
+        } else if( ! strcmp(argv[i], "-n") && i + 1 < (size_t) argc ){
+            max_elems = strtoul(argv[++i], 0, 10);
+        } else {
+            printf("usage: %s [-q] [-m mode] [-d dist] [-n max_elems]\n", argv[0]);
+            return 1;
+        }
+    }
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    l1  = cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    l2  = cache_size(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+    llc = cache_size(_SC_LEVEL3_CACHE_SIZE, 8 * 1024 * 1024);
+#else
+    l1  = cache_size(-1, 32 * 1024);
+    l2  = cache_size(-1, 1024 * 1024);
+    llc = cache_size(-1, 8 * 1024 * 1024);
+#endif
+
+    /* half of each cache so the table stays resident, then well beyond */
+    sizes[0] = l1 / 2 / BYTES_PER_ELEM;
+    sizes[1] = l2 / 2 / BYTES_PER_ELEM;
+    sizes[2] = llc / 2 / BYTES_PER_ELEM;
+    sizes[3] = llc * 10 / BYTES_PER_ELEM;
+
+    /* estimate the cost of timing a single operation */
+    start = now_ns();
+    for( i=0; i < 1000000; ++i ){
+        now_ns();
+    }
+    overhead = (now_ns() - start) / 1000000;
+
+    printf("# l1 %lu bytes, l2 %lu bytes, llc %lu bytes\n", (unsigned long) l1, (unsigned long) l2, (unsigned long) llc);
+    printf("# timer overhead %.1f ns per operation\n", overhead);
+    dtlb_open();
+
+    printf("# dtlb counters %s\n", dtlb_fd < 0 ? "unavailable" : "available");
+    printf("mode,op,dist,n,ops,ops_per_sec,p50_ns,p99_ns,p999_ns,dtlb_misses\n");
+
+    for( i=0; i < n_sizes; ++i ){
+        if( sizes[i] > max_elems ){
+            printf("# capping %s from %lu to %lu elements\n", size_names[i], (unsigned long) sizes[i], (unsigned long) max_elems);
+            sizes[i] = max_elems;
+        }
+        if( sizes[i] < BATCH ){
+            sizes[i] = BATCH;
+        }
+
+        for( m=0; m < sizeof(modes) / sizeof(modes[0]); ++m ){
+            if( only_mode && strcmp(only_mode, modes[m].name) ){
+                continue;
+            }
+
+            for( d=DIST_SEQUENTIAL; d <= DIST_ZIPFIAN; ++d ){
+                if( only_dist && strcmp(only_dist, dist_names[d]) ){
+                    continue;
+                }
+
+                bench(&modes[m], d, sizes[i]);
+            }
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "typed") ){
+            bench_typed(sizes[i]);
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "sharded") ){
+            bench_sharded(sizes[i]);
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "resize") ){
+            bench_resize(sizes[i]);
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "snapshot") ){
+            bench_snapshot(sizes[i]);
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "frozen") ){
+            bench_frozen(sizes[i]);
+        }
+
+        if( ! only_mode || ! strcmp(only_mode, "mutex") || ! strcmp(only_mode, "locked") || ! strcmp(only_mode, "rcu") ){
+            bench_threads(sizes[i], only_mode);
+        }
+    }
+
+    return 0;
+}
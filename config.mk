@@ -4,7 +4,7 @@ PREFIX = /usr
 MANPREFIX = ${PREFIX}/share/man
 
 INCS =
-LIBS =
+LIBS = -lpthread
 
 # NB: including  -fprofile-arcs -ftest-coverage for gcov
 # travis wasn't happy with -Wmaybe-uninitialized  so removed for now
@@ -19,4 +19,8 @@ LDFLAGS = -fprofile-arcs ${LIBS}
 # gcov free version
 #LDFLAGS = ${LIBS}
 
+# flags for benchmarks, optimised and without gcov
+BENCHCFLAGS = -std=c99 -pedantic -Werror -Wall -Wextra -Wstrict-prototypes -Wmissing-prototypes -Wmissing-declarations -Wshadow -Wdeclaration-after-statement -Wunused-function -O2 -DNDEBUG ${INCS}
+BENCHLDFLAGS = -lm ${LIBS}
+
 CC = cc
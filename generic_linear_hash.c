@@ -26,9 +26,14 @@
 #include <stdio.h> /* puts, printf */
 #include <limits.h> /* ULONG_MAX */
 
-#include <stdlib.h> /* calloc, free */
-#include <string.h> /* strcmp, strlen */
+#include <stdlib.h> /* calloc, malloc, free */
+#include <string.h> /* strcmp, strlen, memset, memcpy, memcmp */
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* SIZE_MAX */
+
+#ifdef glh_STATS
+#include <time.h> /* clock */
+#endif
 
 #include "generic_linear_hash.h"
 
@@ -38,6 +43,35 @@
 /* factor we grow the number of slots by each resize */
 #define glh_SCALING_FACTOR 2
 
+/* number of old slots migrated by each insert or delete
+ * during an incremental grow (glh_FLAG_INCREMENTAL)
+ *
+ * growing doubles the size, so the old array is drained well before
+ * enough inserts have happened to trigger the next grow,
+ * rebuilds to clear out dummies grow instead when the load is close enough
+ * to threshold that a grow could otherwise come before they drain
+ */
+#define glh_MIGRATE_STEP 16
+
+/* alignment we ask our allocator for, one cache line */
+#define glh_ALLOC_ALIGN 64
+
+/* size of each chunk of copied keys when glh_FLAG_OWN_KEYS is set
+ * any key larger than this gets a chunk of it's own
+ */
+#define glh_ARENA_CHUNK_SIZE (64 * 1024)
+
+/* alignment of each key copied into a chunk
+ * so that non string keys can be read in place
+ */
+#define glh_ARENA_ALIGN 8
+
+/* number of keys hashed and prefetched together by the batch lookups
+ * this should be enough to cover the latency of a cache miss
+ * without evicting the first prefetches before we get to them
+ */
+#define glh_BATCH_SIZE 16
+
 /* default loading factor we resize after in base 10
  * 0 through to 10
  *
@@ -45,6 +79,82 @@
  */
 #define glh_DEFAULT_THRESHOLD 6
 
+/* multiplier used to mix hashes in glh_pos_pow2 and glh_pos_top
+ * this is 2^bits / golden ratio for the width of unsigned long
+ * along with half that width which we fold the product by
+ */
+#if ULONG_MAX > 0xffffffffUL
+#define glh_FIBONACCI 11400714819323198485UL
+#define glh_FIBONACCI_FOLD 32
+#else
+#define glh_FIBONACCI 2654435769UL
+#define glh_FIBONACCI_FOLD 16
+#endif
+
+/* number of control bytes probed at once when glh_FLAG_CTRL is set
+ *
+ * we use avx2 (32 bytes) or sse2 (16 bytes) where the compiler
+ * tells us they are available, otherwise we fall back to a scalar loop
+ *
+ * defining glh_NO_SIMD forces the scalar fallback
+ */
+#if defined(__AVX2__) && ! defined(glh_NO_SIMD)
+#include <immintrin.h> /* _mm256_* */
+#define glh_GROUP_AVX2
+#define glh_GROUP_WIDTH 32
+#elif defined(__SSE2__) && ! defined(glh_NO_SIMD)
+#include <emmintrin.h> /* _mm_* */
+#define glh_GROUP_SSE2
+#define glh_GROUP_WIDTH 16
+#else
+#define glh_GROUP_WIDTH 16
+#endif
+
+/* hint that we will soon read from addr */
+#if defined(__GNUC__)
+#define glh_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define glh_PREFETCH(addr) ((void) (addr))
+#endif
+
+/* statistics counting for glh_stats, only compiled in with glh_STATS
+ *
+ * glh_HASH must be used for every call to table->hash_func
+ * so that it can be counted
+ */
+#ifdef glh_STATS
+#define glh_STATS_INC(table, field) (++(table)->stats->field)
+#define glh_STATS_PROBE(table, hash, stop, hit) glh_stats_probe(table, hash, stop, hit)
+#define glh_HASH(table, key) (glh_STATS_INC(table, hash_calls), (table)->hash_func(key))
+#else
+#define glh_STATS_INC(table, field) ((void) 0)
+#define glh_STATS_PROBE(table, hash, stop, hit) ((void) 0)
+#define glh_HASH(table, key) ((table)->hash_func(key))
+#endif
+
+/* chunk of copied keys when glh_FLAG_OWN_KEYS is set
+ * chunks form a list from table->arena, most recent first
+ */
+struct glh_arena_chunk {
+    /* next (older) chunk or 0 */
+    struct glh_arena_chunk *next;
+    /* number of bytes in data */
+    size_t size;
+    /* number of bytes of data handed out */
+    size_t used;
+    unsigned char data[];
+};
+
+/* result of probing a range of slots */
+enum glh_probe_result {
+    /* found what we were looking for */
+    glh_PROBE_FOUND,
+    /* hit an empty so the search is over */
+    glh_PROBE_EMPTY,
+    /* ran off the end of the range, continue searching */
+    glh_PROBE_CONTINUE
+};
+
 /* leaving this in place as we have some internal only helper functions
  * that we only exposed to allow for easy testing and extension
  */
@@ -85,7 +195,17 @@ unsigned int glh_entry_eq(const struct glh_table *table, struct glh_entry *cur,
         return 0;
     }
 
+#if glh_INLINE_KEY_LEN
+    /* compare against our copy rather than following cur->key */
+    if( (table->flags & glh_FLAG_INLINE) && cur->key_len ){
+        return cur->key_len == table->key_len_func(key)
+            && ! memcmp(cur->inline_key, key, cur->key_len);
+    }
+#endif
+
     if( table->equal_func ){
+        glh_STATS_INC(table, equal_calls);
+
         /* equal func will return 0 for equal
          * and non-zero for not-equal
          */
@@ -99,6 +219,152 @@ unsigned int glh_entry_eq(const struct glh_table *table, struct glh_entry *cur,
     return 1;
 }
 
+/* default allocator, plain malloc / calloc / free
+ * these give whatever alignment malloc guarantees
+ */
+void * glh_default_alloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return malloc(size);
+}
+
+void * glh_default_zalloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return calloc(1, size);
+}
+
+void glh_default_dealloc(void *ctx, void *ptr, size_t size){
+    (void) ctx;
+    (void) size;
+    free(ptr);
+}
+
+/* allocate an array of n elements of size bytes from allocator
+ * zero filled if zero is set
+ *
+ * returns pointer on success
+ * returns 0 on failure (including if n * size would overflow)
+ */
+void * glh_alloc_array(const struct glh_allocator *allocator, size_t n, size_t size, unsigned int zero){
+    if( size && n > SIZE_MAX / size ){
+        puts("glh_alloc_array: size overflow");
+        return 0;
+    }
+
+    if( zero ){
+        return allocator->zalloc(allocator->ctx, n * size, glh_ALLOC_ALIGN);
+    }
+
+    return allocator->alloc(allocator->ctx, n * size, glh_ALLOC_ALIGN);
+}
+
+/* free an array from glh_alloc_array, ptr may be 0 */
+void glh_free_array(const struct glh_allocator *allocator, void *ptr, size_t n, size_t size){
+    if( ! ptr ){
+        return;
+    }
+
+    allocator->dealloc(allocator->ctx, ptr, n * size);
+}
+
+/* copy entry's key inline if glh_FLAG_INLINE is set and it is short enough
+ * otherwise mark it as not being inline
+ */
+void glh_entry_inline(const struct glh_table *table, struct glh_entry *entry){
+#if glh_INLINE_KEY_LEN
+    /* length of entry's key */
+    size_t len = 0;
+
+    entry->key_len = 0;
+
+    if( ! (table->flags & glh_FLAG_INLINE) ){
+        return;
+    }
+
+    len = table->key_len_func(entry->key);
+    if( len > glh_INLINE_KEY_LEN ){
+        return;
+    }
+
+    memcpy(entry->inline_key, entry->key, len);
+    entry->key_len = len;
+#else
+    (void) table;
+    (void) entry;
+#endif
+}
+
+/* copy key into table's arena
+ * followed by a 0 byte so string keys remain terminated
+ *
+ * returns pointer to the copy on success
+ * returns 0 on failure
+ */
+const char * glh_arena_copy(struct glh_table *table, const char *key){
+    /* length of key */
+    size_t len = 0;
+    /* bytes needed, including our 0 byte and padding */
+    size_t need = 0;
+    /* chunk we are copying into */
+    struct glh_arena_chunk *chunk = 0;
+    /* size of a new chunk */
+    size_t size = 0;
+    /* our copy */
+    unsigned char *copy = 0;
+
+    len = table->key_len_func(key);
+    need = (len + 1 + glh_ARENA_ALIGN - 1) & ~((size_t) glh_ARENA_ALIGN - 1);
+    if( need <= len || need > SIZE_MAX - sizeof(struct glh_arena_chunk) ){
+        puts("glh_arena_copy: key too large");
+        return 0;
+    }
+
+    chunk = table->arena;
+
+    if( ! chunk || chunk->size - chunk->used < need ){
+        size = need > glh_ARENA_CHUNK_SIZE ? need : glh_ARENA_CHUNK_SIZE;
+
+        chunk = glh_alloc_array(&(table->allocator), 1, sizeof(struct glh_arena_chunk) + size, 0);
+        if( ! chunk ){
+            puts("glh_arena_copy: call to glh_alloc_array failed");
+            return 0;
+        }
+
+        chunk->size = size;
+        chunk->used = 0;
+
+        if( size > glh_ARENA_CHUNK_SIZE && table->arena ){
+            /* an oversized key, keep filling the current chunk */
+            chunk->next = table->arena->next;
+            table->arena->next = chunk;
+        } else {
+            chunk->next = table->arena;
+            table->arena = chunk;
+        }
+    }
+
+    copy = &(chunk->data[chunk->used]);
+    chunk->used += need;
+
+    memcpy(copy, key, len);
+    copy[len] = 0;
+
+    return (const char *) copy;
+}
+
+/* free every chunk in table's arena */
+void glh_arena_destroy(struct glh_table *table){
+    /* chunk being freed */
+    struct glh_arena_chunk *chunk = 0;
+
+    while( table->arena ){
+        chunk = table->arena;
+        table->arena = chunk->next;
+        glh_free_array(&(table->allocator), chunk, 1, sizeof(struct glh_arena_chunk) + chunk->size);
+    }
+}
+
 /* initialise an existing glh_entry
  *
  * returns 1 on success
@@ -127,17 +393,30 @@ unsigned int glh_entry_init(           struct glh_table *table,
     /* if hash is 0 we issue a warning and recalculate */
     if( hash == 0 ){
         puts("warning glh_entry_init: provided hash was 0, recalculating");
-        hash = table->hash_func(key);
+        hash = glh_HASH(table, key);
+    }
+
+    /* take our own copy of key if asked to */
+    if( table->flags & glh_FLAG_OWN_KEYS ){
+        key = glh_arena_copy(table, key);
+        if( ! key ){
+            puts("glh_entry_init: call to glh_arena_copy failed");
+            return 0;
+        }
     }
 
     /* setup our simple fields */
     entry->hash    = hash;
     entry->data    = data;
     entry->state   = glh_ENTRY_OCCUPIED;
+    entry->dist    = 0;
 
-    /* we duplicate the string */
+    /* this may be our own copy */
     entry->key = key;
 
+    /* and possibly copy it into the slot */
+    glh_entry_inline(table, entry);
+
     /* return success */
     return 1;
 }
@@ -164,80 +443,323 @@ unsigned int glh_entry_destroy(struct glh_entry *entry, unsigned int free_data){
     return 1;
 }
 
+/* round n up to the next power of two
+ *
+ * returns n if it is already a power of two
+ */
+size_t glh_round_pow2(size_t n){
+    size_t p = 1;
+
+    while( p < n ){
+        p <<= 1;
+    }
 
-/* find the glh_entry that should be holding this key
+    return p;
+}
+
+/* number of slots needed to hold n elements without the load
+ * reaching threshold, the load is checked before each insert
+ * so the nth insert sees n - 1 elements
  *
- * returns a pointer to it on success
- * return 0 on failure
+ * returns number of slots on success
+ * returns 0 on failure (n is too large)
  */
-struct glh_entry * glh_find_entry(const struct glh_table *table, const char *key){
-    /* our cur entry */
+size_t glh_capacity_size(size_t n, unsigned int threshold){
+    if( n > ((size_t) -1 - 1) / 10 ){
+        return 0;
+    }
+
+    return (n * 10) / threshold + 1;
+}
+
+/* number of glh_entry(s) in table->entries
+ * this is only smaller than table->size with glh_FLAG_COMPACT
+ */
+size_t glh_entries_len(const struct glh_table *table){
+    /* mapped tables have no entries at all */
+    if( table->map ){
+        return 0;
+    }
+
+    if( table->index ){
+        return table->entries_size;
+    }
+
+    return table->size;
+}
+
+/* number of entries a compact table of size slots needs room for
+ * enough to reach threshold and always enough for n_elems + 1
+ */
+size_t glh_compact_entries_size(size_t size, unsigned int threshold, size_t n_elems){
+    /* split up so that size * threshold cannot overflow */
+    size_t n = (size / 10) * threshold + ((size % 10) * threshold) / 10 + 1;
+
+    if( n <= n_elems ){
+        n = n_elems + 1;
+    }
+
+    if( n > size ){
+        n = size;
+    }
+
+    return n;
+}
+
+/* select the slot for hash in a table of table_size slots
+ * respecting the flags set on table
+ *
+ * note table_size may differ from table->size during a resize
+ */
+size_t glh_table_pos(const struct glh_table *table, unsigned long int hash, size_t table_size){
+    if( table->flags & glh_FLAG_POW2 ){
+        return glh_pos_pow2(hash, table_size);
+    }
+
+    return glh_pos(hash, table_size);
+}
+
+/* calculate the 7 bit fingerprint stored in the control byte
+ * for an occupied slot
+ *
+ * we fold the whole hash down so that the high bits also contribute,
+ * the low bits alone are mostly already decided by the slot position
+ *
+ * the first shift is split in two as unsigned long may be only 32 bits
+ */
+unsigned char glh_ctrl_fingerprint(unsigned long int hash){
+    hash ^= (hash >> 16) >> 16;
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+    hash ^= hash >> 7;
+
+    return hash & 0x7f;
+}
+
+/* update the control byte at `i` to mirror table->entries[i]
+ *
+ * this is a no-op if table has no control bytes
+ */
+void glh_ctrl_set(struct glh_table *table, size_t i){
     struct glh_entry *cur = 0;
 
-    /* hash */
-    unsigned long int hash = 0;
-    /* position in hash table */
-    size_t pos = 0;
-    /* iterator through entries */
+    if( ! table->ctrl ){
+        return;
+    }
+
+    cur = &(table->entries[i]);
+
+    switch( cur->state ){
+        case glh_ENTRY_OCCUPIED:
+            table->ctrl[i] = glh_ctrl_fingerprint(cur->hash);
+            break;
+        case glh_ENTRY_DUMMY:
+            table->ctrl[i] = glh_CTRL_DUMMY;
+            break;
+        default:
+            table->ctrl[i] = glh_CTRL_EMPTY;
+            break;
+    }
+}
+
+/* a bitmask with one bit per control byte in a group
+ * bit n is set if ctrl[n] matched
+ */
+typedef unsigned long int glh_group_mask;
+
+/* compare a whole group of control bytes against `value`
+ *
+ * this will read glh_GROUP_WIDTH bytes starting at ctrl,
+ * the caller must ensure they are all within the array
+ *
+ * returns a bitmask of all bytes equal to value
+ */
+glh_group_mask glh_group_match(const unsigned char *ctrl, unsigned char value){
+#if defined(glh_GROUP_AVX2)
+    __m256i group = _mm256_loadu_si256((const __m256i *) ctrl);
+    __m256i match = _mm256_cmpeq_epi8(group, _mm256_set1_epi8((char) value));
+    return (unsigned int) _mm256_movemask_epi8(match);
+#elif defined(glh_GROUP_SSE2)
+    __m128i group = _mm_loadu_si128((const __m128i *) ctrl);
+    __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8((char) value));
+    return (unsigned int) _mm_movemask_epi8(match);
+#else
+    glh_group_mask mask = 0;
     size_t i = 0;
-    /* cached strlen */
 
+    for( i=0; i < glh_GROUP_WIDTH; ++i ){
+        if( ctrl[i] == value ){
+            mask |= 1UL << i;
+        }
+    }
+
+    return mask;
+#endif
+}
 
-    if( ! table ){
-        puts("glh_find_entry: table undef");
-        return 0;
+/* find all free (empty or dummy) control bytes in a group
+ *
+ * as free bytes are exactly those with the high bit set
+ * this is just a movemask when we have simd
+ *
+ * returns a bitmask of all free bytes
+ */
+glh_group_mask glh_group_match_free(const unsigned char *ctrl){
+#if defined(glh_GROUP_AVX2)
+    return (unsigned int) _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *) ctrl));
+#elif defined(glh_GROUP_SSE2)
+    return (unsigned int) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) ctrl));
+#else
+    glh_group_mask mask = 0;
+    size_t i = 0;
+
+    for( i=0; i < glh_GROUP_WIDTH; ++i ){
+        if( glh_CTRL_IS_FREE(ctrl[i]) ){
+            mask |= 1UL << i;
+        }
     }
 
-    if( ! key ){
-        puts("glh_find_entry: key undef");
-        return 0;
+    return mask;
+#endif
+}
+
+/* index of the lowest set bit in a non-zero mask */
+unsigned int glh_group_lowest(glh_group_mask mask){
+#if defined(__GNUC__)
+    return __builtin_ctzl(mask);
+#else
+    unsigned int i = 0;
+
+    while( ! (mask & 1) ){
+        mask >>= 1;
+        ++i;
     }
 
-    /* calculate hash */
-    hash = table->hash_func(key);
+    return i;
+#endif
+}
 
-    /* calculate pos
-     * we know table is defined here
-     * so glh_pos cannot fail
-     */
-    pos = glh_pos(hash, table->size);
+/* probe the control bytes in ctrl[start..end) for key
+ * this walks whole groups at a time and then finishes off
+ * any remainder one byte at a time
+ *
+ * if *free_pos is still table->size then it will be set to
+ * the first free (empty or dummy) slot seen
+ *
+ * returns glh_PROBE_FOUND and sets *found if key was found
+ * returns glh_PROBE_EMPTY and sets *found to the empty slot if an empty was hit before key
+ * returns glh_PROBE_CONTINUE if we ran off the end of the range
+ */
+enum glh_probe_result glh_ctrl_probe_range(const struct glh_table *table,
+                                           unsigned long int hash,
+                                           const void *key,
+                                           unsigned char fp,
+                                           size_t start,
+                                           size_t end,
+                                           size_t *found,
+                                           size_t *free_pos){
+    /* iterator through ctrl */
+    size_t i = start;
+    /* bytes matching our fingerprint */
+    glh_group_mask match = 0;
+    /* bytes that are empty */
+    glh_group_mask empty = 0;
+    /* bytes that are empty or dummy */
+    glh_group_mask free_mask = 0;
+    /* offset of a match within the group */
+    unsigned int offset = 0;
+
+    for( ; i + glh_GROUP_WIDTH <= end; i += glh_GROUP_WIDTH ){
+        match = glh_group_match(&(table->ctrl[i]), fp);
+        empty = glh_group_match(&(table->ctrl[i]), glh_CTRL_EMPTY);
+
+        /* the first free byte always comes at or before the first empty */
+        if( *free_pos == table->size ){
+            free_mask = glh_group_match_free(&(table->ctrl[i]));
+            if( free_mask ){
+                *free_pos = i + glh_group_lowest(free_mask);
+            }
+        }
 
-    /* search pos..size */
-    for( i=pos; i < table->size; ++i ){
-        cur = &(table->entries[i]);
+        /* only matches before the first empty are part of our probe */
+        if( empty ){
+            match &= (empty & (~empty + 1)) - 1;
+        }
+
+        for( ; match; match &= match - 1 ){
+            offset = glh_group_lowest(match);
+            if( glh_entry_eq(table, &(table->entries[i + offset]), hash, key) ){
+                *found = i + offset;
+                return glh_PROBE_FOUND;
+            }
+        }
+
+        if( empty ){
+            *found = i + glh_group_lowest(empty);
+            return glh_PROBE_EMPTY;
+        }
+    }
+
+    /* remainder which is too short for a whole group */
+    for( ; i < end; ++i ){
+        if( glh_CTRL_IS_FREE(table->ctrl[i]) && *free_pos == table->size ){
+            *free_pos = i;
+        }
 
         /* if this is an empty then we stop */
-        if( cur->state == glh_ENTRY_EMPTY ){
-            /* failed to find element */
-#ifdef DEBUG
-            puts("glh_find_entry: failed to find key, encountered empty");
-#endif
-            return 0;
+        if( table->ctrl[i] == glh_CTRL_EMPTY ){
+            *found = i;
+            return glh_PROBE_EMPTY;
         }
 
-        /* if this is a dummy then we skip but continue */
-        if( cur->state == glh_ENTRY_DUMMY ){
+        /* dummies never match a fingerprint so are also skipped here */
+        if( table->ctrl[i] != fp ){
             continue;
         }
 
-        if( ! glh_entry_eq(table, cur, hash, key) ){
+        if( ! glh_entry_eq(table, &(table->entries[i]), hash, key) ){
             continue;
         }
 
-        return cur;
+        *found = i;
+        return glh_PROBE_FOUND;
     }
 
-    /* search 0..pos */
-    for( i=0; i < pos; ++i ){
+    return glh_PROBE_CONTINUE;
+}
+
+/* probe the entries in entries[start..end) for key
+ *
+ * if *free_pos is still table->size then it will be set to
+ * the first free (empty or dummy) slot seen
+ *
+ * returns glh_PROBE_FOUND and sets *found if key was found
+ * returns glh_PROBE_EMPTY and sets *found to the empty slot if an empty was hit before key
+ * returns glh_PROBE_CONTINUE if we ran off the end of the range
+ */
+enum glh_probe_result glh_entries_probe_range(const struct glh_table *table,
+                                              unsigned long int hash,
+                                              const void *key,
+                                              size_t start,
+                                              size_t end,
+                                              size_t *found,
+                                              size_t *free_pos){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* iterator through entries */
+    size_t i = 0;
+
+    for( i=start; i < end; ++i ){
         cur = &(table->entries[i]);
 
+        if( cur->state != glh_ENTRY_OCCUPIED && *free_pos == table->size ){
+            *free_pos = i;
+        }
+
         /* if this is an empty then we stop */
         if( cur->state == glh_ENTRY_EMPTY ){
-            /* failed to find element */
-#ifdef DEBUG
-            puts("glh_find_entry: failed to find key, encountered empty");
-#endif
-            return 0;
+            *found = i;
+            return glh_PROBE_EMPTY;
         }
 
         /* if this is a dummy then we skip but continue */
@@ -249,661 +771,2846 @@ struct glh_entry * glh_find_entry(const struct glh_table *table, const char *key
             continue;
         }
 
-        return cur;
+        *found = i;
+        return glh_PROBE_FOUND;
     }
 
-    /* failed to find element */
-#ifdef DEBUG
-    puts("glh_find_entry: failed to find key");
-#endif
-    return 0;
+    return glh_PROBE_CONTINUE;
 }
 
-
-
-/**********************************************
- **********************************************
- **********************************************
- ******** generic_linear_hash.h implementation ********
- **********************************************
- **********************************************
- ***********************************************/
-
-/* function to return number of elements
- *
- * returns number on success
- * returns 0 on failure
+/* number of slots walked forwards from `from` to reach `to`
+ * wrapping around the end of a table of table_size slots
  */
-unsigned int glh_nelems(const struct glh_table *table){
-    if( ! table ){
-        puts("glh_nelems: table was null");
-        return 0;
+size_t glh_distance(size_t from, size_t to, size_t table_size){
+    if( to >= from ){
+        return to - from;
     }
 
-    return table->n_elems;
+    return to + table_size - from;
 }
 
-/* function to calculate load
- * (table->n_elems * 10) / table->size
+/* empty the slot at `hole` and then shift any later members
+ * of the same cluster back to fill it
  *
- * returns loading factor 0 -> 10 on success
- * returns 0 on failure
+ * an entry can only move back into the hole if the hole lies
+ * between the entry's home slot and it's current slot,
+ * otherwise moving it would place it before it's home
+ *
+ * this relies on there being no dummies in the table
+ * which glh_FLAG_BACKSHIFT guarantees
  */
-unsigned int glh_load(const struct glh_table *table){
-    if( ! table ){
-        puts("glh_load: table was null");
-        return 0;
-    }
+void glh_backshift(struct glh_table *table, size_t hole){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* iterator through the rest of the cluster */
+    size_t i = 0;
+    /* home slot of cur */
+    size_t home = 0;
 
-    /* here we multiply by 10 to avoid floating point
-     * as we only care about the most significant figure
-     */
-    return (table->n_elems * 10) / table->size;
-}
+    i = hole;
 
-/* set the load that we resize at
+    for( ;; ){
+        i = (i + 1) % table->size;
+        cur = &(table->entries[i]);
+
+        /* end of cluster, this also catches wrapping back to hole */
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            break;
+        }
+
+        home = glh_table_pos(table, cur->hash, table->size);
+        if( glh_distance(home, i, table->size) < glh_distance(hole, i, table->size) ){
+            /* hole is before cur's home so cur must stay
+             * robin hood clusters are ordered by home slot
+             * so nothing later in the cluster can move either
+             */
+            if( table->flags & glh_FLAG_ROBINHOOD ){
+                break;
+            }
+            continue;
+        }
+
+        table->entries[hole] = *cur;
+        table->entries[hole].dist = glh_distance(home, hole, table->size);
+        glh_ctrl_set(table, hole);
+        hole = i;
+    }
+
+    cur = &(table->entries[hole]);
+    cur->data = 0;
+    cur->key = 0;
+    cur->hash = 0;
+    cur->state = glh_ENTRY_EMPTY;
+    glh_ctrl_set(table, hole);
+}
+
+/* place entry into entries[0..table_size) robin hood style
+ * starting the search at slot `start`, entry.dist must already
+ * be set to it's distance from home at start
+ *
+ * any resident closer to it's home than the entry we are carrying
+ * is displaced and carried further along in it's place
+ *
+ * ctrl may be null, otherwise it is kept in sync
+ *
+ * the caller must ensure there is at least one free slot
+ */
+void glh_robinhood_place(struct glh_entry *entries,
+                         unsigned char *ctrl,
+                         size_t table_size,
+                         size_t start,
+                         struct glh_entry entry){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* displaced entry */
+    struct glh_entry displaced;
+    /* iterator through entries */
+    size_t i = start;
+
+    for( ;; ){
+        cur = &(entries[i]);
+
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            *cur = entry;
+            if( ctrl ){
+                ctrl[i] = glh_ctrl_fingerprint(entry.hash);
+            }
+            return;
+        }
+
+        /* take from the rich (close to home) and give to the poor */
+        if( cur->dist < entry.dist ){
+            displaced = *cur;
+            *cur = entry;
+            if( ctrl ){
+                ctrl[i] = glh_ctrl_fingerprint(entry.hash);
+            }
+            entry = displaced;
+        }
+
+        ++i;
+        if( i == table_size ){
+            i = 0;
+        }
+        ++entry.dist;
+    }
+}
+
+/* probe a robin hood table for key
+ *
+ * we can stop as soon as we reach an entry which is closer to it's
+ * home than key would be at the same slot, as key would have displaced it
+ *
+ * returns 1 if key was found, *pos is set to it's slot
+ * returns 0 if key was not found, *pos is set to the slot key should
+ *  be placed in or to table->size if we walked the whole table
+ */
+unsigned int glh_robinhood_probe(const struct glh_table *table, unsigned long int hash, const void *key, size_t *pos){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* iterator through entries */
+    size_t i = 0;
+    /* distance of i from key's home */
+    size_t dist = 0;
+
+    i = glh_table_pos(table, hash, table->size);
+
+    for( dist=0; dist < table->size; ++dist ){
+        cur = &(table->entries[i]);
+
+        if( cur->state != glh_ENTRY_OCCUPIED || cur->dist < dist ){
+            *pos = i;
+            return 0;
+        }
+
+        if( glh_entry_eq(table, cur, hash, key) ){
+            *pos = i;
+            return 1;
+        }
+
+        ++i;
+        if( i == table->size ){
+            i = 0;
+        }
+    }
+
+    *pos = table->size;
+    return 0;
+}
+
+/* record the length of a probe for key's hash which stopped at slot `stop`
+ * a stop of table->size means the whole table was walked
+ *
+ * this is only called when compiled with glh_STATS
+ */
+void glh_stats_probe(const struct glh_table *table, unsigned long int hash, size_t stop, unsigned int hit){
+    /* number of slots walked past home */
+    size_t len = 0;
+
+    if( ! table->stats ){
+        return;
+    }
+
+    len = table->size;
+    if( stop < table->size ){
+        len = glh_distance(glh_table_pos(table, hash, table->size), stop, table->size);
+    }
+
+    if( len >= glh_STATS_BUCKETS ){
+        len = glh_STATS_BUCKETS - 1;
+    }
+
+    if( hit ){
+        ++table->stats->probe_hits[len];
+    } else {
+        ++table->stats->probe_misses[len];
+    }
+}
+
+/* probe a compact table's index for key starting at it's home slot
+ * and wrapping around the end of the table
+ *
+ * dummy slots are never reused, a new key always takes an empty slot
+ * and is appended to entries
+ *
+ * returns 1 if key was found, *pos is set to it's position in entries
+ *  and *slot to the slot in index pointing at it
+ * returns 0 if key was not found, *pos and *slot are set to the empty slot
+ *  which ended the probe or to table->size if there was none
+ */
+unsigned int glh_compact_probe(const struct glh_table *table, unsigned long int hash, const void *key, size_t *pos, size_t *slot){
+    /* iterator through index */
+    size_t i = 0;
+    /* number of slots looked at */
+    size_t n = 0;
+    /* current index value */
+    unsigned int idx = 0;
+
+    i = glh_table_pos(table, hash, table->size);
+
+    for( n=0; n < table->size; ++n ){
+        idx = table->index[i];
+
+        if( idx == glh_INDEX_EMPTY ){
+            glh_STATS_PROBE(table, hash, i, 0);
+            *pos = i;
+            *slot = i;
+            return 0;
+        }
+
+        if( idx != glh_INDEX_DUMMY && glh_entry_eq(table, &(table->entries[idx]), hash, key) ){
+            glh_STATS_PROBE(table, hash, i, 1);
+            *pos = idx;
+            *slot = i;
+            return 1;
+        }
+
+        ++i;
+        if( i == table->size ){
+            i = 0;
+        }
+    }
+
+    glh_STATS_PROBE(table, hash, table->size, 0);
+    *pos = table->size;
+    *slot = table->size;
+    return 0;
+}
+
+/* probe the table for key starting at it's home slot
+ * and wrapping around the end of the table
+ *
+ * a single pass both searches for key and remembers the
+ * first free slot (empty or dummy) where key could be inserted
+ *
+ * returns 1 if key was found, *pos is set to it's slot
+ * returns 0 if key was not found, *pos is set to the first free slot
+ *  or to table->size if there was no free slot
+ */
+unsigned int glh_probe(const struct glh_table *table, unsigned long int hash, const void *key, size_t *pos){
+    /* position in hash table */
+    size_t home = 0;
+    /* first free slot seen */
+    size_t free_pos = 0;
+    /* index of found entry */
+    size_t found = 0;
+    /* result of each probe */
+    enum glh_probe_result res = glh_PROBE_CONTINUE;
+    /* fingerprint we are searching for */
+    unsigned char fp = 0;
+    /* slot within index, only used by compact tables */
+    size_t slot = 0;
+#ifdef glh_STATS
+    /* result of a robin hood probe */
+    unsigned int rh_found = 0;
+#endif
+
+    /* calculate pos
+     * we know table is defined here
+     * so glh_pos cannot fail
+     */
+    /* compact tables probe their index instead of entries */
+    if( table->index ){
+        return glh_compact_probe(table, hash, key, pos, &slot);
+    }
+
+    /* robin hood probing has it's own termination rule */
+    if( table->flags & glh_FLAG_ROBINHOOD ){
+#ifdef glh_STATS
+        rh_found = glh_robinhood_probe(table, hash, key, pos);
+        glh_STATS_PROBE(table, hash, *pos, rh_found);
+        return rh_found;
+#else
+        return glh_robinhood_probe(table, hash, key, pos);
+#endif
+    }
+
+    home = glh_table_pos(table, hash, table->size);
+    free_pos = table->size;
+    /* only used by glh_STATS_PROBE, a full walk stops nowhere */
+    found = table->size;
+
+    /* if we have control bytes then we scan those instead */
+    if( table->ctrl ){
+        fp = glh_ctrl_fingerprint(hash);
+
+        /* search home..size */
+        res = glh_ctrl_probe_range(table, hash, key, fp, home, table->size, &found, &free_pos);
+        if( res == glh_PROBE_CONTINUE ){
+            /* search 0..home */
+            res = glh_ctrl_probe_range(table, hash, key, fp, 0, home, &found, &free_pos);
+        }
+    } else {
+        /* search home..size */
+        res = glh_entries_probe_range(table, hash, key, home, table->size, &found, &free_pos);
+        if( res == glh_PROBE_CONTINUE ){
+            /* search 0..home */
+            res = glh_entries_probe_range(table, hash, key, 0, home, &found, &free_pos);
+        }
+    }
+
+    glh_STATS_PROBE(table, hash, found, res == glh_PROBE_FOUND);
+
+    if( res == glh_PROBE_FOUND ){
+        *pos = found;
+        return 1;
+    }
+
+#ifdef DEBUG
+    puts("glh_probe: failed to find key");
+#endif
+
+    *pos = free_pos;
+    return 0;
+}
+
+/* allocate an array of table_size entries and, if glh_FLAG_CTRL
+ * is set on table, a matching array of empty control bytes
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_alloc_slots(const struct glh_table *table,
+                             size_t table_size,
+                             struct glh_entry **entries,
+                             unsigned char **ctrl){
+
+    *ctrl = 0;
+
+    /* allocate an array of glh_entry */
+    *entries = glh_alloc_array(&(table->allocator), table_size, sizeof(struct glh_entry), 1);
+    if( ! *entries ){
+        puts("glh_alloc_slots: call to glh_alloc_array failed");
+        return 0;
+    }
+
+    if( table->flags & glh_FLAG_CTRL ){
+        *ctrl = glh_alloc_array(&(table->allocator), table_size, 1, 0);
+        if( ! *ctrl ){
+            puts("glh_alloc_slots: call to glh_alloc_array failed");
+            glh_free_array(&(table->allocator), *entries, table_size, sizeof(struct glh_entry));
+            *entries = 0;
+            return 0;
+        }
+        memset(*ctrl, glh_CTRL_EMPTY, table_size);
+    }
+
+    return 1;
+}
+
+/* find key within old_entries while an incremental grow is in progress
+ *
+ * the old array is only ever drained so a plain linear probe
+ * is correct whatever layout it was built with
+ *
+ * returns the index of key within old_entries on success
+ * returns table->old_size on failure
+ */
+size_t glh_old_find(const struct glh_table *table, unsigned long int hash, const void *key){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* position in old array */
+    size_t pos = 0;
+    /* iterator through old array */
+    size_t i = 0;
+    /* number of slots looked at */
+    size_t n = 0;
+
+    pos = glh_table_pos(table, hash, table->old_size);
+
+    for( i=pos, n=0; n < table->old_size; ++n ){
+        cur = &(table->old_entries[i]);
+
+        if( cur->state == glh_ENTRY_EMPTY ){
+            break;
+        }
+
+        if( cur->state == glh_ENTRY_OCCUPIED && glh_entry_eq(table, cur, hash, key) ){
+            return i;
+        }
+
+        ++i;
+        if( i == table->old_size ){
+            i = 0;
+        }
+    }
+
+    return table->old_size;
+}
+
+/* move old_entries[i] into entries
+ * leaving a dummy behind so old probes carry on past it
+ *
+ * returns the new position of the entry
+ */
+size_t glh_migrate_entry(struct glh_table *table, size_t i){
+    /* entry being moved */
+    struct glh_entry moving;
+    /* home slot in new array */
+    size_t home = 0;
+    /* position in new array */
+    size_t pos = 0;
+
+    moving = table->old_entries[i];
+
+    table->old_entries[i].data  = 0;
+    table->old_entries[i].key   = 0;
+    table->old_entries[i].state = glh_ENTRY_DUMMY;
+
+    home = glh_table_pos(table, moving.hash, table->size);
+
+    if( table->flags & glh_FLAG_ROBINHOOD ){
+        /* find where we belong, the new array always has room */
+        glh_robinhood_probe(table, moving.hash, moving.key, &pos);
+        moving.dist = glh_distance(home, pos, table->size);
+        glh_robinhood_place(table->entries, table->ctrl, table->size, pos, moving);
+        return pos;
+    }
+
+    /* first free slot, the new array always has room */
+    for( pos=home; table->entries[pos].state == glh_ENTRY_OCCUPIED; ){
+        ++pos;
+        if( pos == table->size ){
+            pos = 0;
+        }
+    }
+
+    if( table->entries[pos].state == glh_ENTRY_DUMMY && table->n_dummies ){
+        --table->n_dummies;
+    }
+
+    table->entries[pos] = moving;
+    glh_ctrl_set(table, pos);
+
+    return pos;
+}
+
+/* migrate up to `count` slots from old_entries into entries
+ * freeing old_entries once it has been drained
+ */
+void glh_migrate(struct glh_table *table, size_t count){
+    if( ! table->old_entries ){
+        return;
+    }
+
+    for( ; count && table->migrate_pos < table->old_size; --count, ++table->migrate_pos ){
+        if( table->old_entries[table->migrate_pos].state == glh_ENTRY_OCCUPIED ){
+            glh_migrate_entry(table, table->migrate_pos);
+        }
+    }
+
+    if( table->migrate_pos == table->old_size ){
+        glh_free_array(&(table->allocator), table->old_entries, table->old_size, sizeof(struct glh_entry));
+        table->old_entries = 0;
+        table->old_size = 0;
+        table->migrate_pos = 0;
+    }
+}
+
+/* begin an incremental grow to new_size slots
+ * finishing any grow already in progress first
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_grow_start(struct glh_table *table, size_t new_size){
+    /* our new data area */
+    struct glh_entry *new_entries = 0;
+    /* our new control bytes, only if glh_FLAG_CTRL */
+    unsigned char *new_ctrl = 0;
+
+    glh_migrate(table, table->old_size);
+
+    if( table->flags & glh_FLAG_POW2 ){
+        new_size = glh_round_pow2(new_size);
+    }
+
+    if( ! glh_alloc_slots(table, new_size, &new_entries, &new_ctrl) ){
+        puts("glh_grow_start: call to glh_alloc_slots failed");
+        return 0;
+    }
+
+    /* old probes only need the entries themselves */
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+
+    table->old_entries = table->entries;
+    table->old_size    = table->size;
+    table->migrate_pos = 0;
+
+    table->entries   = new_entries;
+    table->ctrl      = new_ctrl;
+    table->size      = new_size;
+    table->n_dummies = 0;
+
+    return 1;
+}
+
+/* find the slot holding key, or claim a new one for it
+ * this only hashes and probes once in the common case
+ * if a resize is needed then we probe again for our free slot
+ *
+ * if key already exists *created is set to 0 and data is ignored
+ * otherwise key and data are stored in a new slot and *created is set to 1
+ *
+ * returns 1 on success, *pos is set to key's slot
+ * returns 0 on failure
+ */
+unsigned int glh_find_or_claim(struct glh_table *table,
+                               unsigned long int hash,
+                               const char *key,
+                               void *data,
+                               size_t *pos,
+                               unsigned int *created){
+    /* new entry to be placed when robin hood hashing */
+    struct glh_entry rh_entry;
+
+    /* index of key within old_entries */
+    size_t old_pos = 0;
+    /* size to clear out dummies at */
+    size_t new_size = 0;
+    /* if we are reusing a dummy slot */
+    unsigned int reusing = 0;
+    /* slot within index, only used by compact tables */
+    size_t slot = 0;
+
+    *created = 0;
+
+    if( table->map ){
+        puts("glh_find_or_claim: table is a read only mapping");
+        return 0;
+    }
+
+    if( table->seeds ){
+        puts("glh_find_or_claim: table is frozen");
+        return 0;
+    }
+
+    /* do our share of any incremental grow */
+    glh_migrate(table, glh_MIGRATE_STEP);
+
+    if( glh_probe(table, hash, key, pos) ){
+        return 1;
+    }
+
+    /* key may not have been migrated yet, if so move it now */
+    if( table->old_entries ){
+        old_pos = glh_old_find(table, hash, key);
+        if( old_pos < table->old_size ){
+            *pos = glh_migrate_entry(table, old_pos);
+            return 1;
+        }
+    }
+
+    /* determine if we have to resize
+     * note we are checking the load before the insert
+     */
+    if( glh_load(table) >= table->threshold ){
+        if( table->flags & glh_FLAG_INCREMENTAL ){
+            if( ! glh_grow_start(table, table->size * glh_SCALING_FACTOR) ){
+                puts("glh_find_or_claim: call to glh_grow_start failed");
+                return 0;
+            }
+        } else if( ! glh_resize(table, table->size * glh_SCALING_FACTOR) ){
+            puts("glh_find_or_claim: call to glh_resize failed");
+            return 0;
+        }
+
+        /* our free slot will have moved */
+        glh_probe(table, hash, key, pos);
+    } else if( ((table->n_elems + table->n_dummies) * 10) / table->size >= table->threshold
+               || (table->index && table->n_elems + table->n_dummies >= table->entries_size) ){
+        /* our load is fine but dummies are clogging up the table
+         * (or a compact table's entries, which can also run out
+         * if threshold was raised) rebuild at the same size to clear them out
+         */
+        if( table->flags & glh_FLAG_INCREMENTAL ){
+            /* rebuild in steps as with a grow, dummies are never migrated
+             *
+             * if the next grow would come before this drains we grow now instead,
+             * any rebuild already under way will clear dummies once it drains
+             * so we only cut it short if there are no free slots at all
+             */
+            new_size = table->size;
+            if( ((table->n_elems + table->size / glh_MIGRATE_STEP) * 10) / table->size >= table->threshold ){
+                new_size *= glh_SCALING_FACTOR;
+            }
+
+            if( ( ! table->old_entries || table->n_elems + table->n_dummies >= table->size )
+                    && ! glh_grow_start(table, new_size) ){
+                puts("glh_find_or_claim: call to glh_grow_start failed");
+                return 0;
+            }
+        } else if( ! glh_resize(table, table->size) ){
+            puts("glh_find_or_claim: call to glh_resize failed");
+            return 0;
+        }
+
+        glh_probe(table, hash, key, pos);
+    }
+
+    if( *pos == table->size ){
+        puts("glh_find_or_claim: unable to find insertion slot");
+        return 0;
+    }
+
+    if( table->index ){
+        /* our probe left *pos at an empty slot in index,
+         * append to entries, dummies in entries are only dropped by a resize
+         */
+        slot = *pos;
+        *pos = table->n_elems + table->n_dummies;
+
+        /*                  (table, entry,                   hash, key,data) */
+        if( ! glh_entry_init(table, &(table->entries[*pos]), hash, key, data) ){
+            puts("glh_find_or_claim: call to glh_entry_init failed");
+            return 0;
+        }
+
+        table->index[slot] = *pos;
+
+        ++table->n_elems;
+        *created = 1;
+        return 1;
+    }
+
+    if( table->flags & glh_FLAG_ROBINHOOD ){
+        /* *pos may hold a poorer entry, we need a free slot somewhere */
+        if( table->n_elems >= table->size ){
+            puts("glh_find_or_claim: unable to find insertion slot");
+            return 0;
+        }
+
+        /*                  (table, entry,     hash, key,data) */
+        if( ! glh_entry_init(table, &rh_entry, hash, key, data) ){
+            puts("glh_find_or_claim: call to glh_entry_init failed");
+            return 0;
+        }
+
+        rh_entry.dist = glh_distance(glh_table_pos(table, hash, table->size), *pos, table->size);
+
+        /* our entry will land at *pos, displacing anything already there */
+        glh_robinhood_place(table->entries, table->ctrl, table->size, *pos, rh_entry);
+
+        ++table->n_elems;
+        *created = 1;
+        return 1;
+    }
+
+    /* reusing a dummy slot */
+    reusing = table->entries[*pos].state == glh_ENTRY_DUMMY;
+
+    /*                  (table, entry,                   hash, key,data) */
+    if( ! glh_entry_init(table, &(table->entries[*pos]), hash, key, data) ){
+        puts("glh_find_or_claim: call to glh_entry_init failed");
+        return 0;
+    }
+
+    if( reusing && table->n_dummies ){
+        --table->n_dummies;
+    }
+
+    /* keep control byte in sync */
+    glh_ctrl_set(table, *pos);
+
+    /* increment number of elements */
+    ++table->n_elems;
+
+    *created = 1;
+    return 1;
+}
+
+/* 64 bit finaliser used to derive independent values from a hash
+ * for glh_FLAG_FROZEN, unsigned long may be only 32 bits wide
+ */
+uint64_t glh_frozen_mix(uint64_t x){
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* scale the top 32 bits of x into [0, n) without a division
+ * n must fit in 32 bits
+ */
+size_t glh_frozen_range(uint64_t x, size_t n){
+    return (size_t) (((x >> 32) * (uint64_t) n) >> 32);
+}
+
+/* bucket of a frozen table (of n_seeds buckets) hash falls in */
+size_t glh_frozen_bucket(unsigned long int hash, size_t n_seeds){
+    return glh_frozen_range(glh_frozen_mix(hash), n_seeds);
+}
+
+/* slot hash lands in under seed in a frozen table of size slots */
+size_t glh_frozen_pos(unsigned long int hash, uint32_t seed, size_t size){
+    return glh_frozen_range(glh_frozen_mix(hash ^ ((seed + 1ULL) * 0x9e3779b97f4a7c15ULL)), size);
+}
+
+/* the one slot hash can be in within a frozen table */
+size_t glh_frozen_slot(const struct glh_table *table, unsigned long int hash){
+    return glh_frozen_pos(hash, table->seeds[glh_frozen_bucket(hash, table->n_seeds)], table->size);
+}
+
+/* data stored in a mapped slot, either a pointer into the
+ * mapping or the data pointer's own saved value
+ */
+void * glh_map_data(const struct glh_table *table, const struct glh_map_slot *slot){
+    if( slot->data_len ){
+        return (void *) (table->map + slot->data);
+    }
+
+    return (void *) (uintptr_t) slot->data;
+}
+
+/* find key within the slots of a mapped table (glh_FLAG_MAPPED)
+ *
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found
+ */
+unsigned int glh_map_find(const struct glh_table *table, unsigned long int hash, const void *key, void **data){
+    /* position in map_slots */
+    size_t pos = glh_table_pos(table, hash, table->size);
+    /* number of slots probed */
+    size_t n = 0;
+    const struct glh_map_slot *cur = 0;
+
+    for( n=0; n < table->size; ++n ){
+        cur = &(table->map_slots[pos]);
+
+        if( ! cur->key ){
+            return 0;
+        }
+
+        if( cur->hash == (uint64_t) hash && cur->key < table->map_len ){
+            if( ! table->equal_func ){
+                break;
+            }
+
+            glh_STATS_INC(table, equal_calls);
+            if( ! table->equal_func(table->map + cur->key, key) ){
+                break;
+            }
+        }
+
+        if( ++pos == table->size ){
+            pos = 0;
+        }
+    }
+
+    if( n == table->size ){
+        return 0;
+    }
+
+    *data = glh_map_data(table, cur);
+    return 1;
+}
+
+/* find the glh_entry that should be holding this key
+ * using a hash already calculated by the caller
+ *
+ * returns a pointer to it on success
+ * return 0 on failure
+ */
+struct glh_entry * glh_find_entry_hashed(const struct glh_table *table, unsigned long int hash, const void *key){
+    /* position in hash table */
+    size_t pos = 0;
+
+    /* mapped tables have no glh_entry to return, see glh_map_find */
+    if( table->map ){
+        return 0;
+    }
+
+    /* frozen tables hold every key in the one slot it's bucket's seed picks */
+    if( table->seeds ){
+        pos = glh_frozen_slot(table, hash);
+        /* a few slots are left empty */
+        if( table->entries[pos].state != glh_ENTRY_OCCUPIED ){
+            return 0;
+        }
+        return glh_entry_eq(table, &(table->entries[pos]), hash, key) ? &(table->entries[pos]) : 0;
+    }
+
+    if( glh_probe(table, hash, key, &pos) ){
+        return &(table->entries[pos]);
+    }
+
+    /* key may not have been migrated yet */
+    if( table->old_entries ){
+        pos = glh_old_find(table, hash, key);
+        if( pos < table->old_size ){
+            return &(table->old_entries[pos]);
+        }
+    }
+
+    /* failed to find element */
+    return 0;
+}
+
+/* find the glh_entry that should be holding this key
+ *
+ * returns a pointer to it on success
+ * return 0 on failure
+ */
+struct glh_entry * glh_find_entry(const struct glh_table *table, const char *key){
+    if( ! table ){
+        puts("glh_find_entry: table undef");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_find_entry: key undef");
+        return 0;
+    }
+
+    return glh_find_entry_hashed(table, glh_HASH(table, key), key);
+}
+
+
+
+/**********************************************
+ **********************************************
+ **********************************************
+ ******** generic_linear_hash.h implementation ********
+ **********************************************
+ **********************************************
+ ***********************************************/
+
+/* function to return number of elements
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+unsigned int glh_nelems(const struct glh_table *table){
+    if( ! table ){
+        puts("glh_nelems: table was null");
+        return 0;
+    }
+
+    return table->n_elems;
+}
+
+/* function to return number of dummy (deleted) slots
+ * these still have to be probed past until the next resize
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+unsigned int glh_ndummies(const struct glh_table *table){
+    if( ! table ){
+        puts("glh_ndummies: table was null");
+        return 0;
+    }
+
+    return table->n_dummies;
+}
+
+/* is slot i empty, looking at index for compact tables
+ *
+ * returns 1 if empty
+ * returns 0 otherwise
+ */
+unsigned int glh_slot_empty(const struct glh_table *table, size_t i){
+    if( table->map ){
+        return ! table->map_slots[i].key;
+    }
+
+    if( table->index ){
+        return table->index[i] == glh_INDEX_EMPTY;
+    }
+
+    return table->entries[i].state == glh_ENTRY_EMPTY;
+}
+
+/* fill in *stats with the current statistics for table
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_stats(const struct glh_table *table, struct glh_stats *stats){
+    /* iterator through table */
+    size_t i = 0;
+    /* number of slots looked at */
+    size_t n = 0;
+    /* length of the current cluster */
+    size_t run = 0;
+
+    if( ! table ){
+        puts("glh_stats: table was null");
+        return 0;
+    }
+
+    if( ! stats ){
+        puts("glh_stats: stats was null");
+        return 0;
+    }
+
+    if( table->stats ){
+        *stats = *(table->stats);
+        stats->counting = 1;
+    } else {
+        memset(stats, 0, sizeof(struct glh_stats));
+    }
+
+    stats->size      = table->size;
+    stats->n_elems   = table->n_elems;
+    stats->n_dummies = table->n_dummies;
+    stats->longest_cluster = 0;
+
+    /* start just after an empty so no cluster is split by wrapping */
+    for( i=0; i < table->size; ++i ){
+        if( glh_slot_empty(table, i) ){
+            break;
+        }
+    }
+
+    /* no empties, the whole table is one cluster */
+    if( i == table->size ){
+        stats->longest_cluster = table->size;
+        return 1;
+    }
+
+    for( n=0; n < table->size; ++n ){
+        i = (i + 1) % table->size;
+
+        if( glh_slot_empty(table, i) ){
+            run = 0;
+            continue;
+        }
+
+        ++run;
+        if( run > stats->longest_cluster ){
+            stats->longest_cluster = run;
+        }
+    }
+
+    return 1;
+}
+
+/* reset all the counters reported by glh_stats back to 0
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_stats_reset(struct glh_table *table){
+    if( ! table ){
+        puts("glh_stats_reset: table was null");
+        return 0;
+    }
+
+    if( table->stats ){
+        memset(table->stats, 0, sizeof(struct glh_stats));
+    }
+
+    return 1;
+}
+
+/* function to calculate load
+ * (table->n_elems * 10) / table->size
+ *
+ * returns loading factor 0 -> 10 on success
+ * returns 0 on failure
+ */
+unsigned int glh_load(const struct glh_table *table){
+    if( ! table ){
+        puts("glh_load: table was null");
+        return 0;
+    }
+
+    /* here we multiply by 10 to avoid floating point
+     * as we only care about the most significant figure
+     */
+    return (table->n_elems * 10) / table->size;
+}
+
+/* set the load that we resize at
  * load is (table->n_elems * 10) / table->size
  *
- * this sets glh_table->threshold
- * this defaults to glh_DEFAULT_THRESHOLD in generic_linear_hash.c
- * this is set to 6 (meaning 60% full) by default
+ * dummy slots also count towards this threshold, if the
+ * elements and dummies together reach it then an insert will
+ * rebuild the table at it's current size to clear the dummies
+ *
+ * this sets glh_table->threshold
+ * this defaults to glh_DEFAULT_THRESHOLD in generic_linear_hash.c
+ * this is set to 6 (meaning 60% full) by default
+ *
+ * this will accept any value between 1 (10%) to 10 (100%)
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_threshold(struct glh_table *table, unsigned int threshold){
+    if( ! table ){
+        puts("glh_tune_threshold: table was null");
+        return 0;
+    }
+
+    if( threshold < 1 || threshold > 10 ){
+        puts("glh_tune_threshold: threshold must be between 1 and 9 (inclusive)");
+        return 0;
+    }
+
+    if( table->shrink_threshold && threshold < table->shrink_threshold + 2 ){
+        puts("glh_tune_threshold: threshold must be at least 2 above shrink_threshold");
+        return 0;
+    }
+
+    table->threshold = threshold;
+    return 1;
+}
+
+/* set the load below which glh_delete shrinks the table
+ * 0 disables shrinking
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_shrink(struct glh_table *table, unsigned int shrink_threshold){
+    if( ! table ){
+        puts("glh_tune_shrink: table was null");
+        return 0;
+    }
+
+    /* leave room for a target load strictly between the two */
+    if( shrink_threshold && shrink_threshold + 2 > table->threshold ){
+        puts("glh_tune_shrink: shrink_threshold must be at least 2 below threshold");
+        return 0;
+    }
+
+    table->shrink_threshold = shrink_threshold;
+    return 1;
+}
+
+/* enable or disable the control byte array (glh_FLAG_CTRL)
+ *
+ * when enabled probing will scan table->ctrl and only
+ * compare against an entry when it's fingerprint matches
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_ctrl(struct glh_table *table, unsigned int enable){
+    /* flags to restore if the rebuild fails */
+    unsigned int old_flags = 0;
+
+    if( ! table ){
+        puts("glh_tune_ctrl: table was null");
+        return 0;
+    }
+
+    if( enable && (table->flags & glh_FLAG_COMPACT) ){
+        puts("glh_tune_ctrl: cannot enable while glh_FLAG_COMPACT is set");
+        return 0;
+    }
+
+    old_flags = table->flags;
+
+    if( enable ){
+        table->flags |= glh_FLAG_CTRL;
+    } else {
+        table->flags &= ~glh_FLAG_CTRL;
+    }
+
+    /* rebuild at the same size so that ctrl is (de)allocated */
+    if( ! glh_resize(table, table->size) ){
+        puts("glh_tune_ctrl: call to glh_resize failed");
+        table->flags = old_flags;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* enable or disable backward shift deletion (glh_FLAG_BACKSHIFT)
+ *
+ * when enabled glh_delete will shift any later members of the cluster
+ * back into the freed slot rather than leaving a glh_ENTRY_DUMMY
+ * so probes never have to walk past deleted slots
+ *
+ * this can be called at any time, the table will be rebuilt
+ * which also clears out any existing dummies
+ *
+ * this cannot be disabled while glh_FLAG_ROBINHOOD is set
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_backshift(struct glh_table *table, unsigned int enable){
+    /* flags to restore if the rebuild fails */
+    unsigned int old_flags = 0;
+
+    if( ! table ){
+        puts("glh_tune_backshift: table was null");
+        return 0;
+    }
+
+    if( ! enable && (table->flags & glh_FLAG_ROBINHOOD) ){
+        puts("glh_tune_backshift: cannot disable while glh_FLAG_ROBINHOOD is set");
+        return 0;
+    }
+
+    if( enable && (table->flags & glh_FLAG_COMPACT) ){
+        puts("glh_tune_backshift: cannot enable while glh_FLAG_COMPACT is set");
+        return 0;
+    }
+
+    old_flags = table->flags;
+
+    if( enable ){
+        table->flags |= glh_FLAG_BACKSHIFT;
+    } else {
+        table->flags &= ~glh_FLAG_BACKSHIFT;
+    }
+
+    /* rebuild to clear out any existing dummies */
+    if( ! glh_resize(table, table->size) ){
+        puts("glh_tune_backshift: call to glh_resize failed");
+        table->flags = old_flags;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* enable or disable incremental growth (glh_FLAG_INCREMENTAL)
+ *
+ * when enabled an insert which would have triggered glh_resize
+ * instead allocates the larger array and keeps the previous one around,
+ * every following insert and delete then migrates a bounded number
+ * of slots across so no single operation pays for a whole rehash
+ *
+ * an explicit glh_resize will first finish any migration in progress
+ *
+ * disabling will finish any migration in progress
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_incremental(struct glh_table *table, unsigned int enable){
+    if( ! table ){
+        puts("glh_tune_incremental: table was null");
+        return 0;
+    }
+
+    if( enable && (table->flags & glh_FLAG_COMPACT) ){
+        puts("glh_tune_incremental: cannot enable while glh_FLAG_COMPACT is set");
+        return 0;
+    }
+
+    if( enable ){
+        table->flags |= glh_FLAG_INCREMENTAL;
+    } else {
+        table->flags &= ~glh_FLAG_INCREMENTAL;
+        glh_migrate(table, table->old_size);
+    }
+
+    return 1;
+}
+
+/* enable or disable inline keys (glh_FLAG_INLINE)
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_inline(struct glh_table *table, size_t (*key_len_func)(const void *key)){
+    /* iterator through table */
+    size_t i = 0;
+
+    if( ! table ){
+        puts("glh_tune_inline: table was null");
+        return 0;
+    }
+
+    if( ! glh_INLINE_KEY_LEN ){
+        puts("glh_tune_inline: compiled without glh_INLINE_KEY_LEN, slots have no room for keys");
+        return 0;
+    }
+
+    if( key_len_func ){
+        table->key_len_func = key_len_func;
+        table->flags |= glh_FLAG_INLINE;
+    } else {
+        table->flags &= ~glh_FLAG_INLINE;
+        /* still needed by glh_FLAG_OWN_KEYS */
+        if( ! (table->flags & glh_FLAG_OWN_KEYS) ){
+            table->key_len_func = 0;
+        }
+    }
+
+    /* bring every existing slot up to date */
+    for( i=0; i < glh_entries_len(table); ++i ){
+        if( table->entries[i].state == glh_ENTRY_OCCUPIED ){
+            glh_entry_inline(table, &(table->entries[i]));
+        }
+    }
+
+    for( i=0; i < table->old_size; ++i ){
+        if( table->old_entries[i].state == glh_ENTRY_OCCUPIED ){
+            glh_entry_inline(table, &(table->old_entries[i]));
+        }
+    }
+
+    return 1;
+}
+
+/* enable or disable table owned keys (glh_FLAG_OWN_KEYS)
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_own_keys(struct glh_table *table, size_t (*key_len_func)(const void *key)){
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* iterator through entries and then old_entries */
+    size_t i = 0;
+    /* number of entries */
+    size_t len = 0;
+    /* our copy of a key */
+    const char *copy = 0;
+
+    if( ! table ){
+        puts("glh_tune_own_keys: table was null");
+        return 0;
+    }
+
+    if( ! key_len_func ){
+        table->flags &= ~glh_FLAG_OWN_KEYS;
+        /* still needed by glh_FLAG_INLINE */
+        if( ! (table->flags & glh_FLAG_INLINE) ){
+            table->key_len_func = 0;
+        }
+        return 1;
+    }
+
+    table->key_len_func = key_len_func;
+
+    if( table->flags & glh_FLAG_OWN_KEYS ){
+        return 1;
+    }
+
+    /* take copies of any keys we already have
+     * if we run out of memory part way then only some keys are copies,
+     * which is harmless as the copies live until glh_destroy
+     */
+    len = glh_entries_len(table);
+    for( i=0; i < len + table->old_size; ++i ){
+        if( i < len ){
+            cur = &(table->entries[i]);
+        } else {
+            cur = &(table->old_entries[i - len]);
+        }
+
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        copy = glh_arena_copy(table, cur->key);
+        if( ! copy ){
+            puts("glh_tune_own_keys: call to glh_arena_copy failed");
+            return 0;
+        }
+
+        cur->key = copy;
+    }
+
+    table->flags |= glh_FLAG_OWN_KEYS;
+
+    return 1;
+}
+
+/* enable or disable the compact layout (glh_FLAG_COMPACT)
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_compact(struct glh_table *table, unsigned int enable){
+    /* flags to restore if the rebuild fails */
+    unsigned int old_flags = 0;
+
+    if( ! table ){
+        puts("glh_tune_compact: table was null");
+        return 0;
+    }
+
+    if( enable && (table->flags & (glh_FLAG_CTRL | glh_FLAG_BACKSHIFT | glh_FLAG_ROBINHOOD | glh_FLAG_INCREMENTAL)) ){
+        puts("glh_tune_compact: cannot enable alongside glh_FLAG_CTRL, glh_FLAG_BACKSHIFT, glh_FLAG_ROBINHOOD or glh_FLAG_INCREMENTAL");
+        return 0;
+    }
+
+    old_flags = table->flags;
+
+    if( enable ){
+        table->flags |= glh_FLAG_COMPACT;
+    } else {
+        table->flags &= ~glh_FLAG_COMPACT;
+    }
+
+    /* rebuild so that index is (de)allocated */
+    if( ! glh_resize(table, table->size) ){
+        puts("glh_tune_compact: call to glh_resize failed");
+        table->flags = old_flags;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* enable or disable robin hood hashing (glh_FLAG_ROBINHOOD)
+ *
+ * when enabled each entry tracks it's distance from it's home slot,
+ * an insert will displace any entry which is closer to it's home
+ * than the entry being inserted, and a lookup can stop as soon as
+ * it reaches an entry closer to home than the key would be
+ *
+ * this keeps probe lengths short and even, even at a high threshold
+ *
+ * enabling this also enables glh_FLAG_BACKSHIFT
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_robinhood(struct glh_table *table, unsigned int enable){
+    /* flags to restore if the rebuild fails */
+    unsigned int old_flags = 0;
+
+    if( ! table ){
+        puts("glh_tune_robinhood: table was null");
+        return 0;
+    }
+
+    if( enable && (table->flags & glh_FLAG_COMPACT) ){
+        puts("glh_tune_robinhood: cannot enable while glh_FLAG_COMPACT is set");
+        return 0;
+    }
+
+    old_flags = table->flags;
+
+    if( enable ){
+        /* robin hood relies on there being no dummies */
+        table->flags |= glh_FLAG_ROBINHOOD | glh_FLAG_BACKSHIFT;
+    } else {
+        table->flags &= ~glh_FLAG_ROBINHOOD;
+    }
+
+    /* rebuild so that every entry is placed robin hood style */
+    if( ! glh_resize(table, table->size) ){
+        puts("glh_tune_robinhood: call to glh_resize failed");
+        table->flags = old_flags;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* enable or disable power of two sizing (glh_FLAG_POW2)
+ *
+ * when enabled table->size is always kept a power of two
+ * (glh_resize will round any requested size up)
+ * and slots are selected with glh_pos_pow2 rather than glh_pos
+ * avoiding a division on every operation
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_pow2(struct glh_table *table, unsigned int enable){
+    /* flags to restore if the rebuild fails */
+    unsigned int old_flags = 0;
+
+    if( ! table ){
+        puts("glh_tune_pow2: table was null");
+        return 0;
+    }
+
+    old_flags = table->flags;
+
+    if( enable ){
+        table->flags |= glh_FLAG_POW2;
+    } else {
+        table->flags &= ~glh_FLAG_POW2;
+    }
+
+    /* rebuild as every element will now live in a different slot
+     * glh_resize will take care of rounding up our size
+     */
+    if( ! glh_resize(table, table->size) ){
+        puts("glh_tune_pow2: call to glh_resize failed");
+        table->flags = old_flags;
+        return 0;
+    }
+
+    return 1;
+}
+
+/* takes a table and a hash value
+ *
+ * returns the index into the table for this hash
+ * returns 0 on failure (if table is null)
+ *
+ * note the error value is indistinguishable from the 0th bucket
+ * this function can only error if table is null
+ * so the caller can distinguish these 2 cases
+ */
+size_t glh_pos(unsigned long int hash, size_t table_size){
+
+    /* force hash value into a bucket */
+    return hash % table_size;
+}
+
+/* takes a hash value and a table_size which must be a power of two
+ *
+ * the hash is first mixed with a multiplicative (fibonacci) hash
+ * so that weak hash functions still spread out across the low bits
+ * and is then masked down to a slot
+ *
+ * returns the index into the table for this hash
+ */
+size_t glh_pos_pow2(unsigned long int hash, size_t table_size){
+    /* the low bits of a product only depend on the low bits of hash
+     * so fold the high half (which depends on every bit) back down
+     */
+    hash *= glh_FIBONACCI;
+    hash ^= hash >> glh_FIBONACCI_FOLD;
+
+    return hash & (table_size - 1);
+}
+
+/* select one of a power of two number of stripes or shards
+ * from the top bits of hash, shift leaves just those bits
+ *
+ * the same fibonacci mix as glh_pos_pow2, whose top bits
+ * depend on every bit of hash (not every hash_func spreads
+ * it's own top bits), the low bits are left for the slot
+ */
+size_t glh_pos_top(unsigned long int hash, unsigned int shift){
+    return (hash * glh_FIBONACCI) >> shift;
+}
+
+/* allocate and initialise a new glh_table of size slots
+ * shared by all the glh_new variants
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new_sized(
+        size_t size,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b),
+        const struct glh_allocator *allocator
+    ){
+
+    struct glh_table *sht = 0;
+    /* default allocator if none was supplied */
+    struct glh_allocator default_allocator;
+
+    if( ! hash_func ){
+        puts("glh_new: hash_func was undef");
+        return 0;
+    }
+
+    if( ! allocator ){
+        default_allocator.alloc   = glh_default_alloc;
+        default_allocator.zalloc  = glh_default_zalloc;
+        default_allocator.dealloc = glh_default_dealloc;
+        default_allocator.ctx     = 0;
+        allocator = &default_allocator;
+    }
+
+    if( ! allocator->alloc || ! allocator->zalloc || ! allocator->dealloc ){
+        puts("glh_new: allocator is missing a function");
+        return 0;
+    }
+
+    /* alloc */
+    sht = glh_alloc_array(allocator, 1, sizeof(struct glh_table), 1);
+    if( ! sht ){
+        puts("glh_new: call to glh_alloc_array failed");
+        return 0;
+    }
+
+    /* init */
+    if( ! glh_init_with_allocator(sht, size, hash_func, equal_func, allocator) ){
+        puts("glh_new: call to glh_init_with_allocator failed");
+        /* make sure to free our allocate glh_table */
+        glh_free_array(allocator, sht, 1, sizeof(struct glh_table));
+        return 0;
+    }
+
+    return sht;
+}
+
+/* allocate and initialise a new glh_table
+ *
+ * will automatically assume a size of 32
+ *
+ * glh_table will automatically resize when a call to
+ * glh_insert detects the load factor is over table->threshold
+ *
+ * takes a mandatory hashing function used to hash a key
+ * takes an optional equality function used to deal with hash
+ * collisions where
+ *  hash(a) == hash(b) and a != b
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new(
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    return glh_new_with_allocator(hash_func, equal_func, 0);
+}
+
+/* as glh_new but all of the table's memory comes from allocator
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new_with_allocator(
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b),
+        const struct glh_allocator *allocator
+    ){
+
+    return glh_new_sized(glh_DEFAULT_SIZE, hash_func, equal_func, allocator);
+}
+
+/* allocate and initialise a new glh_table with room for n elements
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new_with_capacity(
+        size_t n,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    /* number of slots needed for n elements */
+    size_t size = glh_capacity_size(n, glh_DEFAULT_THRESHOLD);
+
+    if( ! size ){
+        puts("glh_new_with_capacity: n is too large");
+        return 0;
+    }
+
+    /* never start smaller than a default table */
+    if( size < glh_DEFAULT_SIZE ){
+        size = glh_DEFAULT_SIZE;
+    }
+
+    return glh_new_sized(size, hash_func, equal_func, 0);
+}
+
+/* free an existing glh_table
+ * this will free all the sh entries stored
+ * this will free all the keys copied under glh_tune_own_keys
+ *
+ * this will only free the *table pointer if `free_table` is set to 1
+ * this will only free the *data pointers if `free_data` is set to 1
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_destroy(struct glh_table *table, unsigned int free_table, unsigned int free_data){
+    /* iterator through table */
+    size_t i = 0;
+    /* allocator table came from */
+    struct glh_allocator allocator;
+
+    if( ! table ){
+        puts("glh_destroy: table undef");
+        return 0;
+    }
+
+    /* iterate through `entries` list
+     * calling glh_entry_destroy on each
+     */
+    for( i=0; i < glh_entries_len(table); ++i ){
+        if( ! glh_entry_destroy( &(table->entries[i]), free_data ) ){
+            puts("glh_destroy: call to glh_entry_destroy failed, continuing...");
+        }
+    }
+
+    /* free entires table */
+    glh_free_array(&(table->allocator), table->entries, glh_entries_len(table), sizeof(struct glh_entry));
+
+    /* free control bytes, this may be null */
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+
+    /* free compact index, this may be null */
+    glh_free_array(&(table->allocator), table->index, table->size, sizeof(unsigned int));
+
+    /* anything not yet migrated by an incremental grow */
+    if( table->old_entries ){
+        for( i=0; i < table->old_size; ++i ){
+            if( ! glh_entry_destroy( &(table->old_entries[i]), free_data ) ){
+                puts("glh_destroy: call to glh_entry_destroy failed, continuing...");
+            }
+        }
+        glh_free_array(&(table->allocator), table->old_entries, table->old_size, sizeof(struct glh_entry));
+    }
+
+    /* every key we copied */
+    glh_arena_destroy(table);
+
+    /* only if glh_FLAG_FROZEN */
+    glh_free_array(&(table->allocator), table->seeds, table->n_seeds, sizeof(uint32_t));
+
+    /* a mapped table's allocator knows how to release it's mapping */
+    if( table->map ){
+        table->allocator.dealloc(table->allocator.ctx, (void *) table->map, table->map_len);
+    }
+
+    /* only allocated when compiled with glh_STATS */
+    glh_free_array(&(table->allocator), table->stats, 1, sizeof(struct glh_stats));
+
+    /* finally free table if asked to
+     * copying the allocator out first as it lives inside table
+     */
+    if( free_table ){
+        allocator = table->allocator;
+        glh_free_array(&allocator, table, 1, sizeof(struct glh_table));
+    }
+
+    return 1;
+}
+
+/* initialise an already allocated glh_table to size size
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_init(
+        struct glh_table *table,
+        size_t size,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    return glh_init_with_allocator(table, size, hash_func, equal_func, 0);
+}
+
+/* as glh_init but all of the table's memory comes from allocator
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_init_with_allocator(
+        struct glh_table *table,
+        size_t size,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b),
+        const struct glh_allocator *allocator
+    ){
+
+    if( ! table ){
+        puts("glh_init: table undef");
+        return 0;
+    }
+
+    if( allocator && ( ! allocator->alloc || ! allocator->zalloc || ! allocator->dealloc ) ){
+        puts("glh_init: allocator is missing a function");
+        return 0;
+    }
+
+    if( size == 0 ){
+        puts("glh_init: specified size of 0, impossible");
+        return 0;
+    }
+
+    if( ! hash_func ){
+        puts("glh_init: hash_func undef");
+        return 0;
+    }
+
+    table->size       = size;
+    table->n_elems    = 0;
+    table->n_dummies  = 0;
+    table->threshold  = glh_DEFAULT_THRESHOLD;
+    table->shrink_threshold = 0;
+    table->hash_func  = hash_func;
+    table->equal_func = equal_func;
+    table->flags      = 0;
+    table->ctrl       = 0;
+    table->index      = 0;
+    table->entries_size = 0;
+    table->key_len_func = 0;
+    table->arena        = 0;
+    table->map          = 0;
+    table->map_len      = 0;
+    table->map_slots    = 0;
+    table->seeds        = 0;
+    table->n_seeds      = 0;
+
+    table->old_entries = 0;
+    table->old_size    = 0;
+    table->migrate_pos = 0;
+    table->stats       = 0;
+
+    if( allocator ){
+        table->allocator = *allocator;
+    } else {
+        table->allocator.alloc   = glh_default_alloc;
+        table->allocator.zalloc  = glh_default_zalloc;
+        table->allocator.dealloc = glh_default_dealloc;
+        table->allocator.ctx     = 0;
+    }
+
+    /* calloc our buckets (pointer to glh_entry) */
+    table->entries = glh_alloc_array(&(table->allocator), size, sizeof(struct glh_entry), 1);
+    if( ! table->entries ){
+        puts("glh_init: call to glh_alloc_array failed");
+        return 0;
+    }
+
+#ifdef glh_STATS
+    table->stats = glh_alloc_array(&(table->allocator), 1, sizeof(struct glh_stats), 1);
+    if( ! table->stats ){
+        puts("glh_init: call to glh_alloc_array failed");
+        glh_free_array(&(table->allocator), table->entries, size, sizeof(struct glh_entry));
+        table->entries = 0;
+        return 0;
+    }
+#endif
+
+    return 1;
+}
+
+/* rebuild table with a compact layout of new_size slots
+ * live entries are packed to the front of a new entries array
+ * in their existing order, dropping any dummies
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_compact_rebuild(struct glh_table *table, size_t new_size){
+    /* our new packed entries */
+    struct glh_entry *new_entries = 0;
+    /* our new index */
+    unsigned int *new_index = 0;
+    /* number of entries we have room for */
+    size_t new_entries_size = 0;
+    /* number of entries in the current layout */
+    size_t old_len = 0;
+    /* the current entry we are copying across */
+    struct glh_entry *cur = 0;
+    /* our iterator through the old entries */
+    size_t i = 0;
+    /* our slot within new_index */
+    size_t j = 0;
+    /* number of entries packed so far */
+    size_t n = 0;
+
+    new_entries_size = glh_compact_entries_size(new_size, table->threshold, table->n_elems);
+    old_len = glh_entries_len(table);
+
+    if( new_entries_size >= glh_INDEX_DUMMY ){
+        puts("glh_compact_rebuild: too many entries for index");
+        return 0;
+    }
+
+    new_entries = glh_alloc_array(&(table->allocator), new_entries_size, sizeof(struct glh_entry), 1);
+    if( ! new_entries ){
+        puts("glh_compact_rebuild: call to glh_alloc_array failed");
+        return 0;
+    }
+
+    new_index = glh_alloc_array(&(table->allocator), new_size, sizeof(unsigned int), 0);
+    if( ! new_index ){
+        puts("glh_compact_rebuild: call to glh_alloc_array failed");
+        glh_free_array(&(table->allocator), new_entries, new_entries_size, sizeof(struct glh_entry));
+        return 0;
+    }
+
+    /* glh_INDEX_EMPTY is all bits set */
+    memset(new_index, 0xff, new_size * sizeof(unsigned int));
+
+    for( i=0; i < old_len; ++i ){
+        cur = &(table->entries[i]);
+
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        /* first empty slot, new_size > n_elems so there is always one */
+        for( j = glh_table_pos(table, cur->hash, new_size); new_index[j] != glh_INDEX_EMPTY; ){
+            ++j;
+            if( j == new_size ){
+                j = 0;
+            }
+        }
+
+        /* this also brings any inline key along */
+        new_entries[n] = *cur;
+        new_entries[n].dist = 0;
+        new_index[j] = n;
+        ++n;
+    }
+
+    /* free old data */
+    glh_free_array(&(table->allocator), table->entries, old_len, sizeof(struct glh_entry));
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+    glh_free_array(&(table->allocator), table->index, table->size, sizeof(unsigned int));
+
+    /* swap */
+    table->size = new_size;
+    table->entries = new_entries;
+    table->entries_size = new_entries_size;
+    table->index = new_index;
+    table->ctrl = 0;
+
+    return 1;
+}
+
+/* resize an existing table to new_size
+ * this will reshuffle all the buckets around
  *
- * this will accept any value between 1 (10%) to 10 (100%)
+ * you can use this to make a hash larger or smaller
+ *
+ * if glh_FLAG_POW2 is set then new_size will be rounded up
+ * to the next power of two
+ *
+ * if an incremental grow is in progress it will be finished first
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_resize(struct glh_table *table, size_t new_size){
+    /* our new data area */
+    struct glh_entry *new_entries = 0;
+    /* our new control bytes, only if glh_FLAG_CTRL */
+    unsigned char *new_ctrl = 0;
+    /* the current entry we are copying across */
+    struct glh_entry *cur = 0;
+    /* our iterator through the old hash */
+    size_t i = 0;
+    /* our iterator through the new data */
+    size_t j = 0;
+    /* our new position for each element */
+    size_t new_pos = 0;
+    /* entry being moved when robin hood hashing */
+    struct glh_entry rh_entry;
+#ifdef glh_STATS
+    /* processor time at start and length of this resize */
+    clock_t start = clock();
+    unsigned long int usec = 0;
+#endif
+
+    if( ! table ){
+        puts("glh_resize: table was null");
+        return 0;
+    }
+
+    if( new_size == 0 ){
+        puts("glh_resize: asked for new_size of 0, impossible");
+        return 0;
+    }
+
+    if( table->map ){
+        puts("glh_resize: table is a read only mapping");
+        return 0;
+    }
+
+    if( table->seeds ){
+        puts("glh_resize: table is frozen");
+        return 0;
+    }
+
+    /* power of two tables round up to the next power of two */
+    if( table->flags & glh_FLAG_POW2 ){
+        new_size = glh_round_pow2(new_size);
+    }
+
+    if( new_size <= table->n_elems ){
+        puts("glh_resize: asked for new_size smaller than number of existing elements, impossible");
+        return 0;
+    }
+
+    /* finish any incremental grow so everything is in entries */
+    glh_migrate(table, table->old_size);
+
+    /* compact tables keep entries in order and only rebuild index */
+    if( table->flags & glh_FLAG_COMPACT ){
+        if( ! glh_compact_rebuild(table, new_size) ){
+            puts("glh_resize: call to glh_compact_rebuild failed");
+            return 0;
+        }
+        goto glh_RESIZE_DONE;
+    }
+
+    if( ! glh_alloc_slots(table, new_size, &new_entries, &new_ctrl) ){
+        puts("glh_resize: call to glh_alloc_slots failed");
+        return 0;
+    }
+
+    /* iterate through old data, this may be a compact layout we are leaving */
+    for( i=0; i < glh_entries_len(table); ++i ){
+        cur = &(table->entries[i]);
+
+        /* if we are not occupied then skip */
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        /* our position within new entries */
+        new_pos = glh_table_pos(table, cur->hash, new_size);
+
+        /* robin hood tables must keep clusters ordered */
+        if( table->flags & glh_FLAG_ROBINHOOD ){
+            rh_entry = *cur;
+            rh_entry.dist = 0;
+            glh_robinhood_place(new_entries, new_ctrl, new_size, new_pos, rh_entry);
+            continue;
+        }
+
+        for( j = new_pos; j < new_size; ++ j){
+            /* skip if not empty */
+            if( new_entries[j].state != glh_ENTRY_EMPTY ){
+                continue;
+            }
+            goto glh_RESIZE_FOUND;
+        }
+
+        for( j = 0; j < new_pos; ++ j){
+            /* skip if not empty */
+            if( new_entries[j].state != glh_ENTRY_EMPTY ){
+                continue;
+            }
+            goto glh_RESIZE_FOUND;
+        }
+
+        puts("glh_resize: failed to find spot for new element!");
+        /* make sure to free our new_entries since we don't store them
+         * no need to free items in as they are still held in our old elems
+         */
+        glh_free_array(&(table->allocator), new_entries, new_size, sizeof(struct glh_entry));
+        glh_free_array(&(table->allocator), new_ctrl, new_size, 1);
+        return 0;
+
+glh_RESIZE_FOUND:
+        /* this also brings any inline key along */
+        new_entries[j] = *cur;
+
+        if( new_ctrl ){
+            new_ctrl[j] = glh_ctrl_fingerprint(cur->hash);
+        }
+    }
+
+    /* free old data */
+    glh_free_array(&(table->allocator), table->entries, glh_entries_len(table), sizeof(struct glh_entry));
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+    glh_free_array(&(table->allocator), table->index, table->size, sizeof(unsigned int));
+
+    /* swap */
+    table->size = new_size;
+    table->entries = new_entries;
+    table->ctrl = new_ctrl;
+    table->index = 0;
+    table->entries_size = 0;
+
+glh_RESIZE_DONE:
+    /* dummies are never copied across */
+    table->n_dummies = 0;
+
+#ifdef glh_STATS
+    if( table->stats ){
+        usec = (clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+        ++table->stats->n_resizes;
+        table->stats->resize_usec += usec;
+        if( usec > table->stats->resize_max_usec ){
+            table->stats->resize_max_usec = usec;
+        }
+    }
+#endif
+
+    return 1;
+}
+
+/* make room for n elements in total without any further resizing
+ * at the current threshold
+ *
+ * this will never shrink the table
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_reserve(struct glh_table *table, size_t n){
+    /* number of slots needed for n elements */
+    size_t size = 0;
+
+    if( ! table ){
+        puts("glh_reserve: table was null");
+        return 0;
+    }
+
+    size = glh_capacity_size(n, table->threshold);
+    if( ! size ){
+        puts("glh_reserve: n is too large");
+        return 0;
+    }
+
+    /* already big enough */
+    if( size <= table->size ){
+        return 1;
+    }
+
+    if( ! glh_resize(table, size) ){
+        puts("glh_reserve: call to glh_resize failed");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* check if the supplied key already exists in this hash
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_exists(const struct glh_table *table, const char *key){
+    if( ! table ){
+        puts("glh_exists: table undef");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_exists: key undef");
+        return 0;
+    }
+
+    return glh_exists_hashed(table, glh_HASH(table, key), key);
+}
+
+/* as glh_exists but using a hash already calculated by the caller
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_exists_hashed(const struct glh_table *table, unsigned long int hash, const char *key){
+    struct glh_entry *she = 0;
+    /* data of a mapped key, unused */
+    void *data = 0;
+
+    if( ! table ){
+        puts("glh_exists_hashed: table undef");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_exists_hashed: key undef");
+        return 0;
+    }
+
+#ifdef DEBUG
+    printf("glh_exist: called with key '%s', dispatching to glh_find_entry_hashed\n", key);
+#endif
+
+    if( table->map ){
+        return glh_map_find(table, hash, key, &data);
+    }
+
+    /* find entry */
+    she = glh_find_entry_hashed(table, hash, key);
+    if( ! she ){
+        /* not found */
+        return 0;
+    }
+
+    /* found */
+    return 1;
+}
+
+/* insert `data` under `key`
+ * this will only success if !glh_exists(table, key)
  *
  * returns 1 on success
  * returns 0 on failure
  */
-unsigned int glh_tune_threshold(struct glh_table *table, unsigned int threshold){
+unsigned int glh_insert(struct glh_table *table, const char *key, void *data){
     if( ! table ){
-        puts("glh_tune_threshold: table was null");
+        puts("glh_insert: table undef");
         return 0;
     }
 
-    if( threshold < 1 || threshold > 10 ){
-        puts("glh_tune_threshold: threshold must be between 1 and 9 (inclusive)");
+    if( ! key ){
+        puts("glh_insert: key undef");
         return 0;
     }
 
-    table->threshold = threshold;
-    return 1;
+    return glh_insert_hashed(table, glh_HASH(table, key), key, data);
 }
 
-/* takes a table and a hash value
+/* as glh_insert but using a hash already calculated by the caller
  *
- * returns the index into the table for this hash
- * returns 0 on failure (if table is null)
- *
- * note the error value is indistinguishable from the 0th bucket
- * this function can only error if table is null
- * so the caller can distinguish these 2 cases
+ * returns 1 on success
+ * returns 0 on failure
  */
-size_t glh_pos(unsigned long int hash, size_t table_size){
+unsigned int glh_insert_hashed(struct glh_table *table, unsigned long int hash, const char *key, void *data){
+    /* position in hash table */
+    size_t pos = 0;
+    /* was a new slot created */
+    unsigned int created = 0;
 
-    /* force hash value into a bucket */
-    return hash % table_size;
+    if( ! table ){
+        puts("glh_insert_hashed: table undef");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_insert_hashed: key undef");
+        return 0;
+    }
+
+#ifdef DEBUG
+    printf("glh_insert: asked to insert for key '%s'\n", key);
+#endif
+
+    /* we allow data to be 0 */
+
+    if( ! glh_find_or_claim(table, hash, key, data, &pos, &created) ){
+        puts("glh_insert_hashed: call to glh_find_or_claim failed");
+        return 0;
+    }
+
+    /* insert only works if the key is not already present */
+    if( ! created ){
+        puts("glh_insert_hashed: key already exists in table");
+        return 0;
+    }
+
+    /* return success */
+    return 1;
 }
 
-/* allocate and initialise a new glh_table
+/* find `key` or insert it with data of 0
+ * this only hashes and probes once (twice if a resize was triggered)
  *
- * will automatically assume a size of 32
+ * *created is set to 1 if key was newly inserted, otherwise 0
  *
- * glh_table will automatically resize when a call to
- * glh_insert detects the load factor is over table->threshold
+ * the returned pointer is only valid until the next
+ * insert, delete or resize on this table
  *
- * takes a mandatory hashing function used to hash a key
- * takes an optional equality function used to deal with hash
- * collisions where
- *  hash(a) == hash(b) and a != b
+ * returns a pointer to key's data on success
+ * returns 0 on failure
+ */
+void ** glh_find_or_insert(struct glh_table *table, const char *key, unsigned int *created){
+    if( ! table ){
+        puts("glh_find_or_insert: table undef");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_find_or_insert: key undef");
+        return 0;
+    }
+
+    return glh_find_or_insert_hashed(table, glh_HASH(table, key), key, created);
+}
+
+/* as glh_find_or_insert but using a hash already calculated by the caller
  *
- * returns pointer on success
+ * returns a pointer to key's data on success
  * returns 0 on failure
  */
-struct glh_table * glh_new(
-        unsigned long int (*hash_func)(const void *key),
-        unsigned int (*equal_func)(const void *a, const void *b)
-    ){
+void ** glh_find_or_insert_hashed(struct glh_table *table, unsigned long int hash, const char *key, unsigned int *created){
+    /* position in hash table */
+    size_t pos = 0;
 
-    struct glh_table *sht = 0;
+    if( ! table ){
+        puts("glh_find_or_insert_hashed: table undef");
+        return 0;
+    }
 
-    if( ! hash_func ){
-        puts("glh_new: hash_func was undef");
+    if( ! key ){
+        puts("glh_find_or_insert_hashed: key undef");
         return 0;
     }
 
-    /* alloc */
-    sht = calloc(1, sizeof(struct glh_table));
-    if( ! sht ){
-        puts("glh_new: calloc failed");
+    if( ! created ){
+        puts("glh_find_or_insert_hashed: created undef");
         return 0;
     }
 
-    /* init */
-    if( ! glh_init(sht, glh_DEFAULT_SIZE, hash_func, equal_func) ){
-        puts("glh_new: call to glh_init failed");
-        /* make sure to free our allocate glh_table */
-        free(sht);
+    if( ! glh_find_or_claim(table, hash, key, 0, &pos, created) ){
+        puts("glh_find_or_insert_hashed: call to glh_find_or_claim failed");
         return 0;
     }
 
-    return sht;
+    return &(table->entries[pos].data);
 }
 
-/* free an existing glh_table
- * this will free all the sh entries stored
- * this will free all the keys (as they are strdup-ed)
- *
- * this will only free the *table pointer if `free_table` is set to 1
- * this will only free the *data pointers if `free_data` is set to 1
+/* set `data` under `key`
+ * this will only succeed if glh_exists(table, key)
  *
- * returns 1 on success
+ * returns old data on success
  * returns 0 on failure
  */
-unsigned int glh_destroy(struct glh_table *table, unsigned int free_table, unsigned int free_data){
-    /* iterator through table */
-    size_t i = 0;
-
+void * glh_set(struct glh_table *table, const char *key, void *data){
     if( ! table ){
-        puts("glh_destroy: table undef");
+        puts("glh_set: table undef");
         return 0;
     }
 
-    /* iterate through `entries` list
-     * calling glh_entry_destroy on each
-     */
-    for( i=0; i < table->size; ++i ){
-        if( ! glh_entry_destroy( &(table->entries[i]), free_data ) ){
-            puts("glh_destroy: call to glh_entry_destroy failed, continuing...");
-        }
-    }
-
-    /* free entires table */
-    free(table->entries);
-
-    /* finally free table if asked to */
-    if( free_table ){
-        free(table);
+    if( ! key ){
+        puts("glh_set: key undef");
+        return 0;
     }
 
-    return 1;
+    return glh_set_hashed(table, glh_HASH(table, key), key, data);
 }
 
-/* initialise an already allocated glh_table to size size
+/* as glh_set but using a hash already calculated by the caller
  *
- * returns 1 on success
+ * returns old data on success
  * returns 0 on failure
  */
-unsigned int glh_init(
-        struct glh_table *table,
-        size_t size,
-        unsigned long int (*hash_func)(const void *key),
-        unsigned int (*equal_func)(const void *a, const void *b)
-    ){
+void * glh_set_hashed(struct glh_table *table, unsigned long int hash, const char *key, void *data){
+    struct glh_entry *she = 0;
+    void * old_data = 0;
 
     if( ! table ){
-        puts("glh_init: table undef");
+        puts("glh_set_hashed: table undef");
         return 0;
     }
 
-    if( size == 0 ){
-        puts("glh_init: specified size of 0, impossible");
+    if( ! key ){
+        puts("glh_set_hashed: key undef");
         return 0;
     }
 
-    if( ! hash_func ){
-        puts("glh_init: hash_func undef");
+    /* allow data to be null */
+
+    if( table->map ){
+        puts("glh_set_hashed: table is a read only mapping");
         return 0;
     }
 
-    table->size       = size;
-    table->n_elems    = 0;
-    table->threshold  = glh_DEFAULT_THRESHOLD;
-    table->hash_func  = hash_func;
-    table->equal_func = equal_func;
+    if( table->seeds ){
+        puts("glh_set_hashed: table is frozen");
+        return 0;
+    }
 
-    /* calloc our buckets (pointer to glh_entry) */
-    table->entries = calloc(size, sizeof(struct glh_entry));
-    if( ! table->entries ){
-        puts("glh_init: calloc failed");
+    /* find entry */
+    she = glh_find_entry_hashed(table, hash, key);
+    if( ! she ){
+        /* not found */
         return 0;
     }
 
-    return 1;
+    /* save old data */
+    old_data = she->data;
+
+    /* overwrite */
+    she->data = data;
+
+    /* return old data */
+    return old_data;
 }
 
-/* resize an existing table to new_size
- * this will reshuffle all the buckets around
- *
- * you can use this to make a hash larger or smaller
+/* get `data` stored under `key`
  *
- * returns 1 on success
+ * returns data on success
  * returns 0 on failure
  */
-unsigned int glh_resize(struct glh_table *table, size_t new_size){
-    /* our new data area */
-    struct glh_entry *new_entries = 0;
-    /* the current entry we are copying across */
-    struct glh_entry *cur = 0;
-    /* our iterator through the old hash */
-    size_t i = 0;
-    /* our iterator through the new data */
-    size_t j = 0;
-    /* our new position for each element */
-    size_t new_pos = 0;
-
+void * glh_get(const struct glh_table *table, const char *key){
     if( ! table ){
-        puts("glh_resize: table was null");
+        puts("glh_get: table undef");
         return 0;
     }
 
-    if( new_size == 0 ){
-        puts("glh_resize: asked for new_size of 0, impossible");
+    if( ! key ){
+        puts("glh_get: key undef");
         return 0;
     }
 
-    if( new_size <= table->n_elems ){
-        puts("glh_resize: asked for new_size smaller than number of existing elements, impossible");
+    return glh_get_hashed(table, glh_HASH(table, key), key);
+}
+
+/* as glh_get but using a hash already calculated by the caller
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_get_hashed(const struct glh_table *table, unsigned long int hash, const char *key){
+    struct glh_entry *she = 0;
+    /* data of a mapped key */
+    void *data = 0;
+
+    if( ! table ){
+        puts("glh_get_hashed: table undef");
         return 0;
     }
 
-    /* allocate an array of glh_entry */
-    new_entries = calloc(new_size, sizeof(struct glh_entry));
-    if( ! new_entries ){
-        puts("glh_resize: call to calloc failed");
+    if( ! key ){
+        puts("glh_get_hashed: key undef");
         return 0;
     }
 
-    /* iterate through old data */
-    for( i=0; i < table->size; ++i ){
-        cur = &(table->entries[i]);
-
-        /* if we are not occupied then skip */
-        if( cur->state != glh_ENTRY_OCCUPIED ){
-            continue;
-        }
-
-        /* our position within new entries */
-        new_pos = glh_pos(cur->hash, new_size);
+    if( table->map ){
+        glh_map_find(table, hash, key, &data);
+        return data;
+    }
 
-        for( j = new_pos; j < new_size; ++ j){
-            /* skip if not empty */
-            if( new_entries[j].state != glh_ENTRY_EMPTY ){
-                continue;
-            }
-            goto glh_RESIZE_FOUND;
-        }
+    /* find entry */
+    she = glh_find_entry_hashed(table, hash, key);
+    if( ! she ){
+        /* not found */
+        return 0;
+    }
 
-        for( j = 0; j < new_pos; ++ j){
-            /* skip if not empty */
-            if( new_entries[j].state != glh_ENTRY_EMPTY ){
-                continue;
-            }
-            goto glh_RESIZE_FOUND;
-        }
+    /* found */
+    return she->data;
+}
 
-        puts("glh_resize: failed to find spot for new element!");
-        /* make sure to free our new_entries since we don't store them
-         * no need to free items in as they are still held in our old elems
-         */
-        free(new_entries);
+/* get `data` stored under `key` into *data
+ *
+ * unlike glh_get this allows a stored data of 0
+ * to be told apart from a missing key
+ *
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found or on failure, *data is untouched
+ */
+unsigned int glh_try_get(const struct glh_table *table, const char *key, void **data){
+    if( ! table ){
+        puts("glh_try_get: table undef");
         return 0;
-
-glh_RESIZE_FOUND:
-        new_entries[j].hash    = cur->hash;
-        new_entries[j].key     = cur->key;
-        new_entries[j].data    = cur->data;
-        new_entries[j].state   = cur->state;
     }
 
-    /* free old data */
-    free(table->entries);
-
-    /* swap */
-    table->size = new_size;
-    table->entries = new_entries;
+    if( ! key ){
+        puts("glh_try_get: key undef");
+        return 0;
+    }
 
-    return 1;
+    return glh_try_get_hashed(table, glh_HASH(table, key), key, data);
 }
 
-/* check if the supplied key already exists in this hash
+/* as glh_try_get but using a hash already calculated by the caller
  *
- * returns 1 on success (key exists)
- * returns 0 if key doesn't exist or on failure
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found or on failure, *data is untouched
  */
-unsigned int glh_exists(const struct glh_table *table, const char *key){
+unsigned int glh_try_get_hashed(const struct glh_table *table, unsigned long int hash, const char *key, void **data){
     struct glh_entry *she = 0;
 
     if( ! table ){
-        puts("glh_exists: table undef");
+        puts("glh_try_get_hashed: table undef");
         return 0;
     }
 
     if( ! key ){
-        puts("glh_exists: key undef");
+        puts("glh_try_get_hashed: key undef");
         return 0;
     }
 
-#ifdef DEBUG
-    printf("glh_exist: called with key '%s', dispatching to glh_find_entry\n", key);
-#endif
+    if( ! data ){
+        puts("glh_try_get_hashed: data undef");
+        return 0;
+    }
+
+    if( table->map ){
+        return glh_map_find(table, hash, key, data);
+    }
 
     /* find entry */
-    she = glh_find_entry(table, key);
+    she = glh_find_entry_hashed(table, hash, key);
     if( ! she ){
         /* not found */
         return 0;
     }
 
-    /* found */
+    *data = she->data;
     return 1;
 }
 
-/* insert `data` under `key`
- * this will only success if !glh_exists(table, key)
+/* shared implementation of glh_get_batch and glh_exists_batch
  *
- * returns 1 on success
- * returns 0 on failure
+ * works through keys a group of glh_BATCH_SIZE at a time,
+ * first hashing the whole group and prefetching each home slot
+ * and then probing each in turn, by which point the first
+ * slots should have arrived in cache
+ *
+ * either of data_out or exists_out may be null
+ *
+ * returns number of keys found
  */
-unsigned int glh_insert(struct glh_table *table, const char *key, void *data){
-    /* our new entry */
+size_t glh_batch(const struct glh_table *table, const char **keys, size_t n, void **data_out, unsigned int *exists_out){
+    /* hashes for the current group */
+    unsigned long int hashes[glh_BATCH_SIZE];
+    /* found entry */
     struct glh_entry *she = 0;
-    /* hash */
-    unsigned long int hash = 0;
-    /* position in hash table */
-    size_t pos = 0;
-    /* iterator through table */
+    /* was the current key found, and it's data */
+    unsigned int hit = 0;
+    void *data = 0;
+    /* start of current group */
+    size_t start = 0;
+    /* size of current group */
+    size_t count = 0;
+    /* iterator through group */
     size_t i = 0;
-    /* cached strlen */
+    /* home slot of a key */
+    size_t pos = 0;
+    /* number of keys found */
+    size_t found = 0;
 
-    if( ! table ){
-        puts("glh_insert: table undef");
-        return 0;
-    }
+    for( start=0; start < n; start += count ){
+        count = n - start;
+        if( count > glh_BATCH_SIZE ){
+            count = glh_BATCH_SIZE;
+        }
 
-    if( ! key ){
-        puts("glh_insert: key undef");
-        return 0;
-    }
+        /* hash and prefetch */
+        for( i=0; i < count; ++i ){
+            hashes[i] = glh_HASH(table, keys[start + i]);
+            pos = glh_table_pos(table, hashes[i], table->size);
 
-#ifdef DEBUG
-    printf("glh_insert: asked to insert for key '%s'\n", key);
-#endif
+            if( table->ctrl ){
+                glh_PREFETCH(&(table->ctrl[pos]));
+            }
+            if( table->seeds ){
+                glh_PREFETCH(&(table->seeds[glh_frozen_bucket(hashes[i], table->n_seeds)]));
+            } else if( table->map ){
+                glh_PREFETCH(&(table->map_slots[pos]));
+            } else if( table->index ){
+                glh_PREFETCH(&(table->index[pos]));
+            } else {
+                glh_PREFETCH(&(table->entries[pos]));
+            }
+        }
 
-    /* we allow data to be 0 */
+        /* a frozen table's slot is only known once it's seed has arrived */
+        for( i=0; table->seeds && i < count; ++i ){
+            glh_PREFETCH(&(table->entries[glh_frozen_slot(table, hashes[i])]));
+        }
 
-#ifdef DEBUG
-    puts("glh_insert: calling glh_exists");
-#endif
+        /* probe */
+        for( i=0; i < count; ++i ){
+            data = 0;
+
+            if( table->map ){
+                hit = glh_map_find(table, hashes[i], keys[start + i], &data);
+            } else {
+                she = glh_find_entry_hashed(table, hashes[i], keys[start + i]);
+                hit = she != 0;
+                if( she ){
+                    data = she->data;
+                }
+            }
 
-    /* check for already existing key
-     * insert only works if the key is not already present
-     */
-    if( glh_exists(table, key) ){
-        puts("glh_insert: key already exists in table");
-        return 0;
-    }
+            found += hit;
 
-    /* determine if we have to resize
-     * note we are checking the load before the insert
-     */
-    if( glh_load(table) >= table->threshold ){
-        if( ! glh_resize(table, table->size * glh_SCALING_FACTOR) ){
-            puts("glh_insert: call to glh_resize failed");
-            return 0;
+            if( data_out ){
+                data_out[start + i] = data;
+            }
+
+            if( exists_out ){
+                exists_out[start + i] = hit;
+            }
         }
     }
 
-    /* calculate hash */
-    hash = table->hash_func(key);
+    return found;
+}
 
-    /* calculate pos
-     * we know table is defined here
-     * so glh_pos cannot fail
-     */
-    pos = glh_pos(hash, table->size);
+/* look up n keys at once storing the result for keys[i] in out[i]
+ *
+ * all the keys in a group are hashed and their slots prefetched
+ * before any are probed, so the memory accesses overlap rather
+ * than each lookup stalling on it's own cache miss
+ *
+ * out[i] is set to the data stored under keys[i] or 0 if not found
+ *
+ * returns number of keys found on success
+ * returns 0 on failure
+ */
+size_t glh_get_batch(const struct glh_table *table, const char **keys, size_t n, void **out){
+    /* iterator through keys */
+    size_t i = 0;
 
-#ifdef DEBUG
-    printf("glh_insert: trying to insert key '%s', hash value '%zd', starting at pos '%zd'\n", key, hash, pos);
-#endif
+    if( ! table ){
+        puts("glh_get_batch: table undef");
+        return 0;
+    }
 
-    /* iterate from pos to size */
-    for( i=pos; i < table->size; ++i ){
-        she = &(table->entries[i]);
-        /* if taken keep searching */
-        if( she->state == glh_ENTRY_OCCUPIED ){
-            continue;
-        }
+    if( ! keys ){
+        puts("glh_get_batch: keys undef");
+        return 0;
+    }
 
-        /* otherwise (empty or dummy) jump to found */
-        goto glh_INSERT_FOUND;
+    if( ! out ){
+        puts("glh_get_batch: out undef");
+        return 0;
     }
 
-    /* iterate from 0 to pos */
-    for( i=0; i < pos; ++i ){
-        she = &(table->entries[i]);
-        /* if taken keep searching */
-        if( she->state == glh_ENTRY_OCCUPIED ){
-            continue;
+    for( i=0; i < n; ++i ){
+        if( ! keys[i] ){
+            puts("glh_get_batch: key undef");
+            return 0;
         }
-
-        /* otherwise (empty or dummy) jump to found */
-        goto glh_INSERT_FOUND;
     }
 
-    /* no slot found */
-    puts("glh_insert: unable to find insertion slot");
-    return 0;
+    return glh_batch(table, keys, n, out, 0);
+}
 
-glh_INSERT_FOUND:
-    /* she is already set! */
+/* look up n keys at once storing the result for keys[i] in out[i]
+ * as with glh_get_batch this prefetches a group at a time
+ *
+ * out[i] is set to 1 if keys[i] exists, otherwise 0
+ *
+ * returns number of keys found on success
+ * returns 0 on failure
+ */
+size_t glh_exists_batch(const struct glh_table *table, const char **keys, size_t n, unsigned int *out){
+    /* iterator through keys */
+    size_t i = 0;
 
-#ifdef DEBUG
-    printf("glh_insert: inserting insert key '%s', hash value '%zd', starting at pos '%zd', into '%zd'\n", key, hash, pos, i);
-#endif
+    if( ! table ){
+        puts("glh_exists_batch: table undef");
+        return 0;
+    }
 
-    /* construct our new glh_entry
-     * glh_entry_new(unsigned long int hash,
-     *              char *key,
-     *              void *data,
-     *              struct glh_entry *next){
-     *
-     * only key needs to be defined
-     *
-     */
-    /*                  (table, entry, hash, key,data) */
-    if( ! glh_entry_init(table, she,   hash, key, data) ){
-        puts("glh_insert: call to glh_entry_init failed");
+    if( ! keys ){
+        puts("glh_exists_batch: keys undef");
         return 0;
     }
 
-    /* increment number of elements */
-    ++table->n_elems;
+    if( ! out ){
+        puts("glh_exists_batch: out undef");
+        return 0;
+    }
 
-    /* return success */
-    return 1;
+    for( i=0; i < n; ++i ){
+        if( ! keys[i] ){
+            puts("glh_exists_batch: key undef");
+            return 0;
+        }
+    }
+
+    return glh_batch(table, keys, n, 0, out);
 }
 
-/* set `data` under `key`
- * this will only succeed if glh_exists(table, key)
+/* shrink table if a delete has taken it's load below
+ * table->shrink_threshold
  *
- * returns old data on success
+ * the new size puts the load half way between shrink_threshold
+ * and threshold so that a workload hovering around either
+ * doesn't keep resizing
+ *
+ * returns 1 on success (including when no shrink was needed)
  * returns 0 on failure
  */
-void * glh_set(struct glh_table *table, const char *key, void *data){
-    struct glh_entry *she = 0;
-    void * old_data = 0;
+unsigned int glh_maybe_shrink(struct glh_table *table){
+    /* size we will shrink to */
+    size_t new_size = 0;
 
-    if( ! table ){
-        puts("glh_set: table undef");
-        return 0;
+    if( ! table->shrink_threshold || table->old_entries ){
+        return 1;
     }
 
-    if( ! key ){
-        puts("glh_set: key undef");
-        return 0;
+    if( table->size <= glh_DEFAULT_SIZE || glh_load(table) >= table->shrink_threshold ){
+        return 1;
     }
 
-    /* allow data to be null */
+    new_size = glh_capacity_size(table->n_elems, (table->shrink_threshold + table->threshold) / 2);
+    if( new_size < glh_DEFAULT_SIZE ){
+        new_size = glh_DEFAULT_SIZE;
+    }
 
-    /* find entry */
-    she = glh_find_entry(table, key);
-    if( ! she ){
-        /* not found */
-        return 0;
+    /* glh_resize would round back up, this must actually shrink */
+    if( table->flags & glh_FLAG_POW2 ){
+        new_size = glh_round_pow2(new_size);
     }
 
-    /* save old data */
-    old_data = she->data;
+    if( new_size >= table->size ){
+        return 1;
+    }
 
-    /* overwrite */
-    she->data = data;
+    /* migrating into a smaller array works just as well as into a larger one */
+    if( table->flags & glh_FLAG_INCREMENTAL ){
+        if( ! glh_grow_start(table, new_size) ){
+            puts("glh_maybe_shrink: call to glh_grow_start failed");
+            return 0;
+        }
+    } else if( ! glh_resize(table, new_size) ){
+        puts("glh_maybe_shrink: call to glh_resize failed");
+        return 0;
+    }
 
-    /* return old data */
-    return old_data;
+    return 1;
 }
 
-/* get `data` stored under `key`
+/* delete entry stored under `key`
  *
  * returns data on success
  * returns 0 on failure
  */
-void * glh_get(const struct glh_table *table, const char *key){
-    struct glh_entry *she = 0;
-
+void * glh_delete(struct glh_table *table, const char *key){
     if( ! table ){
-        puts("glh_get: table undef");
+        puts("glh_delete: table undef");
         return 0;
     }
 
     if( ! key ){
-        puts("glh_get: key undef");
-        return 0;
-    }
-
-    /* find entry */
-    she = glh_find_entry(table, key);
-    if( ! she ){
-        /* not found */
+        puts("glh_delete: key undef");
         return 0;
     }
 
-    /* found */
-    return she->data;
+    return glh_delete_hashed(table, glh_HASH(table, key), key);
 }
 
-/* delete entry stored under `key`
+/* as glh_delete but using a hash already calculated by the caller
  *
  * returns data on success
  * returns 0 on failure
  */
-void * glh_delete(struct glh_table *table, const char *key){
+void * glh_delete_hashed(struct glh_table *table, unsigned long int hash, const char *key){
     /* our cur entry */
     struct glh_entry *cur = 0;
-    /* hash */
-    unsigned long int hash = 0;
     /* position in hash table */
     size_t pos = 0;
-    /* iterator through has table */
-    size_t i =0;
-    /* cached strlen */
+    /* slot within index, only used by compact tables */
+    size_t slot = 0;
+    /* was key found in entries */
+    unsigned int found = 0;
 
     /* our old data */
     void *old_data = 0;
 
     if( ! table ){
-        puts("glh_delete: table undef");
+        puts("glh_delete_hashed: table undef");
         return 0;
     }
 
     if( ! key ){
-        puts("glh_delete: key undef");
+        puts("glh_delete_hashed: key undef");
         return 0;
     }
 
-    /* calculate hash */
-    hash = table->hash_func(key);
+    if( table->map ){
+        puts("glh_delete_hashed: table is a read only mapping");
+        return 0;
+    }
 
-    /* calculate pos
-     * we know table is defined here
-     * so glh_pos cannot fail
-     */
-    pos = glh_pos(hash, table->size);
+    if( table->seeds ){
+        puts("glh_delete_hashed: table is frozen");
+        return 0;
+    }
 
+    /* do our share of any incremental grow */
+    glh_migrate(table, glh_MIGRATE_STEP);
 
-    /* starting at pos search for element
-     * searches pos .. size
-     */
-    for( i = pos; i < table->size ; ++i ){
-        cur = &(table->entries[i]);
+    /* compact tables also need to know which slot points at key */
+    if( table->index ){
+        found = glh_compact_probe(table, hash, key, &pos, &slot);
+    } else {
+        found = glh_probe(table, hash, key, &pos);
+    }
 
-        /* if this is an empty then we stop */
-        if( cur->state == glh_ENTRY_EMPTY ){
-            /* failed to find element */
+    if( ! found ){
+        /* key may not have been migrated yet */
+        if( table->old_entries ){
+            pos = glh_old_find(table, hash, key);
+            if( pos < table->old_size ){
+                cur = &(table->old_entries[pos]);
+                old_data = cur->data;
+
+                /* the old array is only drained so a dummy is fine */
+                cur->data = 0;
+                cur->key = 0;
+                cur->state = glh_ENTRY_DUMMY;
+
+                --table->n_elems;
+                return old_data;
+            }
+        }
+
+        /* failed to find element */
 #ifdef DEBUG
-            puts("glh_delete: failed to find key, encountered empty");
+        puts("glh_delete: failed to find key");
 #endif
-            return 0;
-        }
+        return 0;
+    }
 
-        /* if this is a dummy then we skip but continue */
-        if( cur->state == glh_ENTRY_DUMMY ){
-            continue;
-        }
+    cur = &(table->entries[pos]);
 
-        if( ! glh_entry_eq(table, cur, hash, key) ){
-            continue;
+    /* save old data pointer */
+    old_data = cur->data;
+
+    if( table->flags & glh_FLAG_BACKSHIFT ){
+        /* clear out and close the gap */
+        glh_backshift(table, pos);
+    } else {
+        /* clear out */
+        cur->data = 0;
+        cur->key = 0;
+        cur->hash = 0;
+        cur->state = glh_ENTRY_DUMMY;
+
+        /* keep control byte in sync */
+        glh_ctrl_set(table, pos);
+
+        /* and a compact table's index */
+        if( table->index ){
+            table->index[slot] = glh_INDEX_DUMMY;
         }
 
-        goto glh_DELETE_FOUND;
+        ++table->n_dummies;
     }
 
-    /* if we are here then we hit the end,
-     * searches 0 .. pos
-     */
-    for( i = 0; i < pos; ++i ){
-        cur = &(table->entries[i]);
+    /* decrement number of elements */
+    --table->n_elems;
 
-        /* if this is an empty then we stop */
-        if( cur->state == glh_ENTRY_EMPTY ){
-            /* failed to find element */
-#ifdef DEBUG
-            puts("glh_delete: failed to find key, encountered empty");
-#endif
-            return 0;
-        }
+    /* failing to shrink still leaves a working table */
+    if( ! glh_maybe_shrink(table) ){
+        puts("glh_delete_hashed: call to glh_maybe_shrink failed");
+    }
 
-        /* if this is a dummy then we skip but continue */
-        if( cur->state == glh_ENTRY_DUMMY ){
-            continue;
-        }
+    /* return old data */
+    return old_data;
+}
 
-        if( ! glh_entry_eq(table, cur, hash, key) ){
-            continue;
-        }
+/* start iterating through every element in table
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_iter_init(struct glh_iter *iter, const struct glh_table *table){
+    if( ! iter ){
+        puts("glh_iter_init: iter undef");
+        return 0;
+    }
 
-        goto glh_DELETE_FOUND;
+    if( ! table ){
+        puts("glh_iter_init: table undef");
+        return 0;
     }
 
-    /* failed to find element */
-    puts("glh_delete: failed to find key, both loops terminated");
-    return 0;
+    iter->table = table;
+    iter->pos = 0;
 
-glh_DELETE_FOUND:
-        /* cur is already set! */
+    return 1;
+}
 
-        /* save old data pointer */
-        old_data = cur->data;
+/* move on to the next element
+ *
+ * returns 1 on success
+ * returns 0 on failure or once every element has been visited
+ */
+unsigned int glh_iter_next(struct glh_iter *iter, const char **key, void **data){
+    /* table being iterated over */
+    const struct glh_table *table = 0;
+    /* our cur entry */
+    struct glh_entry *cur = 0;
+    /* number of entries to walk, old_entries follow on after these */
+    size_t len = 0;
 
-        /* clear out */
-        cur->data = 0;
-        cur->key = 0;
-        cur->hash = 0;
-        cur->state = glh_ENTRY_DUMMY;
+    if( ! iter || ! iter->table ){
+        puts("glh_iter_next: iter undef");
+        return 0;
+    }
 
-        /* decrement number of elements */
-        --table->n_elems;
+    table = iter->table;
+    len = table->size;
 
-        /* return old data */
-        return old_data;
-}
+    /* mapped tables walk their slots in place */
+    if( table->map ){
+        for( ; iter->pos < table->size; ++iter->pos ){
+            if( ! table->map_slots[iter->pos].key ){
+                continue;
+            }
+
+            if( key ){
+                *key = (const char *) (table->map + table->map_slots[iter->pos].key);
+            }
+
+            if( data ){
+                *data = glh_map_data(table, &(table->map_slots[iter->pos]));
+            }
+
+            ++iter->pos;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    /* compact tables only ever use the front of entries */
+    if( table->index ){
+        len = table->n_elems + table->n_dummies;
+    }
+
+    for( ; iter->pos < len + table->old_size; ++iter->pos ){
+        if( iter->pos < len ){
+            cur = &(table->entries[iter->pos]);
+        } else {
+            cur = &(table->old_entries[iter->pos - len]);
+        }
+
+        /* migrated entries leave a dummy behind so are only seen once */
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        if( key ){
+            *key = cur->key;
+        }
+
+        if( data ){
+            *data = cur->data;
+        }
 
+        ++iter->pos;
+        return 1;
+    }
 
+    return 0;
+}
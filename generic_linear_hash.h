@@ -27,6 +27,7 @@
 #define generic_linear_hash_H
 
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint64_t */
 
 enum glh_entry_state {
     glh_ENTRY_EMPTY,
@@ -34,25 +35,228 @@ enum glh_entry_state {
     glh_ENTRY_DUMMY // was occupied but now delete
 };
 
+/* optional behaviours a glh_table can have enabled
+ * these are set via the various glh_tune_* functions
+ */
+enum glh_table_flags {
+    /* maintain a dense array of control bytes alongside entries */
+    glh_FLAG_CTRL = 1 << 0,
+    /* keep size a power of two and select slots with a mask */
+    glh_FLAG_POW2 = 1 << 1,
+    /* delete by shifting later cluster members back, never leaving dummies */
+    glh_FLAG_BACKSHIFT = 1 << 2,
+    /* robin hood insertion, entries closer to home are displaced */
+    glh_FLAG_ROBINHOOD = 1 << 3,
+    /* grow into a new array incrementally rather than all at once */
+    glh_FLAG_INCREMENTAL = 1 << 4,
+    /* copy short keys into their slot and compare them there */
+    glh_FLAG_INLINE = 1 << 5,
+    /* copy keys into an arena owned by the table */
+    glh_FLAG_OWN_KEYS = 1 << 6,
+    /* probe a small index array into densely packed, insertion ordered entries */
+    glh_FLAG_COMPACT = 1 << 7,
+    /* serve lookups read only from a snapshot mapped by glh_map */
+    glh_FLAG_MAPPED = 1 << 8,
+    /* one probe lookups through a minimal perfect hash built by glh_freeze */
+    glh_FLAG_FROZEN = 1 << 9
+};
+
+/* control byte values used when glh_FLAG_CTRL is set
+ *
+ * an occupied slot stores a 7 bit fingerprint of it's hash (0x00 to 0x7f)
+ * so any control byte with the high bit set is a free slot
+ */
+#define glh_CTRL_EMPTY 0x80
+#define glh_CTRL_DUMMY 0xfe
+#define glh_CTRL_IS_FREE(ctrl) ((ctrl) & 0x80)
+
+/* index values used when glh_FLAG_COMPACT is set
+ *
+ * any other value is the position of an entry within table->entries
+ */
+#define glh_INDEX_EMPTY ((unsigned int) -1)
+#define glh_INDEX_DUMMY ((unsigned int) -2)
+
+/* maximum length of a key which can be stored inline in it's slot
+ * when glh_FLAG_INLINE is set
+ *
+ * slots only have room for inline keys when this is non-zero,
+ * so it must be defined to the same value when compiling
+ * generic_linear_hash.c and everything including this header
+ * e.g. -Dglh_INLINE_KEY_LEN=15 (at most 255)
+ *
+ * this defaults to 0 so slots stay as small as possible
+ */
+#ifndef glh_INLINE_KEY_LEN
+#define glh_INLINE_KEY_LEN 0
+#endif
+
 struct glh_entry {
     enum glh_entry_state state;
+    /* distance of this entry from it's home slot
+     * only maintained when glh_FLAG_ROBINHOOD is set
+     */
+    unsigned int dist;
     /* hash value for this entry, output of glh_hash(key) */
     unsigned long int hash;
     /* key pointer */
     const void * key;
     /* data pointer */
     void *data;
+#if glh_INLINE_KEY_LEN
+    /* length of the copy of key in inline_key
+     * 0 if key is too long (or glh_FLAG_INLINE is not set)
+     */
+    unsigned char key_len;
+    /* copy of the first key_len bytes of key */
+    unsigned char inline_key[glh_INLINE_KEY_LEN];
+#endif
+};
+
+/* a slot within a snapshot written by glh_save
+ * (see generic_linear_hash_snapshot.h), looked up in place
+ * when a table is mapped with glh_map (glh_FLAG_MAPPED)
+ *
+ * offsets are from the start of the snapshot
+ */
+struct glh_map_slot {
+    /* hash value of key, as with glh_entry */
+    uint64_t hash;
+    /* offset of the key's bytes, always followed by a 0 byte
+     * 0 for an empty slot
+     */
+    uint64_t key;
+    /* offset of the data's bytes if data_len is non-zero,
+     * otherwise the data pointer's own value
+     */
+    uint64_t data;
+    uint32_t key_len;
+    uint32_t data_len;
+};
+
+/* number of buckets in each probe length histogram of struct glh_stats
+ * bucket i counts probes which walked i slots past their home,
+ * the final bucket also counts every longer probe
+ */
+#define glh_STATS_BUCKETS 16
+
+/* statistics reported by glh_stats
+ *
+ * the counters are only maintained when generic_linear_hash.c
+ * is compiled with glh_STATS defined, so the default build pays nothing,
+ * otherwise `counting` is 0 and every counter is left at 0
+ */
+struct glh_stats {
+    /* 1 if the counters below the blank line are being maintained */
+    unsigned int counting;
+    /* number of slots */
+    size_t size;
+    /* number of elements stored */
+    size_t n_elems;
+    /* number of glh_ENTRY_DUMMY (tombstone) slots */
+    size_t n_dummies;
+    /* longest run of consecutive non-empty (occupied or dummy) slots */
+    size_t longest_cluster;
+
+    /* probe lengths of lookups which found their key */
+    unsigned long int probe_hits[glh_STATS_BUCKETS];
+    /* probe lengths of lookups which did not find their key */
+    unsigned long int probe_misses[glh_STATS_BUCKETS];
+    /* number of successful calls to glh_resize, including automatic ones */
+    unsigned long int n_resizes;
+    /* total and longest processor time spent in glh_resize in microseconds */
+    unsigned long int resize_usec;
+    unsigned long int resize_max_usec;
+    /* number of calls made to table->hash_func and table->equal_func */
+    unsigned long int hash_calls;
+    unsigned long int equal_calls;
 };
 
+/* allocator used for all of a table's own memory
+ * this does not cover any data or keys stored in the table
+ *
+ * ctx is passed back to every call untouched, so can be
+ * used to point at an arena or to account memory per tenant
+ *
+ * align is the alignment the table would like, always a power of two,
+ * an allocator is free to ignore anything beyond what malloc guarantees
+ * (as the default allocator does) or to give stricter alignment
+ *
+ * size passed to dealloc is the size originally asked for
+ */
+struct glh_allocator {
+    /* allocate size bytes
+     * returns pointer on success
+     * returns 0 on failure
+     */
+    void * (*alloc)(void *ctx, size_t size, size_t align);
+    /* as alloc but the memory must be zero filled */
+    void * (*zalloc)(void *ctx, size_t size, size_t align);
+    /* free memory from alloc or zalloc, ptr is never 0 */
+    void (*dealloc)(void *ctx, void *ptr, size_t size);
+    /* passed to all of the above */
+    void *ctx;
+};
+
+/* chunk of key storage, only used when glh_FLAG_OWN_KEYS is set
+ * this is internal to generic_linear_hash.c
+ */
+struct glh_arena_chunk;
+
 struct glh_table {
     /* number of slots in hash */
     size_t size;
     /* number of elements stored in hash */
     size_t n_elems;
+    /* number of glh_ENTRY_DUMMY slots left behind by deletes */
+    size_t n_dummies;
     /* threshold that triggers an automatic resize */
     unsigned int threshold;
+    /* load below which a delete shrinks the table, 0 to never shrink */
+    unsigned int shrink_threshold;
     /* array of glh_entry(s) */
     struct glh_entry *entries;
+    /* bitwise or of glh_FLAG_* values enabled on this table */
+    unsigned int flags;
+    /* optional array of control bytes, one per slot
+     * only allocated when glh_FLAG_CTRL is set
+     *
+     * each byte mirrors the state of the matching entry:
+     *  glh_ENTRY_EMPTY    => glh_CTRL_EMPTY
+     *  glh_ENTRY_DUMMY    => glh_CTRL_DUMMY
+     *  glh_ENTRY_OCCUPIED => 7 bit fingerprint of the entry's hash
+     *
+     * this allows a probe to walk 64 slots per cache line
+     * and only look at an entry when the fingerprint matches
+     */
+    unsigned char *ctrl;
+    /* optional array of indexes into entries, one per slot
+     * only allocated when glh_FLAG_COMPACT is set
+     *
+     * probing walks index rather than entries, which then
+     * holds entries_size glh_entry(s) packed in insertion order,
+     * a delete leaves a glh_ENTRY_DUMMY behind in entries
+     * and a glh_INDEX_DUMMY in index until the next resize
+     */
+    unsigned int *index;
+    /* number of glh_entry(s) in entries when glh_FLAG_COMPACT is set */
+    size_t entries_size;
+    /* previous array of glh_entry(s) while an incremental
+     * grow is in progress (glh_FLAG_INCREMENTAL), otherwise 0
+     *
+     * lookups check entries and then old_entries,
+     * each insert or delete migrates a few more slots
+     * from old_entries into entries until it is empty
+     */
+    struct glh_entry *old_entries;
+    /* number of slots in old_entries */
+    size_t old_size;
+    /* next slot in old_entries to be migrated */
+    size_t migrate_pos;
+    /* counters for glh_stats
+     * only allocated when compiled with glh_STATS defined, otherwise 0
+     */
+    struct glh_stats *stats;
     /* hashing function supplied at construction time */
     unsigned long int (*hash_func)(const void *key);
     /* optional equality function supplied at construction time
@@ -69,6 +273,34 @@ struct glh_table {
      * equal_func(1, 2) = -1
      */
     unsigned int (*equal_func)(const void *a, const void *b);
+    /* length of a key in bytes, only used when glh_FLAG_INLINE
+     * or glh_FLAG_OWN_KEYS are set
+     * see glh_tune_inline and glh_tune_own_keys
+     */
+    size_t (*key_len_func)(const void *key);
+    /* most recent chunk of copied keys (glh_FLAG_OWN_KEYS), otherwise 0
+     * chunks are never moved or freed until glh_destroy
+     */
+    struct glh_arena_chunk *arena;
+    /* read only mapping of a snapshot (glh_FLAG_MAPPED), otherwise 0
+     * lookups probe map_slots instead of entries, which is 0
+     */
+    const unsigned char *map;
+    /* length of map in bytes */
+    size_t map_len;
+    /* size slots within map */
+    const struct glh_map_slot *map_slots;
+    /* displacement of each bucket of a frozen table (glh_FLAG_FROZEN),
+     * otherwise 0, entries then holds n_elems entries in around
+     * n_elems / 0.99 slots
+     */
+    uint32_t *seeds;
+    /* number of buckets in seeds */
+    size_t n_seeds;
+    /* allocator supplied at construction time
+     * or the default malloc / calloc / free allocator
+     */
+    struct glh_allocator allocator;
 };
 
 /* function to return number of elements
@@ -78,6 +310,34 @@ struct glh_table {
  */
 unsigned int glh_nelems(const struct glh_table *table);
 
+/* function to return number of dummy (deleted) slots
+ * these still have to be probed past until the next resize
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+unsigned int glh_ndummies(const struct glh_table *table);
+
+/* fill in *stats with the current statistics for table
+ *
+ * this walks the whole table to find the longest cluster
+ *
+ * probe lengths, resizes and hash_func / equal_func calls
+ * are only counted when generic_linear_hash.c is compiled with
+ * glh_STATS defined (e.g. make test EXTRAFLAGS=-Dglh_STATS)
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_stats(const struct glh_table *table, struct glh_stats *stats);
+
+/* reset all the counters reported by glh_stats back to 0
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_stats_reset(struct glh_table *table);
+
 /* function to calculate load
  * (table->n_elems * 10) / table->size
  *
@@ -89,17 +349,196 @@ unsigned int glh_load(const struct glh_table *table);
 /* set the load that we resize at
  * load is (table->n_elems * 10) / table->size
  *
+ * dummy slots also count towards this threshold, if the
+ * elements and dummies together reach it then an insert will
+ * rebuild the table at it's current size to clear the dummies
+ *
  * this sets glh_table->threshold
  * this defaults to glh_DEFAULT_THRESHOLD in generic_linear_hash.c
  * this is set to 6 (meaning 60% full) by default
  *
  * this will accept any value between 1 (10%) to 10 (100%)
+ * which is at least 2 above any shrink_threshold set by glh_tune_shrink
  *
  * returns 1 on success
  * returns 0 on failure
  */
 unsigned int glh_tune_threshold(struct glh_table *table, unsigned int threshold);
 
+/* set the load below which glh_delete shrinks the table
+ * load is (table->n_elems * 10) / table->size
+ *
+ * a shrink resizes to a load half way between shrink_threshold
+ * and threshold, so after shrinking it takes a lot of inserts
+ * or deletes to trigger another resize in either direction
+ *
+ * tables never shrink below their default size of 32, with
+ * glh_FLAG_INCREMENTAL the shrink is migrated a step at a time like
+ * a grow, and no further shrink starts until that migration drains
+ *
+ * this sets glh_table->shrink_threshold
+ * this defaults to 0 which disables shrinking
+ *
+ * this will accept 0 or any value at least 2 below table->threshold
+ * so there is room for the load to settle between them
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_shrink(struct glh_table *table, unsigned int shrink_threshold);
+
+/* enable or disable the control byte array (glh_FLAG_CTRL)
+ *
+ * when enabled probing will scan table->ctrl and only
+ * compare against an entry when it's fingerprint matches
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_ctrl(struct glh_table *table, unsigned int enable);
+
+/* enable or disable power of two sizing (glh_FLAG_POW2)
+ *
+ * when enabled table->size is always kept a power of two
+ * (glh_resize will round any requested size up)
+ * and slots are selected with glh_pos_pow2 rather than glh_pos
+ * avoiding a division on every operation
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_pow2(struct glh_table *table, unsigned int enable);
+
+/* enable or disable backward shift deletion (glh_FLAG_BACKSHIFT)
+ *
+ * when enabled glh_delete will shift any later members of the cluster
+ * back into the freed slot rather than leaving a glh_ENTRY_DUMMY
+ * so probes never have to walk past deleted slots
+ *
+ * this can be called at any time, the table will be rebuilt
+ * which also clears out any existing dummies
+ *
+ * this cannot be disabled while glh_FLAG_ROBINHOOD is set
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_backshift(struct glh_table *table, unsigned int enable);
+
+/* enable or disable robin hood hashing (glh_FLAG_ROBINHOOD)
+ *
+ * when enabled each entry tracks it's distance from it's home slot,
+ * an insert will displace any entry which is closer to it's home
+ * than the entry being inserted, and a lookup can stop as soon as
+ * it reaches an entry closer to home than the key would be
+ *
+ * this keeps probe lengths short and even, even at a high threshold
+ *
+ * enabling this also enables glh_FLAG_BACKSHIFT
+ *
+ * this can be called at any time, the table will be rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_robinhood(struct glh_table *table, unsigned int enable);
+
+/* enable or disable incremental growth (glh_FLAG_INCREMENTAL)
+ *
+ * when enabled an insert which would have triggered glh_resize
+ * instead allocates the larger array and keeps the previous one around,
+ * every following insert and delete then migrates a bounded number
+ * of slots across so no single operation pays for a whole rehash
+ *
+ * rebuilding to clear out dummies (glh_ENTRY_DUMMY) left by deletes
+ * and shrinking (see glh_tune_shrink) are also done this way
+ *
+ * an explicit glh_resize will first finish any migration in progress
+ *
+ * disabling will finish any migration in progress
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_incremental(struct glh_table *table, unsigned int enable);
+
+/* enable or disable inline keys (glh_FLAG_INLINE)
+ *
+ * when enabled any key of up to glh_INLINE_KEY_LEN bytes is
+ * copied into it's slot, so comparing against it never has
+ * to follow the key pointer (and take another cache miss)
+ * longer keys still go through table->equal_func
+ *
+ * key_len_func must return the length of a key in bytes,
+ * two keys are then equal if their bytes are equal,
+ * pass a key_len_func of 0 to disable
+ *
+ * for strings key_len_func would return strlen(key)
+ *
+ * this can be called at any time, existing slots are updated
+ *
+ * key_len_func is shared with glh_tune_own_keys
+ *
+ * this requires compiling with a non-zero glh_INLINE_KEY_LEN
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_inline(struct glh_table *table, size_t (*key_len_func)(const void *key));
+
+/* enable or disable table owned keys (glh_FLAG_OWN_KEYS)
+ *
+ * when enabled every inserted key is copied into a chunked
+ * arena owned by the table, so callers do not need to keep
+ * their keys alive (or strdup them) after an insert
+ *
+ * key_len_func must return the length of a key in bytes,
+ * a 0 byte is always added after each copy so for strings
+ * key_len_func can simply return strlen(key)
+ * pass a key_len_func of 0 to disable
+ *
+ * copies never move (including on glh_resize) and are only freed,
+ * all at once, by glh_destroy, the space used by a deleted key
+ * is not reused
+ *
+ * enabling this copies any keys already in the table,
+ * disabling leaves existing copies in place
+ * but later keys are stored as given
+ *
+ * key_len_func is shared with glh_tune_inline
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_own_keys(struct glh_table *table, size_t (*key_len_func)(const void *key));
+
+/* enable or disable the compact layout (glh_FLAG_COMPACT)
+ *
+ * when enabled each slot is a 4 byte index into entries,
+ * which is packed densely in insertion order and only sized
+ * for as many entries as threshold allows, so sparse tables
+ * take far less memory and glh_iter only walks live entries
+ *
+ * a probe then has to follow an index into entries
+ * before it can compare against an entry
+ *
+ * this cannot be combined with glh_FLAG_CTRL, glh_FLAG_BACKSHIFT,
+ * glh_FLAG_ROBINHOOD or glh_FLAG_INCREMENTAL
+ *
+ * this can be called at any time, the table will be rebuilt,
+ * elements already in a non compact table keep their slot order
+ *
+ * deleted entries are only dropped from entries when rebuilt
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_tune_compact(struct glh_table *table, unsigned int enable);
+
 /* takes a char* representing a string
  * and a key_len of it's size
  *
@@ -121,6 +560,16 @@ unsigned long int glh_hash(const char *key, size_t key_len);
  */
 size_t glh_pos(unsigned long int hash, size_t table_size);
 
+/* takes a hash value and a table_size which must be a power of two
+ *
+ * the hash is first mixed with a multiplicative (fibonacci) hash
+ * so that weak hash functions still spread out across the low bits
+ * and is then masked down to a slot
+ *
+ * returns the index into the table for this hash
+ */
+size_t glh_pos_pow2(unsigned long int hash, size_t table_size);
+
 /* allocate and initialise a new glh_table
  *
  * will automatically assume a size of 32
@@ -149,6 +598,36 @@ struct glh_table * glh_new(
         unsigned int (*equal_func)(const void *a, const void *b)
         );
 
+/* as glh_new but all of the table's memory, including the
+ * glh_table itself, comes from allocator
+ *
+ * allocator is copied into the table,
+ * an allocator of 0 selects the default malloc / calloc / free
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new_with_allocator(
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b),
+        const struct glh_allocator *allocator
+        );
+
+/* as glh_new but sized up front to hold n elements at the
+ * default threshold without any resizing
+ *
+ * loading a known number of elements then costs a
+ * single allocation rather than a chain of glh_resize calls
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_new_with_capacity(
+        size_t n,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+        );
+
 /* free an existing glh_table
  * this will free all the sh entries stored
  * this will not free any keys
@@ -173,16 +652,53 @@ unsigned int glh_init(
         unsigned int (*equal_func)(const void *a, const void *b)
     );
 
+/* as glh_init but all of the table's memory comes from allocator
+ *
+ * allocator is copied into the table,
+ * an allocator of 0 selects the default malloc / calloc / free
+ *
+ * if free_table is passed to glh_destroy then the table itself
+ * will also be handed to allocator's dealloc
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_init_with_allocator(
+        struct glh_table *table,
+        size_t size,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b),
+        const struct glh_allocator *allocator
+    );
+
 /* resize an existing table to new_size
  * this will reshuffle all the buckets around
  *
  * you can use this to make a hash larger or smaller
  *
+ * if glh_FLAG_POW2 is set then new_size will be rounded up
+ * to the next power of two
+ *
+ * if an incremental grow is in progress it will be finished first
+ *
  * returns 1 on success
  * returns 0 on failure
  */
 unsigned int glh_resize(struct glh_table *table, size_t new_size);
 
+/* make room for n elements in total (including those already
+ * stored) at the current threshold with a single glh_resize
+ *
+ * call this after glh_tune_threshold as the number of
+ * slots needed depends on it
+ *
+ * this will never shrink the table
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_reserve(struct glh_table *table, size_t n);
+
 /* check if the supplied key already exists in this hash
  *
  * returns 1 on success (key exists)
@@ -190,6 +706,13 @@ unsigned int glh_resize(struct glh_table *table, size_t new_size);
  */
 unsigned int glh_exists(const struct glh_table *table, const char *key);
 
+/* as glh_exists but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+unsigned int glh_exists_hashed(const struct glh_table *table, unsigned long int hash, const char *key);
+
 /* insert `data` under `key`
  * this will only success if !glh_exists(table, key)
  *
@@ -198,6 +721,33 @@ unsigned int glh_exists(const struct glh_table *table, const char *key);
  */
 unsigned int glh_insert(struct glh_table *table, const char *key, void *data);
 
+/* as glh_insert but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+unsigned int glh_insert_hashed(struct glh_table *table, unsigned long int hash, const char *key, void *data);
+
+/* find `key` or insert it with data of 0
+ * this only hashes and probes once (twice if a resize was triggered)
+ *
+ * *created is set to 1 if key was newly inserted, otherwise 0
+ *
+ * the returned pointer is only valid until the next
+ * insert, delete or resize on this table
+ *
+ * returns a pointer to key's data on success
+ * returns 0 on failure
+ */
+void ** glh_find_or_insert(struct glh_table *table, const char *key, unsigned int *created);
+
+/* as glh_find_or_insert but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+void ** glh_find_or_insert_hashed(struct glh_table *table, unsigned long int hash, const char *key, unsigned int *created);
+
 /* set `data` under `key`
  * this will only succeed if glh_exists(table, key)
  *
@@ -206,6 +756,13 @@ unsigned int glh_insert(struct glh_table *table, const char *key, void *data);
  */
 void * glh_set(struct glh_table *table, const char *key, void *data);
 
+/* as glh_set but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+void * glh_set_hashed(struct glh_table *table, unsigned long int hash, const char *key, void *data);
+
 /* get `data` stored under `key`
  *
  * returns data on success
@@ -213,6 +770,53 @@ void * glh_set(struct glh_table *table, const char *key, void *data);
  */
 void * glh_get(const struct glh_table *table, const char *key);
 
+/* as glh_get but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+void * glh_get_hashed(const struct glh_table *table, unsigned long int hash, const char *key);
+
+/* get `data` stored under `key` into *data
+ *
+ * unlike glh_get this allows a stored data of 0
+ * to be told apart from a missing key
+ *
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found or on failure, *data is untouched
+ */
+unsigned int glh_try_get(const struct glh_table *table, const char *key, void **data);
+
+/* as glh_try_get but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+unsigned int glh_try_get_hashed(const struct glh_table *table, unsigned long int hash, const char *key, void **data);
+
+/* look up n keys at once storing the result for keys[i] in out[i]
+ *
+ * all the keys in a group are hashed and their slots prefetched
+ * before any are probed, so the memory accesses overlap rather
+ * than each lookup stalling on it's own cache miss
+ *
+ * out[i] is set to the data stored under keys[i] or 0 if not found
+ *
+ * returns number of keys found on success
+ * returns 0 on failure
+ */
+size_t glh_get_batch(const struct glh_table *table, const char **keys, size_t n, void **out);
+
+/* look up n keys at once storing the result for keys[i] in out[i]
+ * as with glh_get_batch this prefetches a group at a time
+ *
+ * out[i] is set to 1 if keys[i] exists, otherwise 0
+ *
+ * returns number of keys found on success
+ * returns 0 on failure
+ */
+size_t glh_exists_batch(const struct glh_table *table, const char **keys, size_t n, unsigned int *out);
+
 /* delete entry stored under `key`
  *
  * returns data on success
@@ -220,5 +824,46 @@ void * glh_get(const struct glh_table *table, const char *key);
  */
 void *  glh_delete(struct glh_table *table, const char *key);
 
+/* as glh_delete but using a hash already calculated by the caller
+ * this skips calling table->hash_func entirely
+ *
+ * hash must be what table->hash_func(key) would return
+ */
+void * glh_delete_hashed(struct glh_table *table, unsigned long int hash, const char *key);
+
+/* position of an iteration through a glh_table
+ * set up by glh_iter_init
+ */
+struct glh_iter {
+    /* table being iterated over */
+    const struct glh_table *table;
+    /* next position to look at, slots in entries
+     * followed by those in old_entries
+     */
+    size_t pos;
+};
+
+/* start iterating through every element in table
+ *
+ * with glh_FLAG_COMPACT set elements are visited in insertion
+ * order and only live entries are walked, otherwise every slot
+ * is walked and the order is unspecified
+ *
+ * any insert, delete or resize on table invalidates the iteration,
+ * glh_set on an existing key does not
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_iter_init(struct glh_iter *iter, const struct glh_table *table);
+
+/* move on to the next element
+ * setting *key and *data to it, either can be 0 if not wanted
+ *
+ * returns 1 on success
+ * returns 0 on failure or once every element has been visited
+ */
+unsigned int glh_iter_next(struct glh_iter *iter, const char **key, void **data);
+
 #endif // ifndef generic_linear_hash_H
 
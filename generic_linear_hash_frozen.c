@@ -0,0 +1,305 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h> /* puts */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t */
+#include <string.h> /* memset */
+
+#include "generic_linear_hash_frozen.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash.c */
+void * glh_alloc_array(const struct glh_allocator *allocator, size_t n, size_t size, unsigned int zero);
+void glh_free_array(const struct glh_allocator *allocator, void *ptr, size_t n, size_t size);
+size_t glh_entries_len(const struct glh_table *table);
+size_t glh_frozen_bucket(unsigned long int hash, size_t n_seeds);
+size_t glh_frozen_pos(unsigned long int hash, uint32_t seed, size_t size);
+
+/* average number of keys per bucket, larger buckets mean fewer
+ * seeds to store but more seeds to try before each bucket fits
+ */
+#define glh_FROZEN_BUCKET_SIZE 4
+
+/* percentage of a frozen table's slots which are filled
+ * leaving a few empty means the last buckets placed still have a choice
+ * of free slots, filling all of them makes large tables slow to freeze
+ * and liable to find no seed at all for the final buckets
+ */
+#define glh_FROZEN_LOAD 99
+
+/* give up on a bucket after trying this many seeds */
+#define glh_FROZEN_MAX_SEED (1UL << 24)
+
+/* scratch arrays used while building a frozen table */
+struct glh_frozen {
+    /* every occupied entry of the table being frozen */
+    struct glh_entry **live;
+    /* index into live of each key, grouped by bucket */
+    size_t *members;
+    /* members[starts[b]] to members[starts[b + 1]] are bucket b */
+    size_t *starts;
+    /* 1 for every slot of the new array already claimed */
+    unsigned char *taken;
+    /* slots claimed by the bucket being placed */
+    size_t *slots;
+    size_t n_elems;
+    /* number of slots in the new array */
+    size_t size;
+    size_t n_seeds;
+    /* number of keys in the largest bucket */
+    size_t max_bucket;
+};
+
+void glh_frozen_free(const struct glh_table *table, struct glh_frozen *frozen){
+    glh_free_array(&(table->allocator), frozen->live, frozen->n_elems, sizeof(struct glh_entry *));
+    glh_free_array(&(table->allocator), frozen->members, frozen->n_elems, sizeof(size_t));
+    glh_free_array(&(table->allocator), frozen->starts, frozen->n_seeds + 1, sizeof(size_t));
+    glh_free_array(&(table->allocator), frozen->taken, frozen->size, 1);
+    glh_free_array(&(table->allocator), frozen->slots, frozen->max_bucket, sizeof(size_t));
+}
+
+/* gather every live entry and group them by bucket
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_frozen_bucket_all(const struct glh_table *table, struct glh_frozen *frozen){
+    /* next free position of each bucket within members */
+    size_t *next = 0;
+    size_t len = glh_entries_len(table);
+    size_t n = 0;
+    size_t b = 0;
+    size_t i = 0;
+
+    frozen->live = glh_alloc_array(&(table->allocator), frozen->n_elems, sizeof(struct glh_entry *), 0);
+    frozen->members = glh_alloc_array(&(table->allocator), frozen->n_elems, sizeof(size_t), 0);
+    frozen->starts = glh_alloc_array(&(table->allocator), frozen->n_seeds + 1, sizeof(size_t), 1);
+    frozen->taken = glh_alloc_array(&(table->allocator), frozen->size, 1, 1);
+    next = glh_alloc_array(&(table->allocator), frozen->n_seeds, sizeof(size_t), 0);
+    if( ! frozen->live || ! frozen->members || ! frozen->starts || ! frozen->taken || ! next ){
+        puts("glh_frozen_bucket_all: call to glh_alloc_array failed");
+        glh_free_array(&(table->allocator), next, frozen->n_seeds, sizeof(size_t));
+        return 0;
+    }
+
+    /* compact tables leave deleted entries in place, skip those too */
+    for( i=0; i < len; ++i ){
+        if( table->entries[i].state == glh_ENTRY_OCCUPIED ){
+            frozen->live[n++] = &(table->entries[i]);
+        }
+    }
+
+    /* along with anything an incremental grow has yet to migrate,
+     * migrated entries leave a dummy behind so are only seen once
+     */
+    for( i=0; i < table->old_size; ++i ){
+        if( table->old_entries[i].state == glh_ENTRY_OCCUPIED ){
+            frozen->live[n++] = &(table->old_entries[i]);
+        }
+    }
+
+    /* count each bucket's keys into the start of the one after it */
+    for( i=0; i < n; ++i ){
+        ++frozen->starts[glh_frozen_bucket(frozen->live[i]->hash, frozen->n_seeds) + 1];
+    }
+
+    for( b=0; b < frozen->n_seeds; ++b ){
+        if( frozen->starts[b + 1] > frozen->max_bucket ){
+            frozen->max_bucket = frozen->starts[b + 1];
+        }
+        frozen->starts[b + 1] += frozen->starts[b];
+        next[b] = frozen->starts[b];
+    }
+
+    for( i=0; i < n; ++i ){
+        b = glh_frozen_bucket(frozen->live[i]->hash, frozen->n_seeds);
+        frozen->members[next[b]++] = i;
+    }
+
+    glh_free_array(&(table->allocator), next, frozen->n_seeds, sizeof(size_t));
+
+    frozen->slots = glh_alloc_array(&(table->allocator), frozen->max_bucket, sizeof(size_t), 0);
+    if( ! frozen->slots ){
+        puts("glh_frozen_bucket_all: call to glh_alloc_array failed");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* find the first seed placing every key of bucket b in a free slot
+ * claiming those slots in frozen->taken and copying the keys there
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_frozen_place(struct glh_frozen *frozen, size_t b, uint32_t *seed, struct glh_entry *new_entries){
+    size_t start = frozen->starts[b];
+    size_t count = frozen->starts[b + 1] - start;
+    unsigned long int hash = 0;
+    unsigned long int s = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* two keys sharing a hash share a slot under every seed */
+    for( i=0; i < count; ++i ){
+        for( j=i + 1; j < count; ++j ){
+            if( frozen->live[frozen->members[start + i]]->hash == frozen->live[frozen->members[start + j]]->hash ){
+                puts("glh_frozen_place: two keys share a hash");
+                return 0;
+            }
+        }
+    }
+
+    for( s=0; s < glh_FROZEN_MAX_SEED; ++s ){
+        for( i=0; i < count; ++i ){
+            hash = frozen->live[frozen->members[start + i]]->hash;
+            frozen->slots[i] = glh_frozen_pos(hash, s, frozen->size);
+            if( frozen->taken[frozen->slots[i]] ){
+                break;
+            }
+            frozen->taken[frozen->slots[i]] = 1;
+        }
+
+        if( i == count ){
+            break;
+        }
+
+        /* give back what this seed claimed before colliding */
+        for( j=0; j < i; ++j ){
+            frozen->taken[frozen->slots[j]] = 0;
+        }
+    }
+
+    if( s == glh_FROZEN_MAX_SEED ){
+        puts("glh_frozen_place: no seed places this bucket");
+        return 0;
+    }
+
+    for( i=0; i < count; ++i ){
+        new_entries[frozen->slots[i]] = *(frozen->live[frozen->members[start + i]]);
+    }
+
+    *seed = s;
+    return 1;
+}
+
+unsigned int glh_freeze(struct glh_table *table){
+    struct glh_frozen frozen;
+    struct glh_entry *new_entries = 0;
+    uint32_t *seeds = 0;
+    /* size of the bucket currently being placed */
+    size_t size = 0;
+    size_t b = 0;
+    unsigned int ret = 0;
+
+    if( ! table ){
+        puts("glh_freeze: table undef");
+        return 0;
+    }
+
+    if( table->flags & (glh_FLAG_FROZEN | glh_FLAG_MAPPED) ){
+        puts("glh_freeze: table is already read only");
+        return 0;
+    }
+
+    if( ! table->n_elems ){
+        puts("glh_freeze: table is empty");
+        return 0;
+    }
+
+    memset(&frozen, 0, sizeof(struct glh_frozen));
+    frozen.n_elems = table->n_elems;
+    frozen.size    = table->n_elems + table->n_elems / glh_FROZEN_LOAD + 1;
+    frozen.n_seeds = table->n_elems / glh_FROZEN_BUCKET_SIZE + 1;
+
+    /* slots are picked from the top 32 bits of a mixed hash */
+    if( table->n_elems > (uint32_t) -1 || frozen.size > (uint32_t) -1 ){
+        puts("glh_freeze: table has too many elements");
+        return 0;
+    }
+
+    /* zeroed, the few slots left over stay glh_ENTRY_EMPTY */
+    new_entries = glh_alloc_array(&(table->allocator), frozen.size, sizeof(struct glh_entry), 1);
+    seeds = glh_alloc_array(&(table->allocator), frozen.n_seeds, sizeof(uint32_t), 1);
+    if( ! new_entries || ! seeds ){
+        puts("glh_freeze: call to glh_alloc_array failed");
+        goto glh_FREEZE_DONE;
+    }
+
+    if( ! glh_frozen_bucket_all(table, &frozen) ){
+        puts("glh_freeze: call to glh_frozen_bucket_all failed");
+        goto glh_FREEZE_DONE;
+    }
+
+    /* largest buckets first, while there are still plenty of free slots */
+    for( size=frozen.max_bucket; size > 0; --size ){
+        for( b=0; b < frozen.n_seeds; ++b ){
+            if( frozen.starts[b + 1] - frozen.starts[b] != size ){
+                continue;
+            }
+
+            if( ! glh_frozen_place(&frozen, b, &seeds[b], new_entries) ){
+                puts("glh_freeze: call to glh_frozen_place failed");
+                goto glh_FREEZE_DONE;
+            }
+        }
+    }
+
+    /* every entry has been copied, release the old layout */
+    glh_free_array(&(table->allocator), table->entries, glh_entries_len(table), sizeof(struct glh_entry));
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+    glh_free_array(&(table->allocator), table->index, table->size, sizeof(unsigned int));
+    glh_free_array(&(table->allocator), table->old_entries, table->old_size, sizeof(struct glh_entry));
+
+    table->old_entries  = 0;
+    table->old_size     = 0;
+    table->migrate_pos  = 0;
+    table->entries      = new_entries;
+    table->ctrl         = 0;
+    table->index        = 0;
+    table->entries_size = 0;
+    table->size         = frozen.size;
+    table->n_dummies    = 0;
+    table->seeds        = seeds;
+    table->n_seeds      = frozen.n_seeds;
+    /* how keys are compared and owned still matters, how they were laid out does not */
+    table->flags = (table->flags & (glh_FLAG_INLINE | glh_FLAG_OWN_KEYS)) | glh_FLAG_FROZEN;
+
+    new_entries = 0;
+    seeds = 0;
+    ret = 1;
+
+glh_FREEZE_DONE:
+    glh_frozen_free(table, &frozen);
+    glh_free_array(&(table->allocator), new_entries, frozen.size, sizeof(struct glh_entry));
+    glh_free_array(&(table->allocator), seeds, frozen.n_seeds, sizeof(uint32_t));
+    return ret;
+}
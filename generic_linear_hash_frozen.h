@@ -0,0 +1,58 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_frozen_H
+#define generic_linear_hash_frozen_H
+
+#include "generic_linear_hash.h"
+
+/* convert a populated table into an immutable minimal perfect hash
+ * (glh_FLAG_FROZEN) for tables which are built once and then only read
+ *
+ * this uses hash and displace (CHD): keys are split into buckets of
+ * around glh_FROZEN_BUCKET_SIZE by their hash, then largest bucket
+ * first each bucket is given the first seed under which all of it's
+ * keys land in distinct free slots, only the seeds are kept
+ *
+ * afterwards entries holds n_elems entries in around n_elems / 0.99
+ * slots (glh_FROZEN_LOAD) with no dummies, and every lookup reads one
+ * seed and then probes exactly one slot, the seeds add 4 bytes per bucket
+ *
+ * only the stored hashes are used, hash_func is not called again,
+ * but no two keys may share a full hash value
+ *
+ * glh_get, glh_exists, glh_try_get (and their _hashed and _batch
+ * forms), glh_iter, glh_save and glh_destroy work as before,
+ * anything which would modify the table fails
+ *
+ * an unfinished incremental grow is folded in, and only once the
+ * freeze has succeeded
+ *
+ * returns 1 on success
+ * returns 0 on failure (the table is left unchanged)
+ */
+unsigned int glh_freeze(struct glh_table *table);
+
+#endif // ifndef generic_linear_hash_frozen_H
@@ -0,0 +1,431 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* pthread_rwlock_t is posix rather than c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* calloc, free */
+#include <stddef.h> /* size_t */
+#include <pthread.h> /* pthread_rwlock_* */
+
+#include "generic_linear_hash_locked.h"
+#include "generic_linear_hash_sharded.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash_sharded.c */
+size_t glh_sharded_index(const struct glh_sharded *sharded, unsigned long int hash);
+unsigned long int glh_sharded_hash(const struct glh_sharded *sharded, const char *key);
+
+/* a single stripe's lock, padded so that
+ * neighbouring locks do not share a cache line
+ */
+struct glh_locked_stripe {
+    pthread_rwlock_t lock;
+    unsigned char pad[64];
+};
+
+struct glh_locked {
+    /* the tables, stripe i guards shard i */
+    struct glh_sharded *sharded;
+    /* array of one lock per shard */
+    struct glh_locked_stripe *stripes;
+};
+
+/* index of key's stripe, *hash is set to key's hash */
+size_t glh_locked_route(const struct glh_locked *locked, const char *key, unsigned long int *hash){
+    *hash = glh_sharded_hash(locked->sharded, key);
+    return glh_sharded_index(locked->sharded, *hash);
+}
+
+/* take a lock for a lookup
+ * glh_STATS lookups write to their counters so need the write lock
+ */
+void glh_locked_rdlock(struct glh_locked_stripe *stripe){
+#ifdef glh_STATS
+    pthread_rwlock_wrlock(&(stripe->lock));
+#else
+    pthread_rwlock_rdlock(&(stripe->lock));
+#endif
+}
+
+/* allocate and initialise a new glh_locked of n_stripes stripes
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_locked * glh_locked_new(
+        size_t n_stripes,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    struct glh_locked *locked = 0;
+    /* number of stripes, n_stripes rounded up */
+    size_t n = 0;
+    /* number of locks set up so far */
+    size_t i = 0;
+
+    locked = calloc(1, sizeof(struct glh_locked));
+    if( ! locked ){
+        puts("glh_locked_new: call to calloc failed");
+        return 0;
+    }
+
+    locked->sharded = glh_sharded_new(n_stripes, hash_func, equal_func);
+    if( ! locked->sharded ){
+        puts("glh_locked_new: call to glh_sharded_new failed");
+        free(locked);
+        return 0;
+    }
+
+    n = glh_sharded_nshards(locked->sharded);
+
+    locked->stripes = calloc(n, sizeof(struct glh_locked_stripe));
+    if( ! locked->stripes ){
+        puts("glh_locked_new: call to calloc failed");
+        glh_sharded_destroy(locked->sharded, 0);
+        free(locked);
+        return 0;
+    }
+
+    for( i=0; i < n; ++i ){
+        if( pthread_rwlock_init(&(locked->stripes[i].lock), 0) ){
+            puts("glh_locked_new: call to pthread_rwlock_init failed");
+            break;
+        }
+    }
+
+    /* unwind any locks we did set up */
+    if( i < n ){
+        while( i-- ){
+            pthread_rwlock_destroy(&(locked->stripes[i].lock));
+        }
+        free(locked->stripes);
+        glh_sharded_destroy(locked->sharded, 0);
+        free(locked);
+        return 0;
+    }
+
+    return locked;
+}
+
+/* free an existing glh_locked and all of it's stripes
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_destroy(struct glh_locked *locked, unsigned int free_data){
+    /* iterator through stripes */
+    size_t i = 0;
+
+    if( ! locked ){
+        puts("glh_locked_destroy: locked was null");
+        return 0;
+    }
+
+    for( i=0; i < glh_sharded_nshards(locked->sharded); ++i ){
+        pthread_rwlock_destroy(&(locked->stripes[i].lock));
+    }
+
+    if( ! glh_sharded_destroy(locked->sharded, free_data) ){
+        puts("glh_locked_destroy: call to glh_sharded_destroy failed, continuing...");
+    }
+
+    free(locked->stripes);
+    free(locked);
+
+    return 1;
+}
+
+/* number of stripes in locked
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_locked_nstripes(const struct glh_locked *locked){
+    if( ! locked ){
+        puts("glh_locked_nstripes: locked was null");
+        return 0;
+    }
+
+    return glh_sharded_nshards(locked->sharded);
+}
+
+/* total number of elements over every stripe
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_locked_nelems(struct glh_locked *locked){
+    /* iterator through stripes */
+    size_t i = 0;
+    /* running total */
+    size_t n = 0;
+
+    if( ! locked ){
+        puts("glh_locked_nelems: locked was null");
+        return 0;
+    }
+
+    for( i=0; i < glh_sharded_nshards(locked->sharded); ++i ){
+        pthread_rwlock_rdlock(&(locked->stripes[i].lock));
+        n += glh_nelems(glh_sharded_shard(locked->sharded, i));
+        pthread_rwlock_unlock(&(locked->stripes[i].lock));
+    }
+
+    return n;
+}
+
+/* take every stripe's write lock, always in the same order
+ * so that two threads doing this cannot deadlock
+ */
+void glh_locked_lock_all(struct glh_locked *locked){
+    /* iterator through stripes */
+    size_t i = 0;
+
+    for( i=0; i < glh_sharded_nshards(locked->sharded); ++i ){
+        pthread_rwlock_wrlock(&(locked->stripes[i].lock));
+    }
+}
+
+/* release every stripe's lock taken by glh_locked_lock_all */
+void glh_locked_unlock_all(struct glh_locked *locked){
+    /* iterator through stripes */
+    size_t i = 0;
+
+    for( i=0; i < glh_sharded_nshards(locked->sharded); ++i ){
+        pthread_rwlock_unlock(&(locked->stripes[i].lock));
+    }
+}
+
+/* resize locked to hold new_size slots in total
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_resize(struct glh_locked *locked, size_t new_size){
+    unsigned int ret = 0;
+
+    if( ! locked ){
+        puts("glh_locked_resize: locked was null");
+        return 0;
+    }
+
+    glh_locked_lock_all(locked);
+    ret = glh_sharded_resize(locked->sharded, new_size);
+    glh_locked_unlock_all(locked);
+
+    if( ! ret ){
+        puts("glh_locked_resize: call to glh_sharded_resize failed");
+    }
+
+    return ret;
+}
+
+/* call func(table, ctx) on each stripe while holding every write lock
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_apply(struct glh_locked *locked,
+                              unsigned int (*func)(struct glh_table *table, void *ctx),
+                              void *ctx){
+    unsigned int ret = 0;
+
+    if( ! locked ){
+        puts("glh_locked_apply: locked was null");
+        return 0;
+    }
+
+    glh_locked_lock_all(locked);
+    ret = glh_sharded_apply(locked->sharded, func, ctx);
+    glh_locked_unlock_all(locked);
+
+    if( ! ret ){
+        puts("glh_locked_apply: call to glh_sharded_apply failed");
+    }
+
+    return ret;
+}
+
+/* as glh_exists
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_locked_exists(struct glh_locked *locked, const char *key){
+    /* hash of key, also selects it's stripe */
+    unsigned long int hash = 0;
+    /* index of key's stripe */
+    size_t i = 0;
+    unsigned int ret = 0;
+
+    if( ! locked ){
+        puts("glh_locked_exists: locked was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_locked_exists: key undef");
+        return 0;
+    }
+
+    i = glh_locked_route(locked, key, &hash);
+
+    glh_locked_rdlock(&(locked->stripes[i]));
+    ret = glh_exists_hashed(glh_sharded_shard(locked->sharded, i), hash, key);
+    pthread_rwlock_unlock(&(locked->stripes[i].lock));
+
+    return ret;
+}
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_insert(struct glh_locked *locked, const char *key, void *data){
+    /* hash of key, also selects it's stripe */
+    unsigned long int hash = 0;
+    /* index of key's stripe */
+    size_t i = 0;
+    unsigned int ret = 0;
+
+    if( ! locked ){
+        puts("glh_locked_insert: locked was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_locked_insert: key undef");
+        return 0;
+    }
+
+    i = glh_locked_route(locked, key, &hash);
+
+    pthread_rwlock_wrlock(&(locked->stripes[i].lock));
+    ret = glh_insert_hashed(glh_sharded_shard(locked->sharded, i), hash, key, data);
+    pthread_rwlock_unlock(&(locked->stripes[i].lock));
+
+    return ret;
+}
+
+/* as glh_set
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_locked_set(struct glh_locked *locked, const char *key, void *data){
+    /* hash of key, also selects it's stripe */
+    unsigned long int hash = 0;
+    /* index of key's stripe */
+    size_t i = 0;
+    void *old_data = 0;
+
+    if( ! locked ){
+        puts("glh_locked_set: locked was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_locked_set: key undef");
+        return 0;
+    }
+
+    i = glh_locked_route(locked, key, &hash);
+
+    pthread_rwlock_wrlock(&(locked->stripes[i].lock));
+    old_data = glh_set_hashed(glh_sharded_shard(locked->sharded, i), hash, key, data);
+    pthread_rwlock_unlock(&(locked->stripes[i].lock));
+
+    return old_data;
+}
+
+/* as glh_get
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_locked_get(struct glh_locked *locked, const char *key){
+    /* hash of key, also selects it's stripe */
+    unsigned long int hash = 0;
+    /* index of key's stripe */
+    size_t i = 0;
+    void *data = 0;
+
+    if( ! locked ){
+        puts("glh_locked_get: locked was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_locked_get: key undef");
+        return 0;
+    }
+
+    i = glh_locked_route(locked, key, &hash);
+
+    glh_locked_rdlock(&(locked->stripes[i]));
+    data = glh_get_hashed(glh_sharded_shard(locked->sharded, i), hash, key);
+    pthread_rwlock_unlock(&(locked->stripes[i].lock));
+
+    return data;
+}
+
+/* as glh_delete
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_locked_delete(struct glh_locked *locked, const char *key){
+    /* hash of key, also selects it's stripe */
+    unsigned long int hash = 0;
+    /* index of key's stripe */
+    size_t i = 0;
+    void *data = 0;
+
+    if( ! locked ){
+        puts("glh_locked_delete: locked was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_locked_delete: key undef");
+        return 0;
+    }
+
+    i = glh_locked_route(locked, key, &hash);
+
+    pthread_rwlock_wrlock(&(locked->stripes[i].lock));
+    data = glh_delete_hashed(glh_sharded_shard(locked->sharded, i), hash, key);
+    pthread_rwlock_unlock(&(locked->stripes[i].lock));
+
+    return data;
+}
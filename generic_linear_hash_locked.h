@@ -0,0 +1,153 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_locked_H
+#define generic_linear_hash_locked_H
+
+#include "generic_linear_hash.h"
+
+/* a thread safe table made up of a number of stripes,
+ * a glh_sharded with a read / write lock per shard
+ *
+ * keys are routed to stripes as to shards
+ * (see generic_linear_hash_sharded.h),
+ * so threads only contend when they touch the same stripe
+ *
+ * lookups take a stripe's read lock, so any number of them
+ * can run in parallel, changes take a stripe's write lock
+ *
+ * when compiled with glh_STATS lookups also update counters
+ * so take the write lock instead
+ *
+ * struct glh_locked is opaque so that including this header
+ * does not require pthreads
+ */
+struct glh_locked;
+
+/* allocate and initialise a new glh_locked of n_stripes stripes
+ *
+ * n_stripes is rounded up to the next power of two,
+ * a few times the number of threads is a good choice
+ *
+ * hash_func and equal_func are as for glh_new
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_locked * glh_locked_new(
+        size_t n_stripes,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+        );
+
+/* free an existing glh_locked and all of it's stripes
+ * this will only free the *data pointers if `free_data` is set to 1
+ *
+ * no other thread may be using locked
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_destroy(struct glh_locked *locked, unsigned int free_data);
+
+/* number of stripes in locked
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_locked_nstripes(const struct glh_locked *locked);
+
+/* total number of elements over every stripe
+ * each stripe is counted under it's own lock, so with concurrent
+ * changes this is only a snapshot
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_locked_nelems(struct glh_locked *locked);
+
+/* resize locked to hold new_size slots in total
+ * split evenly between the stripes
+ *
+ * every stripe is locked (in order) before any is resized,
+ * so no other thread sees a partially resized table
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_resize(struct glh_locked *locked, size_t new_size);
+
+/* call func(table, ctx) on each stripe's glh_table in turn
+ * while holding every stripe's write lock
+ *
+ * this is the way to tune stripes (glh_tune_ctrl and friends)
+ * or to walk them with glh_iter
+ *
+ * func must return 1 on success and 0 on failure,
+ * we stop at the first failure
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_apply(struct glh_locked *locked,
+                              unsigned int (*func)(struct glh_table *table, void *ctx),
+                              void *ctx);
+
+/* as glh_exists
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_locked_exists(struct glh_locked *locked, const char *key);
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_locked_insert(struct glh_locked *locked, const char *key, void *data);
+
+/* as glh_set
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_locked_set(struct glh_locked *locked, const char *key, void *data);
+
+/* as glh_get
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_locked_get(struct glh_locked *locked, const char *key);
+
+/* as glh_delete
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_locked_delete(struct glh_locked *locked, const char *key);
+
+#endif // ifndef generic_linear_hash_locked_H
@@ -0,0 +1,192 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* mmap is posix rather than c99, MAP_ANONYMOUS and madvise need more again */
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uintptr_t */
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h> /* mmap, munmap, madvise */
+#endif
+
+#include "generic_linear_hash_mmap.h"
+
+#if ! defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* one of each mode for the allocator ctx to point at */
+static enum glh_mmap_mode glh_mmap_modes[] = {
+    glh_MMAP_PAGES,
+    glh_MMAP_THP,
+    glh_MMAP_HUGETLB
+};
+
+/* length of the mapping used for an allocation of size bytes */
+size_t glh_mmap_length(size_t size){
+    return (size + glh_HUGE_PAGE_SIZE - 1) & ~((size_t) glh_HUGE_PAGE_SIZE - 1);
+}
+
+/* map size bytes of zero filled memory aligned to glh_HUGE_PAGE_SIZE
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+void * glh_mmap_map(enum glh_mmap_mode mode, size_t size){
+#ifdef MAP_ANONYMOUS
+    /* length of our mapping */
+    size_t len = glh_mmap_length(size);
+    /* start of our over sized mapping */
+    unsigned char *raw = 0;
+    /* huge page aligned start within raw */
+    unsigned char *aligned = 0;
+    /* slack trimmed from the front of raw */
+    size_t front = 0;
+    void *p = MAP_FAILED;
+
+    if( len < size ){
+        puts("glh_mmap_map: size overflow");
+        return 0;
+    }
+
+#ifdef MAP_HUGETLB
+    if( mode == glh_MMAP_HUGETLB ){
+        p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if( p != MAP_FAILED ){
+            return p;
+        }
+        /* no huge pages reserved, fall back to asking for transparent ones */
+    }
+#endif
+
+    /* over map so that we can trim down to a huge page boundary */
+    p = mmap(0, len + glh_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if( p == MAP_FAILED ){
+        puts("glh_mmap_map: call to mmap failed");
+        return 0;
+    }
+
+    raw = p;
+    aligned = raw + ((glh_HUGE_PAGE_SIZE - ((uintptr_t) raw % glh_HUGE_PAGE_SIZE)) % glh_HUGE_PAGE_SIZE);
+    front = aligned - raw;
+
+    if( front ){
+        munmap(raw, front);
+    }
+    if( glh_HUGE_PAGE_SIZE - front ){
+        munmap(aligned + len, glh_HUGE_PAGE_SIZE - front);
+    }
+
+#ifdef MADV_HUGEPAGE
+    if( mode != glh_MMAP_PAGES ){
+        madvise(aligned, len, MADV_HUGEPAGE);
+    }
+#endif
+#ifdef MADV_NOHUGEPAGE
+    if( mode == glh_MMAP_PAGES ){
+        madvise(aligned, len, MADV_NOHUGEPAGE);
+    }
+#endif
+
+    return aligned;
+#else
+    (void) mode;
+    return calloc(1, size);
+#endif
+}
+
+/* unmap memory from glh_mmap_map of size bytes */
+void glh_mmap_unmap(void *ptr, size_t size){
+#ifdef MAP_ANONYMOUS
+    munmap(ptr, glh_mmap_length(size));
+#else
+    (void) size;
+    free(ptr);
+#endif
+}
+
+/* glh_allocator functions, ctx points at our glh_mmap_mode
+ * mappings are already aligned to far more than any align asked for
+ */
+void * glh_mmap_alloc(void *ctx, size_t size, size_t align){
+    (void) align;
+
+    if( size < glh_MMAP_MIN_SIZE ){
+        return malloc(size);
+    }
+
+    return glh_mmap_map(*(const enum glh_mmap_mode *) ctx, size);
+}
+
+void * glh_mmap_zalloc(void *ctx, size_t size, size_t align){
+    (void) align;
+
+    if( size < glh_MMAP_MIN_SIZE ){
+        return calloc(1, size);
+    }
+
+    /* fresh mappings are already zero */
+    return glh_mmap_map(*(const enum glh_mmap_mode *) ctx, size);
+}
+
+void glh_mmap_dealloc(void *ctx, void *ptr, size_t size){
+    (void) ctx;
+
+    if( size < glh_MMAP_MIN_SIZE ){
+        free(ptr);
+        return;
+    }
+
+    glh_mmap_unmap(ptr, size);
+}
+
+/* one allocator per mode */
+static const struct glh_allocator glh_mmap_allocators[] = {
+    {glh_mmap_alloc, glh_mmap_zalloc, glh_mmap_dealloc, &glh_mmap_modes[glh_MMAP_PAGES]},
+    {glh_mmap_alloc, glh_mmap_zalloc, glh_mmap_dealloc, &glh_mmap_modes[glh_MMAP_THP]},
+    {glh_mmap_alloc, glh_mmap_zalloc, glh_mmap_dealloc, &glh_mmap_modes[glh_MMAP_HUGETLB]}
+};
+
+/* returns pointer to a static allocator on success
+ * returns 0 on failure (unknown mode)
+ */
+const struct glh_allocator * glh_mmap_allocator(enum glh_mmap_mode mode){
+    if( mode != glh_MMAP_PAGES && mode != glh_MMAP_THP && mode != glh_MMAP_HUGETLB ){
+        puts("glh_mmap_allocator: unknown mode");
+        return 0;
+    }
+
+    return &glh_mmap_allocators[mode];
+}
@@ -0,0 +1,68 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_mmap_H
+#define generic_linear_hash_mmap_H
+
+#include "generic_linear_hash.h"
+
+/* allocations smaller than this are left to malloc / calloc / free
+ * anything larger gets it's own mapping
+ */
+#define glh_MMAP_MIN_SIZE (1024 * 1024)
+
+/* size of the huge pages mappings are aligned to and rounded up to */
+#define glh_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* kinds of pages glh_mmap_allocator can back large arrays with */
+enum glh_mmap_mode {
+    /* plain 4K pages, transparent huge pages are turned off */
+    glh_MMAP_PAGES,
+    /* ask for transparent huge pages with MADV_HUGEPAGE */
+    glh_MMAP_THP,
+    /* explicit huge pages with MAP_HUGETLB
+     * falling back to glh_MMAP_THP if none are available
+     */
+    glh_MMAP_HUGETLB
+};
+
+/* an allocator (see glh_new_with_allocator) which backs any allocation
+ * of at least glh_MMAP_MIN_SIZE with it's own anonymous mapping
+ *
+ * mappings are aligned to and rounded up to glh_HUGE_PAGE_SIZE
+ * and rely on fresh mappings being zero filled rather than
+ * clearing them, so no page is touched until it is used
+ *
+ * freeing (on resize or destroy) returns the mapping with munmap
+ *
+ * on systems without anonymous mmap every allocation
+ * is left to malloc / calloc / free
+ *
+ * returns pointer to a static allocator on success
+ * returns 0 on failure (unknown mode)
+ */
+const struct glh_allocator * glh_mmap_allocator(enum glh_mmap_mode mode);
+
+#endif // ifndef generic_linear_hash_mmap_H
@@ -0,0 +1,432 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* pthread_create is posix rather than c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> /* puts */
+#include <stddef.h> /* size_t */
+#include <pthread.h> /* pthread_create, pthread_join */
+
+#ifdef glh_STATS
+#include <time.h> /* clock */
+#endif
+
+#include "generic_linear_hash_parallel.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash.c */
+void * glh_alloc_array(const struct glh_allocator *allocator, size_t n, size_t size, unsigned int zero);
+void glh_free_array(const struct glh_allocator *allocator, void *ptr, size_t n, size_t size);
+size_t glh_round_pow2(size_t n);
+size_t glh_capacity_size(size_t n, unsigned int threshold);
+size_t glh_entries_len(const struct glh_table *table);
+size_t glh_table_pos(const struct glh_table *table, unsigned long int hash, size_t table_size);
+unsigned char glh_ctrl_fingerprint(unsigned long int hash);
+unsigned int glh_alloc_slots(const struct glh_table *table, size_t table_size, struct glh_entry **entries, unsigned char **ctrl);
+void glh_migrate(struct glh_table *table, size_t count);
+
+/* tables with fewer elements than this are left to glh_resize,
+ * starting threads would cost more than it saves
+ */
+#define glh_PARALLEL_MIN_ELEMS (64 * 1024)
+
+/* never split the new array into ranges smaller than this */
+#define glh_PARALLEL_MIN_RANGE 4096
+
+/* state shared by every thread of one glh_resize_parallel */
+struct glh_parallel {
+    const struct glh_table *table;
+    struct glh_entry *new_entries;
+    /* only if glh_FLAG_CTRL */
+    unsigned char *new_ctrl;
+    size_t new_size;
+    /* number of threads, chunks of the old array and ranges of the new */
+    size_t n_threads;
+    /* length of the old array */
+    size_t old_len;
+    /* counts[t * n_threads + r] is the number of entries in chunk t
+     * homed in range r, which then becomes where the next of
+     * them goes within order
+     */
+    size_t *counts;
+    /* every entry of the old array, grouped by range */
+    struct glh_entry **order;
+    /* range r's entries are order[starts[r]..starts[r + 1]) */
+    size_t *starts;
+    /* number of range r's entries which did not fit within it,
+     * moved to the front of it's part of order
+     */
+    size_t *n_overflow;
+};
+
+/* one thread's share of a glh_parallel */
+struct glh_parallel_worker {
+    struct glh_parallel *job;
+    /* which chunk of the old array or range of the new */
+    size_t id;
+    void (*func)(struct glh_parallel *job, size_t id);
+};
+
+/* start of chunk i when splitting len into job->n_threads pieces,
+ * i == n_threads gives len
+ */
+size_t glh_parallel_bound(const struct glh_parallel *job, size_t len, size_t i){
+    if( i >= job->n_threads ){
+        return len;
+    }
+
+    return (len / job->n_threads) * i;
+}
+
+/* which range of the new array slot pos falls in */
+size_t glh_parallel_range(const struct glh_parallel *job, size_t pos){
+    size_t r = pos / (job->new_size / job->n_threads);
+
+    /* the last range also takes the remainder */
+    if( r >= job->n_threads ){
+        r = job->n_threads - 1;
+    }
+
+    return r;
+}
+
+/* count how many entries in chunk id are homed in each range */
+void glh_parallel_count(struct glh_parallel *job, size_t id){
+    size_t *counts = &(job->counts[id * job->n_threads]);
+    size_t end = glh_parallel_bound(job, job->old_len, id + 1);
+    size_t i = 0;
+    struct glh_entry *cur = 0;
+
+    for( i = glh_parallel_bound(job, job->old_len, id); i < end; ++i ){
+        cur = &(job->table->entries[i]);
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        ++counts[glh_parallel_range(job, glh_table_pos(job->table, cur->hash, job->new_size))];
+    }
+}
+
+/* scatter chunk id's entries into order by range */
+void glh_parallel_scatter(struct glh_parallel *job, size_t id){
+    size_t *next = &(job->counts[id * job->n_threads]);
+    size_t end = glh_parallel_bound(job, job->old_len, id + 1);
+    size_t i = 0;
+    struct glh_entry *cur = 0;
+
+    for( i = glh_parallel_bound(job, job->old_len, id); i < end; ++i ){
+        cur = &(job->table->entries[i]);
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        job->order[next[glh_parallel_range(job, glh_table_pos(job->table, cur->hash, job->new_size))]++] = cur;
+    }
+}
+
+/* place the entries homed in range id, probing no further than it's end */
+void glh_parallel_place(struct glh_parallel *job, size_t id){
+    size_t hi = glh_parallel_bound(job, job->new_size, id + 1);
+    size_t n_overflow = 0;
+    size_t k = 0;
+    size_t j = 0;
+    struct glh_entry *cur = 0;
+
+    for( k = job->starts[id]; k < job->starts[id + 1]; ++k ){
+        cur = job->order[k];
+
+        j = glh_table_pos(job->table, cur->hash, job->new_size);
+        while( j < hi && job->new_entries[j].state != glh_ENTRY_EMPTY ){
+            ++j;
+        }
+
+        if( j == hi ){
+            /* k only moves forward, so this slot of order is already read */
+            job->order[job->starts[id] + n_overflow++] = cur;
+            continue;
+        }
+
+        /* this also brings any inline key along */
+        job->new_entries[j] = *cur;
+
+        if( job->new_ctrl ){
+            job->new_ctrl[j] = glh_ctrl_fingerprint(cur->hash);
+        }
+    }
+
+    job->n_overflow[id] = n_overflow;
+}
+
+void * glh_parallel_thread(void *arg){
+    struct glh_parallel_worker *worker = arg;
+
+    worker->func(worker->job, worker->id);
+
+    return 0;
+}
+
+/* run func(job, id) for every id on it's own thread and wait for them
+ * any thread which cannot be started is run on the calling thread
+ */
+void glh_parallel_run(struct glh_parallel *job,
+                      struct glh_parallel_worker *workers,
+                      pthread_t *threads,
+                      void (*func)(struct glh_parallel *job, size_t id)){
+    size_t i = 0;
+
+    for( i=0; i < job->n_threads; ++i ){
+        workers[i].job = job;
+        workers[i].id = i;
+        workers[i].func = func;
+
+        /* the calling thread takes the last share itself */
+        if( i + 1 == job->n_threads || pthread_create(&threads[i], 0, glh_parallel_thread, &workers[i]) ){
+            workers[i].func = 0;
+            func(job, i);
+        }
+    }
+
+    for( i=0; i < job->n_threads; ++i ){
+        if( workers[i].func ){
+            pthread_join(threads[i], 0);
+        }
+    }
+}
+
+/* place every entry which overflowed it's range, from the end of that
+ * range onwards, everything from it's home to there is already taken
+ */
+void glh_parallel_overflow(struct glh_parallel *job){
+    size_t r = 0;
+    size_t k = 0;
+    size_t j = 0;
+    struct glh_entry *cur = 0;
+
+    for( r=0; r < job->n_threads; ++r ){
+        for( k=0; k < job->n_overflow[r]; ++k ){
+            cur = job->order[job->starts[r] + k];
+
+            j = glh_parallel_bound(job, job->new_size, r + 1);
+            if( j == job->new_size ){
+                j = 0;
+            }
+
+            while( job->new_entries[j].state != glh_ENTRY_EMPTY ){
+                if( ++j == job->new_size ){
+                    j = 0;
+                }
+            }
+
+            job->new_entries[j] = *cur;
+
+            if( job->new_ctrl ){
+                job->new_ctrl[j] = glh_ctrl_fingerprint(cur->hash);
+            }
+        }
+    }
+}
+
+/* resize table to hold new_size slots using n_threads threads
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_resize_parallel(struct glh_table *table, size_t new_size, size_t n_threads){
+    struct glh_parallel job;
+    struct glh_parallel_worker *workers = 0;
+    pthread_t *threads = 0;
+    /* running total while turning counts into offsets */
+    size_t total = 0;
+    size_t count = 0;
+    size_t r = 0;
+    size_t t = 0;
+    unsigned int ret = 0;
+#ifdef glh_STATS
+    /* processor time at start and length of this resize */
+    clock_t start = clock();
+    unsigned long int usec = 0;
+#endif
+
+    if( ! table ){
+        puts("glh_resize_parallel: table was null");
+        return 0;
+    }
+
+    if( new_size == 0 ){
+        puts("glh_resize_parallel: asked for new_size of 0, impossible");
+        return 0;
+    }
+
+    if( table->map ){
+        puts("glh_resize_parallel: table is a read only mapping");
+        return 0;
+    }
+
+    if( table->seeds ){
+        puts("glh_resize_parallel: table is frozen");
+        return 0;
+    }
+
+    /* power of two tables round up to the next power of two */
+    if( table->flags & glh_FLAG_POW2 ){
+        new_size = glh_round_pow2(new_size);
+    }
+
+    if( n_threads > new_size / glh_PARALLEL_MIN_RANGE ){
+        n_threads = new_size / glh_PARALLEL_MIN_RANGE;
+    }
+
+    /* robin hood clusters must stay ordered and compact tables
+     * only rebuild their index, both are left to glh_resize
+     */
+    if( n_threads < 2
+        || table->n_elems < glh_PARALLEL_MIN_ELEMS
+        || (table->flags & (glh_FLAG_ROBINHOOD | glh_FLAG_COMPACT)) ){
+        return glh_resize(table, new_size);
+    }
+
+    if( new_size <= table->n_elems ){
+        puts("glh_resize_parallel: asked for new_size smaller than number of existing elements, impossible");
+        return 0;
+    }
+
+    /* finish any incremental grow so everything is in entries */
+    glh_migrate(table, table->old_size);
+
+    job.table = table;
+    job.new_entries = 0;
+    job.new_ctrl = 0;
+    job.new_size = new_size;
+    job.n_threads = n_threads;
+    job.old_len = glh_entries_len(table);
+    job.counts = glh_alloc_array(&(table->allocator), n_threads * n_threads, sizeof(size_t), 1);
+    job.order = glh_alloc_array(&(table->allocator), table->n_elems, sizeof(struct glh_entry *), 0);
+    job.starts = glh_alloc_array(&(table->allocator), n_threads + 1, sizeof(size_t), 0);
+    job.n_overflow = glh_alloc_array(&(table->allocator), n_threads, sizeof(size_t), 0);
+    workers = glh_alloc_array(&(table->allocator), n_threads, sizeof(struct glh_parallel_worker), 0);
+    threads = glh_alloc_array(&(table->allocator), n_threads, sizeof(pthread_t), 0);
+
+    if( ! job.counts || ! job.order || ! job.starts || ! job.n_overflow || ! workers || ! threads ){
+        puts("glh_resize_parallel: call to glh_alloc_array failed");
+        goto glh_PARALLEL_DONE;
+    }
+
+    if( ! glh_alloc_slots(table, new_size, &job.new_entries, &job.new_ctrl) ){
+        puts("glh_resize_parallel: call to glh_alloc_slots failed");
+        goto glh_PARALLEL_DONE;
+    }
+
+    glh_parallel_run(&job, workers, threads, glh_parallel_count);
+
+    /* turn counts into where each chunk's entries for each range start,
+     * ranges in order and within a range chunks in order
+     */
+    for( r=0; r < n_threads; ++r ){
+        job.starts[r] = total;
+        for( t=0; t < n_threads; ++t ){
+            count = job.counts[t * n_threads + r];
+            job.counts[t * n_threads + r] = total;
+            total += count;
+        }
+    }
+    job.starts[n_threads] = total;
+
+    glh_parallel_run(&job, workers, threads, glh_parallel_scatter);
+    glh_parallel_run(&job, workers, threads, glh_parallel_place);
+    glh_parallel_overflow(&job);
+
+    /* free old data */
+    glh_free_array(&(table->allocator), table->entries, job.old_len, sizeof(struct glh_entry));
+    glh_free_array(&(table->allocator), table->ctrl, table->size, 1);
+
+    /* swap */
+    table->size = new_size;
+    table->entries = job.new_entries;
+    table->ctrl = job.new_ctrl;
+
+    /* dummies are never copied across */
+    table->n_dummies = 0;
+
+#ifdef glh_STATS
+    if( table->stats ){
+        usec = (clock() - start) * 1000000.0 / CLOCKS_PER_SEC;
+        ++table->stats->n_resizes;
+        table->stats->resize_usec += usec;
+        if( usec > table->stats->resize_max_usec ){
+            table->stats->resize_max_usec = usec;
+        }
+    }
+#endif
+
+    ret = 1;
+
+glh_PARALLEL_DONE:
+    glh_free_array(&(table->allocator), job.counts, n_threads * n_threads, sizeof(size_t));
+    glh_free_array(&(table->allocator), job.order, table->n_elems, sizeof(struct glh_entry *));
+    glh_free_array(&(table->allocator), job.starts, n_threads + 1, sizeof(size_t));
+    glh_free_array(&(table->allocator), job.n_overflow, n_threads, sizeof(size_t));
+    glh_free_array(&(table->allocator), workers, n_threads, sizeof(struct glh_parallel_worker));
+    glh_free_array(&(table->allocator), threads, n_threads, sizeof(pthread_t));
+
+    return ret;
+}
+
+/* as glh_reserve but any resize is done by glh_resize_parallel
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_reserve_parallel(struct glh_table *table, size_t n, size_t n_threads){
+    /* number of slots needed for n elements */
+    size_t size = 0;
+
+    if( ! table ){
+        puts("glh_reserve_parallel: table was null");
+        return 0;
+    }
+
+    size = glh_capacity_size(n, table->threshold);
+    if( ! size ){
+        puts("glh_reserve_parallel: n is too large");
+        return 0;
+    }
+
+    /* already big enough */
+    if( size <= table->size ){
+        return 1;
+    }
+
+    if( ! glh_resize_parallel(table, size, n_threads) ){
+        puts("glh_reserve_parallel: call to glh_resize_parallel failed");
+        return 0;
+    }
+
+    return 1;
+}
@@ -0,0 +1,63 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_parallel_H
+#define generic_linear_hash_parallel_H
+
+#include "generic_linear_hash.h"
+
+/* resize table to hold new_size slots using n_threads threads
+ *
+ * this is glh_resize spread over threads, for very large tables
+ * which would otherwise spend seconds rehashing on one core
+ *
+ * the new array is split into n_threads contiguous ranges,
+ * the old entries are first bucketed (in parallel) by the range
+ * their home slot falls in, then each thread places the entries
+ * homed in it's own range, so no two threads write the same slot
+ *
+ * an entry whose probe runs off the end of it's range is set aside
+ * and placed afterwards by the calling thread, as each range is
+ * only ever a few slots short this is a small fraction of the work
+ *
+ * robin hood (glh_FLAG_ROBINHOOD) and compact (glh_FLAG_COMPACT)
+ * tables, tables too small to be worth it and n_threads of 0 or 1
+ * all fall back to glh_resize
+ *
+ * this needs an extra pointer per element while it runs
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_resize_parallel(struct glh_table *table, size_t new_size, size_t n_threads);
+
+/* as glh_reserve but any resize is done by glh_resize_parallel
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_reserve_parallel(struct glh_table *table, size_t n, size_t n_threads);
+
+#endif // ifndef generic_linear_hash_parallel_H
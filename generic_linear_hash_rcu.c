@@ -0,0 +1,829 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* pthread_mutex_t is posix rather than c99 */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <stddef.h> /* size_t */
+#include <string.h> /* memcpy */
+#include <pthread.h> /* pthread_mutex_* */
+
+#include "generic_linear_hash_rcu.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash.c */
+size_t glh_table_pos(const struct glh_table *table, unsigned long int hash, size_t table_size);
+unsigned int glh_entry_eq(const struct glh_table *table, struct glh_entry *cur, unsigned long int hash, const void *key);
+unsigned int glh_entry_init(struct glh_table *table, struct glh_entry *entry, unsigned long int hash, const char *key, void *data);
+unsigned int glh_probe(const struct glh_table *table, unsigned long int hash, const void *key, size_t *pos);
+void glh_default_dealloc(void *ctx, void *ptr, size_t size);
+
+/* number of slots we start with */
+#define glh_RCU_SIZE 32
+
+/* factor to grow by when the load reaches the threshold */
+#define glh_RCU_SCALING_FACTOR 2
+
+/* something freed while a reader may still be looking at it */
+struct glh_rcu_retired {
+    void *ptr;
+    /* value of epoch when ptr was retired */
+    unsigned long int epoch;
+    struct glh_rcu_retired *next;
+};
+
+/* a reader, padded so that readers announcing they are quiescent
+ * do not share a cache line with each other
+ */
+struct glh_rcu_reader {
+    /* latest epoch this reader has seen while quiescent */
+    unsigned long int seen;
+    struct glh_rcu_reader *next;
+    unsigned char pad[64];
+};
+
+struct glh_rcu {
+    /* immutable copy of table readers look things up in
+     * only the states and data of it's entries ever change
+     */
+    struct glh_table *snapshot;
+    /* bumped once anything retired is no longer reachable */
+    unsigned long int epoch;
+    /* keep the writer's fields off the readers' cache line */
+    unsigned char pad[64];
+
+    /* everything below is only touched under lock */
+    pthread_mutex_t lock;
+    /* the writer's table, it's allocator retires rather than frees */
+    struct glh_table table;
+    /* list of retired allocations, newest first */
+    struct glh_rcu_retired *retired;
+    /* list of registered readers */
+    struct glh_rcu_reader *readers;
+};
+
+/* lookups only write to shared memory when glh_STATS is counting
+ * in which case they serialise with the writer
+ */
+#ifdef glh_STATS
+#define glh_RCU_READ_LOCK(rcu) pthread_mutex_lock(&((rcu)->lock))
+#define glh_RCU_READ_UNLOCK(rcu) pthread_mutex_unlock(&((rcu)->lock))
+#else
+#define glh_RCU_READ_LOCK(rcu) ((void) 0)
+#define glh_RCU_READ_UNLOCK(rcu) ((void) 0)
+#endif
+
+/* add ptr to the list of retired allocations
+ * tagged with the current epoch
+ *
+ * returns 1 on success
+ * returns 0 on failure (ptr is leaked)
+ */
+unsigned int glh_rcu_defer(struct glh_rcu *rcu, void *ptr){
+    struct glh_rcu_retired *retired = 0;
+
+    if( ! ptr ){
+        return 1;
+    }
+
+    retired = malloc(sizeof(struct glh_rcu_retired));
+    if( ! retired ){
+        puts("glh_rcu_defer: call to malloc failed, leaking ptr");
+        return 0;
+    }
+
+    retired->ptr = ptr;
+    retired->epoch = rcu->epoch;
+    retired->next = rcu->retired;
+    rcu->retired = retired;
+
+    return 1;
+}
+
+/* glh_allocator functions for the writer's table, ctx is our glh_rcu
+ * allocations are plain malloc / calloc, only freeing is deferred
+ */
+void * glh_rcu_alloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return malloc(size);
+}
+
+void * glh_rcu_zalloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return calloc(1, size);
+}
+
+void glh_rcu_dealloc(void *ctx, void *ptr, size_t size){
+    (void) size;
+    glh_rcu_defer(ctx, ptr);
+}
+
+/* everything retired so far is now unreachable by new lookups
+ * so move on to the next epoch
+ */
+void glh_rcu_advance(struct glh_rcu *rcu){
+    __atomic_add_fetch(&(rcu->epoch), 1, __ATOMIC_SEQ_CST);
+}
+
+/* free anything retired before every reader's latest quiescent state
+ * with lock held
+ *
+ * returns number of allocations freed
+ */
+size_t glh_rcu_reclaim_locked(struct glh_rcu *rcu){
+    /* oldest epoch any reader may still be in */
+    unsigned long int min = rcu->epoch;
+    /* what a reader has seen */
+    unsigned long int seen = 0;
+    struct glh_rcu_reader *reader = 0;
+    /* link pointing at the retired allocation we are checking */
+    struct glh_rcu_retired **link = 0;
+    struct glh_rcu_retired *retired = 0;
+    size_t n = 0;
+
+    for( reader = rcu->readers; reader; reader = reader->next ){
+        /* pairs with the release in glh_rcu_quiescent,
+         * the reader is done with anything retired before seen
+         */
+        seen = __atomic_load_n(&(reader->seen), __ATOMIC_ACQUIRE);
+        if( seen < min ){
+            min = seen;
+        }
+    }
+
+    link = &(rcu->retired);
+    while( *link ){
+        retired = *link;
+
+        if( retired->epoch >= min ){
+            link = &(retired->next);
+            continue;
+        }
+
+        *link = retired->next;
+        free(retired->ptr);
+        free(retired);
+        ++n;
+    }
+
+    return n;
+}
+
+/* publish a copy of the writer's table for readers,
+ * snap is an allocation of sizeof(struct glh_table) to hold it
+ * the previous snapshot is retired
+ */
+void glh_rcu_publish(struct glh_rcu *rcu, struct glh_table *snap){
+    struct glh_table *old = 0;
+
+    *snap = rcu->table;
+
+    old = __atomic_exchange_n(&(rcu->snapshot), snap, __ATOMIC_ACQ_REL);
+    glh_rcu_defer(rcu, old);
+
+    glh_rcu_advance(rcu);
+    glh_rcu_reclaim_locked(rcu);
+}
+
+/* resize the writer's table and publish it, with lock held
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_resize_locked(struct glh_rcu *rcu, size_t new_size){
+    /* allocated up front, once resized the old entries are retired
+     * and readers must be moved off of them
+     */
+    struct glh_table *snap = 0;
+
+    snap = malloc(sizeof(struct glh_table));
+    if( ! snap ){
+        puts("glh_rcu_resize_locked: call to malloc failed");
+        return 0;
+    }
+
+    if( ! glh_resize(&(rcu->table), new_size) ){
+        puts("glh_rcu_resize_locked: call to glh_resize failed");
+        free(snap);
+        return 0;
+    }
+
+    glh_rcu_publish(rcu, snap);
+
+    return 1;
+}
+
+/* find key in snap as a reader, never writing to snap
+ *
+ * returns index of key on success
+ * returns snap->size if key was not found
+ */
+size_t glh_rcu_find(const struct glh_table *snap, unsigned long int hash, const char *key){
+    /* position in snap */
+    size_t pos = glh_table_pos(snap, hash, snap->size);
+    /* number of slots probed */
+    size_t n = 0;
+    struct glh_entry *cur = 0;
+    enum glh_entry_state state = glh_ENTRY_EMPTY;
+
+    for( n=0; n < snap->size; ++n ){
+        cur = &(snap->entries[pos]);
+
+        /* pairs with the release in glh_rcu_fill,
+         * an occupied slot's key and hash are complete
+         */
+        state = __atomic_load_n(&(cur->state), __ATOMIC_ACQUIRE);
+
+        if( state == glh_ENTRY_EMPTY ){
+            break;
+        }
+
+        if( state == glh_ENTRY_OCCUPIED && glh_entry_eq(snap, cur, hash, key) ){
+            return pos;
+        }
+
+        if( ++pos == snap->size ){
+            pos = 0;
+        }
+    }
+
+    return snap->size;
+}
+
+/* fill in an empty slot from entry and only then mark it occupied */
+void glh_rcu_fill(struct glh_entry *slot, const struct glh_entry *entry){
+    slot->dist = entry->dist;
+    slot->hash = entry->hash;
+    slot->key  = entry->key;
+    slot->data = entry->data;
+
+#if glh_INLINE_KEY_LEN
+    slot->key_len = entry->key_len;
+    memcpy(slot->inline_key, entry->inline_key, glh_INLINE_KEY_LEN);
+#endif
+
+    __atomic_store_n(&(slot->state), glh_ENTRY_OCCUPIED, __ATOMIC_RELEASE);
+}
+
+/* free the writer's table and everything retired, with no readers left
+ * this will only free the *data pointers if `free_data` is set to 1
+ */
+void glh_rcu_destroy_table(struct glh_rcu *rcu, unsigned int free_data){
+    struct glh_rcu_retired *retired = 0;
+    /* iterator through entries */
+    size_t i = 0;
+
+    /* deleted slots keep their data for readers,
+     * it now belongs to whoever deleted it
+     */
+    for( i=0; i < rcu->table.size; ++i ){
+        if( rcu->table.entries[i].state != glh_ENTRY_OCCUPIED ){
+            rcu->table.entries[i].data = 0;
+        }
+    }
+
+    /* nobody is left looking, free directly */
+    rcu->table.allocator.dealloc = glh_default_dealloc;
+    if( ! glh_destroy(&(rcu->table), 0, free_data) ){
+        puts("glh_rcu_destroy_table: call to glh_destroy failed, continuing...");
+    }
+
+    while( rcu->retired ){
+        retired = rcu->retired;
+        rcu->retired = retired->next;
+        free(retired->ptr);
+        free(retired);
+    }
+}
+
+/* allocate and initialise a new glh_rcu
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_rcu * glh_rcu_new(
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    struct glh_rcu *rcu = 0;
+    /* first snapshot */
+    struct glh_table *snap = 0;
+    /* our retiring allocator, ctx is rcu */
+    struct glh_allocator allocator;
+
+    if( ! hash_func ){
+        puts("glh_rcu_new: hash_func was undef");
+        return 0;
+    }
+
+    rcu = calloc(1, sizeof(struct glh_rcu));
+    if( ! rcu ){
+        puts("glh_rcu_new: call to calloc failed");
+        return 0;
+    }
+
+    snap = malloc(sizeof(struct glh_table));
+    if( ! snap ){
+        puts("glh_rcu_new: call to malloc failed");
+        free(rcu);
+        return 0;
+    }
+
+    allocator.alloc   = glh_rcu_alloc;
+    allocator.zalloc  = glh_rcu_zalloc;
+    allocator.dealloc = glh_rcu_dealloc;
+    allocator.ctx     = rcu;
+
+    if( ! glh_init_with_allocator(&(rcu->table), glh_RCU_SIZE, hash_func, equal_func, &allocator) ){
+        puts("glh_rcu_new: call to glh_init_with_allocator failed");
+        free(snap);
+        free(rcu);
+        return 0;
+    }
+
+    if( pthread_mutex_init(&(rcu->lock), 0) ){
+        puts("glh_rcu_new: call to pthread_mutex_init failed");
+        glh_rcu_destroy_table(rcu, 0);
+        free(snap);
+        free(rcu);
+        return 0;
+    }
+
+    /* cheaper slot selection for every lookup */
+    if( ! glh_tune_pow2(&(rcu->table), 1) ){
+        puts("glh_rcu_new: call to glh_tune_pow2 failed");
+        pthread_mutex_destroy(&(rcu->lock));
+        glh_rcu_destroy_table(rcu, 0);
+        free(snap);
+        free(rcu);
+        return 0;
+    }
+
+    /* nobody can see this table yet */
+    *snap = rcu->table;
+    rcu->snapshot = snap;
+
+    return rcu;
+}
+
+/* free an existing glh_rcu
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_destroy(struct glh_rcu *rcu, unsigned int free_data){
+    struct glh_rcu_reader *reader = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_destroy: rcu was null");
+        return 0;
+    }
+
+    glh_rcu_destroy_table(rcu, free_data);
+
+    while( rcu->readers ){
+        reader = rcu->readers;
+        rcu->readers = reader->next;
+        free(reader);
+    }
+
+    pthread_mutex_destroy(&(rcu->lock));
+    free(rcu->snapshot);
+    free(rcu);
+
+    return 1;
+}
+
+/* register the calling thread as a reader of rcu
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_rcu_reader * glh_rcu_reader_register(struct glh_rcu *rcu){
+    struct glh_rcu_reader *reader = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_reader_register: rcu was null");
+        return 0;
+    }
+
+    reader = calloc(1, sizeof(struct glh_rcu_reader));
+    if( ! reader ){
+        puts("glh_rcu_reader_register: call to calloc failed");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+    /* we cannot be holding anything retired before now */
+    reader->seen = rcu->epoch;
+    reader->next = rcu->readers;
+    rcu->readers = reader;
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return reader;
+}
+
+/* unregister and free a reader
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_reader_unregister(struct glh_rcu *rcu, struct glh_rcu_reader *reader){
+    /* link pointing at the reader we are checking */
+    struct glh_rcu_reader **link = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_reader_unregister: rcu was null");
+        return 0;
+    }
+
+    if( ! reader ){
+        puts("glh_rcu_reader_unregister: reader was null");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+
+    for( link = &(rcu->readers); *link; link = &((*link)->next) ){
+        if( *link == reader ){
+            break;
+        }
+    }
+
+    if( ! *link ){
+        pthread_mutex_unlock(&(rcu->lock));
+        puts("glh_rcu_reader_unregister: reader is not registered with rcu");
+        return 0;
+    }
+
+    *link = reader->next;
+
+    pthread_mutex_unlock(&(rcu->lock));
+
+    free(reader);
+
+    return 1;
+}
+
+/* announce that reader holds no pointers it got from rcu */
+void glh_rcu_quiescent(struct glh_rcu *rcu, struct glh_rcu_reader *reader){
+    if( ! rcu || ! reader ){
+        return;
+    }
+
+    /* seq_cst so that our next lookup cannot load the snapshot
+     * before the epoch, the writer only advances the epoch
+     * after publishing, so we will see that snapshot or a newer one
+     */
+    __atomic_store_n(&(reader->seen), __atomic_load_n(&(rcu->epoch), __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+/* free anything retired which no reader can still be looking at
+ *
+ * returns number of allocations freed
+ */
+size_t glh_rcu_reclaim(struct glh_rcu *rcu){
+    size_t n = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_reclaim: rcu was null");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+    n = glh_rcu_reclaim_locked(rcu);
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return n;
+}
+
+/* hand ptr to rcu to be freed once no reader can still be looking at it
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_retire(struct glh_rcu *rcu, void *ptr){
+    unsigned int ret = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_retire: rcu was null");
+        return 0;
+    }
+
+    if( ! ptr ){
+        puts("glh_rcu_retire: ptr was null");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+    /* ptr is already unreachable, so readers only need to
+     * pass through one more quiescent state
+     */
+    ret = glh_rcu_defer(rcu, ptr);
+    glh_rcu_advance(rcu);
+    pthread_mutex_unlock(&(rcu->lock));
+
+    if( ! ret ){
+        puts("glh_rcu_retire: call to glh_rcu_defer failed");
+    }
+
+    return ret;
+}
+
+/* number of elements in rcu
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_rcu_nelems(struct glh_rcu *rcu){
+    size_t n = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_nelems: rcu was null");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+    n = rcu->table.n_elems;
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return n;
+}
+
+/* resize rcu to hold new_size slots
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_resize(struct glh_rcu *rcu, size_t new_size){
+    unsigned int ret = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_resize: rcu was null");
+        return 0;
+    }
+
+    pthread_mutex_lock(&(rcu->lock));
+    ret = glh_rcu_resize_locked(rcu, new_size);
+    pthread_mutex_unlock(&(rcu->lock));
+
+    if( ! ret ){
+        puts("glh_rcu_resize: call to glh_rcu_resize_locked failed");
+    }
+
+    return ret;
+}
+
+/* as glh_exists, lock free
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_rcu_exists(struct glh_rcu *rcu, const char *key){
+    /* the table we look in, fixed for the whole lookup */
+    const struct glh_table *snap = 0;
+    unsigned int ret = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_exists: rcu was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_rcu_exists: key undef");
+        return 0;
+    }
+
+    glh_RCU_READ_LOCK(rcu);
+
+    /* pairs with the release in glh_rcu_publish */
+    snap = __atomic_load_n(&(rcu->snapshot), __ATOMIC_ACQUIRE);
+    ret = glh_rcu_find(snap, snap->hash_func(key), key) < snap->size;
+
+    glh_RCU_READ_UNLOCK(rcu);
+
+    return ret;
+}
+
+/* as glh_get, lock free
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_get(struct glh_rcu *rcu, const char *key){
+    /* the table we look in, fixed for the whole lookup */
+    const struct glh_table *snap = 0;
+    /* index of key in snap */
+    size_t pos = 0;
+    void *data = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_get: rcu was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_rcu_get: key undef");
+        return 0;
+    }
+
+    glh_RCU_READ_LOCK(rcu);
+
+    /* pairs with the release in glh_rcu_publish */
+    snap = __atomic_load_n(&(rcu->snapshot), __ATOMIC_ACQUIRE);
+    pos = glh_rcu_find(snap, snap->hash_func(key), key);
+    if( pos < snap->size ){
+        /* pairs with the release in glh_rcu_set */
+        data = __atomic_load_n(&(snap->entries[pos].data), __ATOMIC_ACQUIRE);
+    }
+
+    glh_RCU_READ_UNLOCK(rcu);
+
+    return data;
+}
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_insert(struct glh_rcu *rcu, const char *key, void *data){
+    struct glh_table *table = 0;
+    unsigned long int hash = 0;
+    /* position in table */
+    size_t pos = 0;
+    /* our new entry, built aside and then copied in */
+    struct glh_entry entry;
+    unsigned int ret = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_insert: rcu was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_rcu_insert: key undef");
+        return 0;
+    }
+
+    table = &(rcu->table);
+    hash = table->hash_func(key);
+
+    pthread_mutex_lock(&(rcu->lock));
+
+    if( glh_probe(table, hash, key, &pos) ){
+        puts("glh_rcu_insert: key already exists in table");
+        goto glh_RCU_INSERT_DONE;
+    }
+
+    /* as glh_insert we check the load before the insert,
+     * dummies are never reused as a reader may still be
+     * comparing against them so also count towards a rebuild
+     */
+    if( (table->n_elems * 10) / table->size >= table->threshold ){
+        if( ! glh_rcu_resize_locked(rcu, table->size * glh_RCU_SCALING_FACTOR) ){
+            puts("glh_rcu_insert: call to glh_rcu_resize_locked failed");
+            goto glh_RCU_INSERT_DONE;
+        }
+    } else if( ((table->n_elems + table->n_dummies) * 10) / table->size >= table->threshold ){
+        if( ! glh_rcu_resize_locked(rcu, table->size) ){
+            puts("glh_rcu_insert: call to glh_rcu_resize_locked failed");
+            goto glh_RCU_INSERT_DONE;
+        }
+    }
+
+    /* first empty slot, there is always one below the threshold */
+    pos = glh_table_pos(table, hash, table->size);
+    while( table->entries[pos].state != glh_ENTRY_EMPTY ){
+        if( ++pos == table->size ){
+            pos = 0;
+        }
+    }
+
+    /*                  (table, entry,  hash, key,data) */
+    if( ! glh_entry_init(table, &entry, hash, key, data) ){
+        puts("glh_rcu_insert: call to glh_entry_init failed");
+        goto glh_RCU_INSERT_DONE;
+    }
+
+    glh_rcu_fill(&(table->entries[pos]), &entry);
+    ++table->n_elems;
+    ret = 1;
+
+glh_RCU_INSERT_DONE:
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return ret;
+}
+
+/* as glh_set
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_set(struct glh_rcu *rcu, const char *key, void *data){
+    struct glh_table *table = 0;
+    unsigned long int hash = 0;
+    /* position in table */
+    size_t pos = 0;
+    void *old_data = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_set: rcu was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_rcu_set: key undef");
+        return 0;
+    }
+
+    table = &(rcu->table);
+    hash = table->hash_func(key);
+
+    pthread_mutex_lock(&(rcu->lock));
+
+    if( glh_probe(table, hash, key, &pos) ){
+        old_data = table->entries[pos].data;
+        __atomic_store_n(&(table->entries[pos].data), data, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return old_data;
+}
+
+/* as glh_delete
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_delete(struct glh_rcu *rcu, const char *key){
+    struct glh_table *table = 0;
+    unsigned long int hash = 0;
+    /* position in table */
+    size_t pos = 0;
+    void *data = 0;
+
+    if( ! rcu ){
+        puts("glh_rcu_delete: rcu was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_rcu_delete: key undef");
+        return 0;
+    }
+
+    table = &(rcu->table);
+    hash = table->hash_func(key);
+
+    pthread_mutex_lock(&(rcu->lock));
+
+    if( glh_probe(table, hash, key, &pos) ){
+        data = table->entries[pos].data;
+
+        /* key and data are left in place for any reader
+         * which already matched this slot
+         */
+        __atomic_store_n(&(table->entries[pos].state), glh_ENTRY_DUMMY, __ATOMIC_RELEASE);
+
+        --table->n_elems;
+        ++table->n_dummies;
+    }
+
+    pthread_mutex_unlock(&(rcu->lock));
+
+    return data;
+}
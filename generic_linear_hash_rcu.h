@@ -0,0 +1,176 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_rcu_H
+#define generic_linear_hash_rcu_H
+
+#include "generic_linear_hash.h"
+
+/* a thread safe table for read mostly workloads where lookups
+ * never take a lock or write to shared memory
+ *
+ * changes are serialised by a single writer lock,
+ * inside of that each change is published with atomic stores:
+ *  a new slot is filled in before it's state is marked occupied,
+ *  a delete only marks it's slot as a dummy (key and data are left),
+ *  a set replaces the data pointer in one store,
+ *  slots are never reused until the next resize
+ *
+ * a resize builds a new glh_table and swaps a single pointer to it,
+ * anything a lookup may still be reading (old entries, old tables)
+ * is retired rather than freed and only freed once every reader
+ * has since passed through a quiescent state (glh_rcu_quiescent)
+ *
+ * every thread calling glh_rcu_get or glh_rcu_exists must first
+ * register with glh_rcu_reader_register and then regularly call
+ * glh_rcu_quiescent at a point where it holds no pointers
+ * it got from the table, a reader that never does so stops
+ * anything from being freed until it unregisters
+ *
+ * when compiled with glh_STATS lookups also update counters
+ * so take the writer lock instead
+ *
+ * struct glh_rcu is opaque so that including this header
+ * does not require pthreads
+ */
+struct glh_rcu;
+
+/* a registered reader thread, see glh_rcu_reader_register */
+struct glh_rcu_reader;
+
+/* allocate and initialise a new glh_rcu
+ *
+ * hash_func and equal_func are as for glh_new
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_rcu * glh_rcu_new(
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+        );
+
+/* free an existing glh_rcu, everything still waiting to be freed
+ * and any readers which never unregistered
+ * this will only free the *data pointers if `free_data` is set to 1
+ *
+ * no other thread may be using rcu
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_destroy(struct glh_rcu *rcu, unsigned int free_data);
+
+/* register the calling thread as a reader of rcu
+ * the returned reader is only to be used by this thread
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_rcu_reader * glh_rcu_reader_register(struct glh_rcu *rcu);
+
+/* unregister and free a reader from glh_rcu_reader_register
+ * the thread must not touch rcu's memory afterwards
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_reader_unregister(struct glh_rcu *rcu, struct glh_rcu_reader *reader);
+
+/* announce that reader holds no pointers it got from rcu
+ * this is a single atomic store and never blocks
+ */
+void glh_rcu_quiescent(struct glh_rcu *rcu, struct glh_rcu_reader *reader);
+
+/* free anything retired which no reader can still be looking at
+ * this is also done after every resize
+ *
+ * returns number of allocations freed
+ */
+size_t glh_rcu_reclaim(struct glh_rcu *rcu);
+
+/* hand ptr to rcu to be passed to free once no reader can still
+ * be looking at it, e.g. the data returned by glh_rcu_delete
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_retire(struct glh_rcu *rcu, void *ptr);
+
+/* number of elements in rcu
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_rcu_nelems(struct glh_rcu *rcu);
+
+/* resize rcu to hold new_size slots, readers move to
+ * the new table the next time they look something up
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_resize(struct glh_rcu *rcu, size_t new_size);
+
+/* as glh_exists, lock free
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_rcu_exists(struct glh_rcu *rcu, const char *key);
+
+/* as glh_get, lock free
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_get(struct glh_rcu *rcu, const char *key);
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_rcu_insert(struct glh_rcu *rcu, const char *key, void *data);
+
+/* as glh_set
+ * readers may still see the old data until they are next quiescent,
+ * see glh_rcu_retire
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_set(struct glh_rcu *rcu, const char *key, void *data);
+
+/* as glh_delete
+ * readers may still see the data (and key) until they are next
+ * quiescent, see glh_rcu_retire
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_rcu_delete(struct glh_rcu *rcu, const char *key);
+
+#endif // ifndef generic_linear_hash_rcu_H
@@ -0,0 +1,519 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* calloc, free */
+#include <stddef.h> /* size_t */
+#include <limits.h> /* CHAR_BIT */
+
+#include "generic_linear_hash_sharded.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash.c */
+size_t glh_pos_top(unsigned long int hash, unsigned int shift);
+
+/* number of slots each shard starts with */
+#define glh_SHARDED_SHARD_SIZE 32
+
+struct glh_sharded {
+    /* number of shards, always a power of two */
+    size_t n_shards;
+    /* how far to shift a hash right to leave just the shard bits */
+    unsigned int shift;
+    /* array of n_shards tables */
+    struct glh_table *shards;
+    /* hashing function, also held by every shard */
+    unsigned long int (*hash_func)(const void *key);
+};
+
+/* index of the shard for hash from the top bits of it's mix */
+size_t glh_sharded_index(const struct glh_sharded *sharded, unsigned long int hash){
+    /* a shift by the full width of hash would be undefined */
+    if( sharded->n_shards == 1 ){
+        return 0;
+    }
+
+    return glh_pos_top(hash, sharded->shift);
+}
+
+/* hash of key, for callers which only see an opaque glh_sharded */
+unsigned long int glh_sharded_hash(const struct glh_sharded *sharded, const char *key){
+    return sharded->hash_func(key);
+}
+
+/* select the shard for hash */
+struct glh_table * glh_sharded_table(const struct glh_sharded *sharded, unsigned long int hash){
+    return &(sharded->shards[glh_sharded_index(sharded, hash)]);
+}
+
+/* allocate and initialise a new glh_sharded of n_shards shards
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_sharded * glh_sharded_new(
+        size_t n_shards,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    struct glh_sharded *sharded = 0;
+    /* number of shards set up so far */
+    size_t i = 0;
+    /* log2 of n_shards */
+    unsigned int bits = 0;
+
+    if( ! n_shards ){
+        puts("glh_sharded_new: n_shards was 0");
+        return 0;
+    }
+
+    if( ! hash_func ){
+        puts("glh_sharded_new: hash_func was undef");
+        return 0;
+    }
+
+    sharded = calloc(1, sizeof(struct glh_sharded));
+    if( ! sharded ){
+        puts("glh_sharded_new: call to calloc failed");
+        return 0;
+    }
+
+    sharded->n_shards = 1;
+    while( sharded->n_shards < n_shards ){
+        sharded->n_shards <<= 1;
+        ++bits;
+    }
+
+    if( bits >= sizeof(unsigned long int) * CHAR_BIT ){
+        puts("glh_sharded_new: n_shards is too large");
+        free(sharded);
+        return 0;
+    }
+
+    sharded->shift = sizeof(unsigned long int) * CHAR_BIT - bits;
+    sharded->hash_func = hash_func;
+
+    sharded->shards = calloc(sharded->n_shards, sizeof(struct glh_table));
+    if( ! sharded->shards ){
+        puts("glh_sharded_new: call to calloc failed");
+        free(sharded);
+        return 0;
+    }
+
+    for( i=0; i < sharded->n_shards; ++i ){
+        if( ! glh_init(&(sharded->shards[i]), glh_SHARDED_SHARD_SIZE, hash_func, equal_func) ){
+            puts("glh_sharded_new: call to glh_init failed");
+            break;
+        }
+    }
+
+    /* unwind any shards we did set up */
+    if( i < sharded->n_shards ){
+        while( i-- ){
+            glh_destroy(&(sharded->shards[i]), 0, 0);
+        }
+        free(sharded->shards);
+        free(sharded);
+        return 0;
+    }
+
+    return sharded;
+}
+
+/* free an existing glh_sharded and all of it's shards
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_destroy(struct glh_sharded *sharded, unsigned int free_data){
+    /* iterator through shards */
+    size_t i = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_destroy: sharded was null");
+        return 0;
+    }
+
+    for( i=0; i < sharded->n_shards; ++i ){
+        if( ! glh_destroy(&(sharded->shards[i]), 0, free_data) ){
+            puts("glh_sharded_destroy: call to glh_destroy failed, continuing...");
+        }
+    }
+
+    free(sharded->shards);
+    free(sharded);
+
+    return 1;
+}
+
+/* number of shards in sharded
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_sharded_nshards(const struct glh_sharded *sharded){
+    if( ! sharded ){
+        puts("glh_sharded_nshards: sharded was null");
+        return 0;
+    }
+
+    return sharded->n_shards;
+}
+
+/* total number of elements over every shard
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_sharded_nelems(const struct glh_sharded *sharded){
+    /* iterator through shards */
+    size_t i = 0;
+    /* running total */
+    size_t n = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_nelems: sharded was null");
+        return 0;
+    }
+
+    for( i=0; i < sharded->n_shards; ++i ){
+        n += sharded->shards[i].n_elems;
+    }
+
+    return n;
+}
+
+/* the i-th shard's glh_table
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_sharded_shard(struct glh_sharded *sharded, size_t i){
+    if( ! sharded ){
+        puts("glh_sharded_shard: sharded was null");
+        return 0;
+    }
+
+    if( i >= sharded->n_shards ){
+        puts("glh_sharded_shard: i out of range");
+        return 0;
+    }
+
+    return &(sharded->shards[i]);
+}
+
+/* index of the shard key is routed to
+ *
+ * returns index on success
+ * returns glh_sharded_nshards(sharded) on failure
+ */
+size_t glh_sharded_which(const struct glh_sharded *sharded, const char *key){
+    if( ! sharded ){
+        puts("glh_sharded_which: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_which: key undef");
+        return sharded->n_shards;
+    }
+
+    return glh_sharded_index(sharded, sharded->hash_func(key));
+}
+
+/* glh_sharded_apply callback resizing each shard to *(size_t *) ctx */
+unsigned int glh_sharded_resize_shard(struct glh_table *table, void *ctx){
+    /* size of each shard */
+    size_t size = *(size_t *) ctx;
+
+    /* never so small that a shard's elements no longer fit */
+    if( size <= table->n_elems ){
+        size = table->n_elems + 1;
+    }
+
+    return glh_resize(table, size);
+}
+
+/* glh_sharded_apply callback reserving *(size_t *) ctx elements in each shard */
+unsigned int glh_sharded_reserve_shard(struct glh_table *table, void *ctx){
+    return glh_reserve(table, *(size_t *) ctx);
+}
+
+/* resize sharded to hold new_size slots in total
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_resize(struct glh_sharded *sharded, size_t new_size){
+    /* size of each shard */
+    size_t shard_size = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_resize: sharded was null");
+        return 0;
+    }
+
+    if( new_size == 0 ){
+        puts("glh_sharded_resize: asked for new_size of 0, impossible");
+        return 0;
+    }
+
+    shard_size = (new_size + sharded->n_shards - 1) / sharded->n_shards;
+
+    if( ! glh_sharded_apply(sharded, glh_sharded_resize_shard, &shard_size) ){
+        puts("glh_sharded_resize: call to glh_sharded_apply failed");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* make room for n elements in total without any further resizing
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_reserve(struct glh_sharded *sharded, size_t n){
+    /* elements expected in each shard */
+    size_t shard_n = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_reserve: sharded was null");
+        return 0;
+    }
+
+    shard_n = (n + sharded->n_shards - 1) / sharded->n_shards;
+
+    if( ! glh_sharded_apply(sharded, glh_sharded_reserve_shard, &shard_n) ){
+        puts("glh_sharded_reserve: call to glh_sharded_apply failed");
+        return 0;
+    }
+
+    return 1;
+}
+
+/* call func(table, ctx) on each shard in turn
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_apply(struct glh_sharded *sharded,
+                               unsigned int (*func)(struct glh_table *table, void *ctx),
+                               void *ctx){
+    /* iterator through shards */
+    size_t i = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_apply: sharded was null");
+        return 0;
+    }
+
+    if( ! func ){
+        puts("glh_sharded_apply: func was null");
+        return 0;
+    }
+
+    for( i=0; i < sharded->n_shards; ++i ){
+        if( ! func(&(sharded->shards[i]), ctx) ){
+            puts("glh_sharded_apply: func failed");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* as glh_exists
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_sharded_exists(const struct glh_sharded *sharded, const char *key){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_exists: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_exists: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_exists_hashed(glh_sharded_table(sharded, hash), hash, key);
+}
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_insert(struct glh_sharded *sharded, const char *key, void *data){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_insert: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_insert: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_insert_hashed(glh_sharded_table(sharded, hash), hash, key, data);
+}
+
+/* as glh_set
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_set(struct glh_sharded *sharded, const char *key, void *data){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_set: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_set: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_set_hashed(glh_sharded_table(sharded, hash), hash, key, data);
+}
+
+/* as glh_get
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_get(const struct glh_sharded *sharded, const char *key){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_get: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_get: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_get_hashed(glh_sharded_table(sharded, hash), hash, key);
+}
+
+/* as glh_try_get
+ *
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found or on failure, *data is untouched
+ */
+unsigned int glh_sharded_try_get(const struct glh_sharded *sharded, const char *key, void **data){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_try_get: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_try_get: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_try_get_hashed(glh_sharded_table(sharded, hash), hash, key, data);
+}
+
+/* as glh_find_or_insert
+ *
+ * returns a pointer to key's data on success
+ * returns 0 on failure
+ */
+void ** glh_sharded_find_or_insert(struct glh_sharded *sharded, const char *key, unsigned int *created){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_find_or_insert: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_find_or_insert: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_find_or_insert_hashed(glh_sharded_table(sharded, hash), hash, key, created);
+}
+
+/* as glh_delete
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_delete(struct glh_sharded *sharded, const char *key){
+    /* hash of key, also selects it's shard */
+    unsigned long int hash = 0;
+
+    if( ! sharded ){
+        puts("glh_sharded_delete: sharded was null");
+        return 0;
+    }
+
+    if( ! key ){
+        puts("glh_sharded_delete: key undef");
+        return 0;
+    }
+
+    hash = sharded->hash_func(key);
+
+    return glh_delete_hashed(glh_sharded_table(sharded, hash), hash, key);
+}
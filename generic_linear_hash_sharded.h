@@ -0,0 +1,182 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_sharded_H
+#define generic_linear_hash_sharded_H
+
+#include "generic_linear_hash.h"
+
+/* a table made up of a number of shards,
+ * each shard is an independent glh_table
+ *
+ * every key is routed to a shard by the top bits of it's hash
+ * (multiplied by a constant first, so every bit counts),
+ * the low bits still select it's slot within the shard
+ *
+ * each shard grows (or shrinks) on it's own, so a resize only
+ * rehashes 1/n_shards of the elements and the cost of growing
+ * is spread out rather than paid all at once
+ *
+ * nothing here is thread safe, but shards share no state,
+ * so different threads may each work on different shards
+ * (see glh_sharded_shard and glh_sharded_which),
+ * e.g. one thread per shard, or one lock per shard
+ * as glh_locked (generic_linear_hash_locked.h) does
+ */
+struct glh_sharded;
+
+/* allocate and initialise a new glh_sharded of n_shards shards
+ *
+ * n_shards is rounded up to the next power of two
+ *
+ * hash_func and equal_func are as for glh_new
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_sharded * glh_sharded_new(
+        size_t n_shards,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+        );
+
+/* free an existing glh_sharded and all of it's shards
+ * this will only free the *data pointers if `free_data` is set to 1
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_destroy(struct glh_sharded *sharded, unsigned int free_data);
+
+/* number of shards in sharded
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_sharded_nshards(const struct glh_sharded *sharded);
+
+/* total number of elements over every shard
+ *
+ * returns number on success
+ * returns 0 on failure
+ */
+size_t glh_sharded_nelems(const struct glh_sharded *sharded);
+
+/* the i-th shard's glh_table, this may be used as any other
+ * glh_table (tuned, resized, walked with glh_iter) as long as
+ * only keys routed to shard i are ever inserted into it
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_sharded_shard(struct glh_sharded *sharded, size_t i);
+
+/* index of the shard key is routed to
+ *
+ * returns index on success
+ * returns glh_sharded_nshards(sharded) on failure
+ */
+size_t glh_sharded_which(const struct glh_sharded *sharded, const char *key);
+
+/* resize sharded to hold new_size slots in total
+ * split evenly between the shards
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_resize(struct glh_sharded *sharded, size_t new_size);
+
+/* make room for n elements in total without any further resizing
+ * as glh_reserve, assuming keys are spread evenly between shards
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_reserve(struct glh_sharded *sharded, size_t n);
+
+/* call func(table, ctx) on each shard's glh_table in turn
+ *
+ * func must return 1 on success and 0 on failure,
+ * we stop at the first failure
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_apply(struct glh_sharded *sharded,
+                               unsigned int (*func)(struct glh_table *table, void *ctx),
+                               void *ctx);
+
+/* as glh_exists
+ *
+ * returns 1 on success (key exists)
+ * returns 0 if key doesn't exist or on failure
+ */
+unsigned int glh_sharded_exists(const struct glh_sharded *sharded, const char *key);
+
+/* as glh_insert
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_sharded_insert(struct glh_sharded *sharded, const char *key, void *data);
+
+/* as glh_set
+ *
+ * returns old data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_set(struct glh_sharded *sharded, const char *key, void *data);
+
+/* as glh_get
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_get(const struct glh_sharded *sharded, const char *key);
+
+/* as glh_try_get
+ *
+ * returns 1 if key was found, *data is set
+ * returns 0 if key was not found or on failure, *data is untouched
+ */
+unsigned int glh_sharded_try_get(const struct glh_sharded *sharded, const char *key, void **data);
+
+/* as glh_find_or_insert
+ * the returned pointer is only valid until the next
+ * insert, delete or resize on key's shard
+ *
+ * returns a pointer to key's data on success
+ * returns 0 on failure
+ */
+void ** glh_sharded_find_or_insert(struct glh_sharded *sharded, const char *key, unsigned int *created);
+
+/* as glh_delete
+ *
+ * returns data on success
+ * returns 0 on failure
+ */
+void * glh_sharded_delete(struct glh_sharded *sharded, const char *key);
+
+#endif // ifndef generic_linear_hash_sharded_H
@@ -0,0 +1,578 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* open, fstat, write, mmap and madvise are posix rather than c99 */
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* malloc, calloc, free */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t, uint64_t, uintptr_t */
+#include <string.h> /* memcmp, memcpy, memset, strlen */
+#include <errno.h> /* errno, EINTR */
+#include <fcntl.h> /* open, O_RDONLY */
+#include <unistd.h> /* write, close */
+#include <sys/stat.h> /* fstat */
+#include <sys/mman.h> /* mmap, munmap, madvise */
+
+#include "generic_linear_hash_snapshot.h"
+
+/* leaving this in place as we have some internal only helper functions
+ * that we only exposed to allow for easy testing and extension
+ */
+#pragma GCC diagnostic ignored "-Wmissing-prototypes"
+
+/* internal helpers from generic_linear_hash.c */
+void * glh_alloc_array(const struct glh_allocator *allocator, size_t n, size_t size, unsigned int zero);
+void glh_free_array(const struct glh_allocator *allocator, void *ptr, size_t n, size_t size);
+size_t glh_round_pow2(size_t n);
+size_t glh_capacity_size(size_t n, unsigned int threshold);
+size_t glh_entries_len(const struct glh_table *table);
+
+/* first bytes of every snapshot */
+#define glh_SNAPSHOT_MAGIC "glhsnap"
+
+/* written as a native uint32_t, read back differently on
+ * a machine of the other byte order
+ */
+#define glh_SNAPSHOT_ENDIAN 0x01020304
+
+/* the header is padded out to this, so the slots start page aligned */
+#define glh_SNAPSHOT_PAGE 4096
+
+/* saved data is aligned to this within the snapshot */
+#define glh_SNAPSHOT_DATA_ALIGN 16
+
+/* bytes buffered by glh_save before each call to write */
+#define glh_SNAPSHOT_BUFFER (64 * 1024)
+
+/* start of every snapshot, followed by padding up to glh_SNAPSHOT_PAGE */
+struct glh_snapshot_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    /* sizeof(unsigned long int), width of the saved hashes */
+    uint32_t hash_bytes;
+    /* sizeof(struct glh_map_slot) */
+    uint32_t slot_bytes;
+    /* number of slots, always a power of two */
+    uint64_t size;
+    uint64_t n_elems;
+    /* offset of the first struct glh_map_slot */
+    uint64_t slots_offset;
+    /* length of the whole snapshot */
+    uint64_t file_len;
+};
+
+/* buffered sequential writes to a file descriptor */
+struct glh_snapshot_writer {
+    int fd;
+    /* set once any write has failed, later writes are then ignored */
+    unsigned int failed;
+    /* bytes in buf */
+    size_t len;
+    /* bytes written (or buffered) so far, our offset within the snapshot */
+    uint64_t offset;
+    unsigned char buf[glh_SNAPSHOT_BUFFER];
+};
+
+/* write out everything buffered in writer
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_snapshot_flush(struct glh_snapshot_writer *writer){
+    /* bytes written so far */
+    size_t done = 0;
+    ssize_t n = 0;
+
+    while( ! writer->failed && done < writer->len ){
+        n = write(writer->fd, writer->buf + done, writer->len - done);
+        if( n < 0 ){
+            if( errno == EINTR ){
+                continue;
+            }
+            puts("glh_snapshot_flush: call to write failed");
+            writer->failed = 1;
+        } else {
+            done += n;
+        }
+    }
+
+    writer->len = 0;
+    return ! writer->failed;
+}
+
+/* append len bytes of src (or len zero bytes if src is 0) */
+void glh_snapshot_write(struct glh_snapshot_writer *writer, const void *src, size_t len){
+    /* bytes to copy into buf this time round */
+    size_t n = 0;
+
+    writer->offset += len;
+
+    while( len ){
+        if( writer->len == glh_SNAPSHOT_BUFFER ){
+            glh_snapshot_flush(writer);
+        }
+
+        n = glh_SNAPSHOT_BUFFER - writer->len;
+        if( n > len ){
+            n = len;
+        }
+
+        if( src ){
+            memcpy(writer->buf + writer->len, src, n);
+            src = (const unsigned char *) src + n;
+        } else {
+            memset(writer->buf + writer->len, 0, n);
+        }
+
+        writer->len += n;
+        len -= n;
+    }
+}
+
+/* round offset up to a multiple of align, a power of two */
+uint64_t glh_snapshot_align(uint64_t offset, uint64_t align){
+    return (offset + align - 1) & ~(align - 1);
+}
+
+/* the next live entry of table from *pos on, walking entries and then
+ * the old_entries of any incremental grow in the same order as glh_iter,
+ * which only hands out keys and data where we also want the stored hash
+ *
+ * returns pointer on success
+ * returns 0 once every entry has been visited
+ */
+const struct glh_entry * glh_snapshot_next(const struct glh_table *table, size_t *pos){
+    /* number of entries to walk, old_entries follow on after these */
+    size_t len = glh_entries_len(table);
+    const struct glh_entry *cur = 0;
+
+    /* compact tables only ever use the front of entries */
+    if( table->index ){
+        len = table->n_elems + table->n_dummies;
+    }
+
+    for( ; *pos < len + table->old_size; ++*pos ){
+        if( *pos < len ){
+            cur = &(table->entries[*pos]);
+        } else {
+            cur = &(table->old_entries[*pos - len]);
+        }
+
+        /* migrated entries leave a dummy behind so are only seen once */
+        if( cur->state == glh_ENTRY_OCCUPIED ){
+            ++*pos;
+            return cur;
+        }
+    }
+
+    return 0;
+}
+
+/* length in bytes of key */
+size_t glh_snapshot_key_len(const struct glh_table *table, const char *key){
+    if( table->key_len_func ){
+        return table->key_len_func(key);
+    }
+
+    return strlen(key);
+}
+
+/* length in bytes of data to save, 0 to save the pointer's value */
+size_t glh_snapshot_data_len(size_t (*data_len_func)(const void *data), const void *data){
+    if( ! data_len_func || ! data ){
+        return 0;
+    }
+
+    return data_len_func(data);
+}
+
+unsigned int glh_save_with_data(const struct glh_table *table, int fd, size_t (*data_len_func)(const void *data)){
+    /* slots of the snapshot, laid out in memory before writing */
+    struct glh_map_slot *slots = 0;
+    size_t size = 0;
+    struct glh_snapshot_header header;
+    /* buffered writer, too large for the stack */
+    struct glh_snapshot_writer *writer = 0;
+    /* position of our walk through the table's entries */
+    size_t walk = 0;
+    const struct glh_entry *cur = 0;
+    size_t key_len = 0;
+    size_t data_len = 0;
+    /* where the next key or data goes */
+    uint64_t offset = 0;
+    size_t pos = 0;
+    unsigned int ret = 0;
+
+    if( ! table ){
+        puts("glh_save: table undef");
+        return 0;
+    }
+
+    if( fd < 0 ){
+        puts("glh_save: fd invalid");
+        return 0;
+    }
+
+    if( table->flags & glh_FLAG_MAPPED ){
+        puts("glh_save: table is already a mapping");
+        return 0;
+    }
+
+    /* always leave an empty slot so every probe ends */
+    size = glh_round_pow2(glh_capacity_size(table->n_elems, table->threshold));
+    if( size <= table->n_elems ){
+        puts("glh_save: table too large");
+        return 0;
+    }
+
+    slots = glh_alloc_array(&(table->allocator), size, sizeof(struct glh_map_slot), 1);
+    if( ! slots ){
+        puts("glh_save: call to glh_alloc_array failed");
+        return 0;
+    }
+
+    writer = malloc(sizeof(struct glh_snapshot_writer));
+    if( ! writer ){
+        puts("glh_save: call to malloc failed");
+        glh_free_array(&(table->allocator), slots, size, sizeof(struct glh_map_slot));
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(struct glh_snapshot_header));
+    memcpy(header.magic, glh_SNAPSHOT_MAGIC, sizeof(glh_SNAPSHOT_MAGIC));
+    header.version      = glh_SNAPSHOT_VERSION;
+    header.endian       = glh_SNAPSHOT_ENDIAN;
+    header.hash_bytes   = sizeof(unsigned long int);
+    header.slot_bytes   = sizeof(struct glh_map_slot);
+    header.size         = size;
+    header.n_elems      = table->n_elems;
+    header.slots_offset = glh_SNAPSHOT_PAGE;
+
+    /* first pass places every element and decides where it's bytes go */
+    offset = header.slots_offset + (uint64_t) size * sizeof(struct glh_map_slot);
+
+    /* each entry's stored hash is saved, hash_func is never called */
+    walk = 0;
+    while( (cur = glh_snapshot_next(table, &walk)) ){
+        key_len = glh_snapshot_key_len(table, cur->key);
+        data_len = glh_snapshot_data_len(data_len_func, cur->data);
+
+        if( key_len > (uint32_t) -1 || data_len > (uint32_t) -1 ){
+            puts("glh_save: key or data too long");
+            goto glh_SAVE_DONE;
+        }
+
+        pos = glh_pos_pow2(cur->hash, size);
+        while( slots[pos].key ){
+            pos = (pos + 1) & (size - 1);
+        }
+
+        slots[pos].hash = cur->hash;
+        slots[pos].key = offset;
+        slots[pos].key_len = key_len;
+        offset += key_len + 1;
+
+        slots[pos].data_len = data_len;
+        if( data_len ){
+            offset = glh_snapshot_align(offset, glh_SNAPSHOT_DATA_ALIGN);
+            slots[pos].data = offset;
+            offset += data_len;
+        } else {
+            slots[pos].data = (uintptr_t) cur->data;
+        }
+    }
+
+    header.file_len = offset;
+
+    writer->fd = fd;
+    writer->failed = 0;
+    writer->len = 0;
+    writer->offset = 0;
+
+    glh_snapshot_write(writer, &header, sizeof(struct glh_snapshot_header));
+    glh_snapshot_write(writer, 0, header.slots_offset - sizeof(struct glh_snapshot_header));
+    glh_snapshot_write(writer, slots, size * sizeof(struct glh_map_slot));
+
+    /* second pass writes the bytes, in the same order as they were placed */
+    walk = 0;
+    while( (cur = glh_snapshot_next(table, &walk)) ){
+        glh_snapshot_write(writer, cur->key, glh_snapshot_key_len(table, cur->key));
+        glh_snapshot_write(writer, "", 1);
+
+        data_len = glh_snapshot_data_len(data_len_func, cur->data);
+        if( data_len ){
+            glh_snapshot_write(writer, 0, glh_snapshot_align(writer->offset, glh_SNAPSHOT_DATA_ALIGN) - writer->offset);
+            glh_snapshot_write(writer, cur->data, data_len);
+        }
+    }
+
+    if( ! glh_snapshot_flush(writer) ){
+        puts("glh_save: call to glh_snapshot_flush failed");
+        goto glh_SAVE_DONE;
+    }
+
+    if( writer->offset != header.file_len ){
+        puts("glh_save: key or data length changed while saving");
+        goto glh_SAVE_DONE;
+    }
+
+    ret = 1;
+
+glh_SAVE_DONE:
+    free(writer);
+    glh_free_array(&(table->allocator), slots, size, sizeof(struct glh_map_slot));
+    return ret;
+}
+
+unsigned int glh_save(const struct glh_table *table, int fd){
+    return glh_save_with_data(table, fd, 0);
+}
+
+/* glh_allocator functions for a mapped table, ctx is the mapping itself
+ * which glh_destroy hands back to dealloc along with it's length
+ */
+void * glh_snapshot_alloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return malloc(size);
+}
+
+void * glh_snapshot_zalloc(void *ctx, size_t size, size_t align){
+    (void) ctx;
+    (void) align;
+    return calloc(1, size);
+}
+
+void glh_snapshot_dealloc(void *ctx, void *ptr, size_t size){
+    if( ptr == ctx ){
+        munmap(ptr, size);
+        return;
+    }
+
+    free(ptr);
+}
+
+/* check that the len bytes at map are a snapshot we can serve
+ *
+ * every occupied slot is checked, so that no lookup, compare
+ * or returned data can reach past the end of the mapping
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_snapshot_check(const unsigned char *map, size_t len){
+    struct glh_snapshot_header header;
+    const struct glh_map_slot *slots = 0;
+    /* first byte after the slots, where keys and data start */
+    uint64_t start = 0;
+    /* number of occupied slots */
+    uint64_t n = 0;
+    size_t i = 0;
+
+    if( len < sizeof(struct glh_snapshot_header) ){
+        puts("glh_map: file too short to be a snapshot");
+        return 0;
+    }
+
+    memcpy(&header, map, sizeof(struct glh_snapshot_header));
+
+    if( memcmp(header.magic, glh_SNAPSHOT_MAGIC, sizeof(glh_SNAPSHOT_MAGIC)) ){
+        puts("glh_map: file is not a snapshot");
+        return 0;
+    }
+
+    if( header.version != glh_SNAPSHOT_VERSION ){
+        puts("glh_map: unsupported snapshot version");
+        return 0;
+    }
+
+    if( header.endian != glh_SNAPSHOT_ENDIAN
+            || header.hash_bytes != sizeof(unsigned long int)
+            || header.slot_bytes != sizeof(struct glh_map_slot) ){
+        puts("glh_map: snapshot was written by a different kind of machine");
+        return 0;
+    }
+
+    if( header.file_len != len
+            || ! header.size
+            || (header.size & (header.size - 1))
+            || header.n_elems >= header.size
+            || header.slots_offset != glh_SNAPSHOT_PAGE
+            || header.size > (len - header.slots_offset) / sizeof(struct glh_map_slot) ){
+        puts("glh_map: snapshot is truncated or corrupt");
+        return 0;
+    }
+
+    slots = (const struct glh_map_slot *) (map + header.slots_offset);
+    start = header.slots_offset + header.size * sizeof(struct glh_map_slot);
+
+    for( i=0; i < header.size; ++i ){
+        if( ! slots[i].key ){
+            continue;
+        }
+
+        ++n;
+
+        /* keys must also end in their 0 byte, so a compare stops in time */
+        if( slots[i].key < start
+                || slots[i].key >= len
+                || slots[i].key_len >= len - slots[i].key
+                || map[slots[i].key + slots[i].key_len] ){
+            puts("glh_map: snapshot is truncated or corrupt");
+            return 0;
+        }
+
+        if( slots[i].data_len
+                && ( slots[i].data < start
+                     || slots[i].data > len
+                     || slots[i].data_len > len - slots[i].data ) ){
+            puts("glh_map: snapshot is truncated or corrupt");
+            return 0;
+        }
+    }
+
+    if( n != header.n_elems ){
+        puts("glh_map: snapshot is truncated or corrupt");
+        return 0;
+    }
+
+    return 1;
+}
+
+struct glh_table * glh_map(
+        const char *path,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    ){
+
+    struct glh_table *table = 0;
+    struct glh_snapshot_header header;
+    struct glh_allocator allocator;
+    struct stat st;
+    void *map = MAP_FAILED;
+    size_t len = 0;
+    int fd = -1;
+    size_t i = 0;
+
+    if( ! path ){
+        puts("glh_map: path undef");
+        return 0;
+    }
+
+    if( ! hash_func ){
+        puts("glh_map: hash_func undef");
+        return 0;
+    }
+
+    fd = open(path, O_RDONLY);
+    if( fd < 0 ){
+        puts("glh_map: call to open failed");
+        return 0;
+    }
+
+    if( fstat(fd, &st) || st.st_size <= 0 || (uint64_t) st.st_size > (size_t) -1 ){
+        puts("glh_map: call to fstat failed or file empty");
+        close(fd);
+        return 0;
+    }
+
+    len = st.st_size;
+
+    map = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+    /* the mapping keeps the file alive */
+    close(fd);
+    if( map == MAP_FAILED ){
+        puts("glh_map: call to mmap failed");
+        return 0;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    /* checking walks the whole snapshot once, front to back */
+    madvise(map, len, MADV_SEQUENTIAL);
+#endif
+
+    if( ! glh_snapshot_check(map, len) ){
+        munmap(map, len);
+        return 0;
+    }
+
+    memcpy(&header, map, sizeof(struct glh_snapshot_header));
+
+#ifdef MADV_RANDOM
+    /* lookups land all over the slots, don't read ahead */
+    madvise(map, len, MADV_RANDOM);
+#endif
+
+    allocator.alloc   = glh_snapshot_alloc;
+    allocator.zalloc  = glh_snapshot_zalloc;
+    allocator.dealloc = glh_snapshot_dealloc;
+    allocator.ctx     = map;
+
+    table = glh_alloc_array(&allocator, 1, sizeof(struct glh_table), 1);
+    if( ! table ){
+        puts("glh_map: call to glh_alloc_array failed");
+        munmap(map, len);
+        return 0;
+    }
+
+    /* a single slot, which we then swap out for the mapping */
+    if( ! glh_init_with_allocator(table, 1, hash_func, equal_func, &allocator) ){
+        puts("glh_map: call to glh_init_with_allocator failed");
+        free(table);
+        munmap(map, len);
+        return 0;
+    }
+
+    glh_free_array(&(table->allocator), table->entries, 1, sizeof(struct glh_entry));
+    table->entries = 0;
+
+    table->flags     = glh_FLAG_MAPPED | glh_FLAG_POW2;
+    table->size      = header.size;
+    table->n_elems   = header.n_elems;
+    table->map       = map;
+    table->map_len   = len;
+    table->map_slots = (const struct glh_map_slot *) (table->map + header.slots_offset);
+
+    /* catch the wrong hash_func now rather than as every lookup missing,
+     * glh_snapshot_check has already made sure the key is in bounds
+     */
+    for( i=0; i < table->size; ++i ){
+        if( table->map_slots[i].key ){
+            if( hash_func(table->map + table->map_slots[i].key) != table->map_slots[i].hash ){
+                puts("glh_map: hash_func does not match the one the snapshot was saved with");
+                glh_destroy(table, 1, 0);
+                return 0;
+            }
+
+            break;
+        }
+    }
+
+    return table;
+}
@@ -0,0 +1,105 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef generic_linear_hash_snapshot_H
+#define generic_linear_hash_snapshot_H
+
+#include "generic_linear_hash.h"
+
+/* current version of the snapshot format written by glh_save
+ * glh_map refuses any other version
+ */
+#define glh_SNAPSHOT_VERSION 1
+
+/* write every element of table to fd as a snapshot
+ * which glh_map can later serve lookups from in place
+ *
+ * the snapshot is a page aligned header followed by an open
+ * addressed array of struct glh_map_slot (each holding the hash and
+ * offsets of the key and data) and finally the key bytes themselves,
+ * it is written for the machine writing it, glh_map on a machine
+ * with a different byte order or unsigned long width will refuse it
+ *
+ * each element's stored hash is saved as is, hash_func is not called,
+ * this is always hash_func(key) (see glh_insert_hashed) and glh_map
+ * checks the first saved hash against it's own hash_func
+ *
+ * keys are measured with table->key_len_func if set (see glh_tune_inline
+ * and glh_tune_own_keys), otherwise they are taken to be strings
+ *
+ * data is saved as the pointer's own value, so this is only useful
+ * for data which is not a pointer (e.g. an integer cast to void *),
+ * see glh_save_with_data to also save what data points at
+ *
+ * fd is written sequentially from it's current position,
+ * which should be the start of the file for glh_map to accept it
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_save(const struct glh_table *table, int fd);
+
+/* as glh_save but the data_len_func(data) bytes each data points
+ * at are also saved, glh_get on the mapped table will then
+ * return a pointer to this copy within the mapping
+ *
+ * data for which data_len_func returns 0 is saved
+ * as the pointer's own value as with glh_save
+ *
+ * returns 1 on success
+ * returns 0 on failure
+ */
+unsigned int glh_save_with_data(const struct glh_table *table, int fd, size_t (*data_len_func)(const void *data));
+
+/* map the snapshot at path (written by glh_save) read only
+ * and return a table serving lookups directly from the mapping
+ *
+ * nothing is copied or rehashed, the snapshot is read through once
+ * to check every slot's offsets and lengths so that a truncated or
+ * corrupt file is refused rather than read out of bounds, after that
+ * pages are only faulted back in as lookups touch them
+ *
+ * hash_func must be the hash function of the table which was saved,
+ * equal_func is called with the mapped copy of a key as it's first
+ * argument and may be 0 to trust the hash alone as with glh_new
+ *
+ * the returned table has glh_FLAG_MAPPED set and only supports
+ * glh_exists, glh_get, glh_try_get (and their _hashed and _batch forms),
+ * glh_iter, glh_nelems and glh_stats, anything which would modify it fails
+ *
+ * keys and saved data returned by lookups point into the mapping
+ * and are only valid until glh_destroy which unmaps it,
+ * glh_destroy must be called with a free_table of 1
+ *
+ * returns pointer on success
+ * returns 0 on failure
+ */
+struct glh_table * glh_map(
+        const char *path,
+        unsigned long int (*hash_func)(const void *key),
+        unsigned int (*equal_func)(const void *a, const void *b)
+    );
+
+#endif // ifndef generic_linear_hash_snapshot_H
@@ -0,0 +1,496 @@
+/* The MIT License (MIT)
+ *
+ * Author: Chris Hall <followingthepath at gmail dot c0m>
+ *
+ * Copyright (c) 2015 Chris Hall (cjh)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* header only, type specialised linear hash tables
+ *
+ * GLH_DECLARE(name, key_type, value_type, hash_fn, eq_fn);
+ *
+ * generates `struct name` along with static inline functions
+ * name_new, name_init, name_destroy, name_nelems, name_load,
+ * name_tune_threshold, name_resize, name_exists, name_insert,
+ * name_set, name_get and name_delete
+ *
+ * keys and values are stored by value inside the table
+ * and hash_fn and eq_fn are called directly so they can be inlined,
+ * either may be a function or a function-like macro:
+ *
+ *  unsigned long int hash_fn(key_type key);
+ *
+ *  eq_fn(a, b) is expected to:
+ *  return 0 for equal
+ *  return non-zero for non-equal
+ *
+ * these tables behave as a glh_table with glh_FLAG_POW2 and
+ * glh_FLAG_BACKSHIFT set: size is always a power of two,
+ * deletes never leave dummies behind and inserts resize
+ * by glh_SCALING_FACTOR once the load reaches the threshold
+ *
+ * as values may be any type, the functions which return data in
+ * generic_linear_hash.h instead return 1 on success / 0 on failure
+ * and hand the value back through a pointer
+ *
+ * example:
+ *
+ *  static unsigned long int int_hash(int key){ return key; }
+ *  #define int_eq(a, b) ((a) != (b))
+ *
+ *  GLH_DECLARE(int_table, int, double, int_hash, int_eq);
+ *
+ *  struct int_table *t = int_table_new();
+ *  double d = 0;
+ *  int_table_insert(t, 4, 2.5);
+ *  int_table_get(t, 4, &d);
+ *  int_table_destroy(t, 1);
+ */
+
+#ifndef generic_linear_hash_template_H
+#define generic_linear_hash_template_H
+
+#include <stdio.h> /* puts */
+#include <stdlib.h> /* calloc, free */
+#include <stddef.h> /* size_t */
+#include <limits.h> /* ULONG_MAX */
+
+#include "generic_linear_hash.h"
+
+/* default number of slots */
+#define GLH_TEMPLATE_DEFAULT_SIZE 32
+
+/* factor we grow the number of slots by each resize */
+#define GLH_TEMPLATE_SCALING_FACTOR 2
+
+/* default loading factor we resize after in base 10 */
+#define GLH_TEMPLATE_DEFAULT_THRESHOLD 6
+
+/* multiplier and fold used to mix hashes, see glh_pos_pow2 */
+#if ULONG_MAX > 0xffffffffUL
+#define GLH_TEMPLATE_FIBONACCI 11400714819323198485UL
+#define GLH_TEMPLATE_FIBONACCI_FOLD 32
+#else
+#define GLH_TEMPLATE_FIBONACCI 2654435769UL
+#define GLH_TEMPLATE_FIBONACCI_FOLD 16
+#endif
+
+#define GLH_DECLARE(name, key_type, value_type, hash_fn, eq_fn) \
+\
+struct name##_entry { \
+    enum glh_entry_state state; \
+    /* hash value for this entry, output of hash_fn(key) */ \
+    unsigned long int hash; \
+    key_type key; \
+    value_type value; \
+}; \
+\
+struct name { \
+    /* number of slots, always a power of two */ \
+    size_t size; \
+    /* number of elements stored */ \
+    size_t n_elems; \
+    /* threshold that triggers an automatic resize */ \
+    unsigned int threshold; \
+    /* array of entries */ \
+    struct name##_entry *entries; \
+}; \
+\
+/* select the slot for hash in a table of table_size slots */ \
+static inline size_t name##_pos(unsigned long int hash, size_t table_size){ \
+    hash *= GLH_TEMPLATE_FIBONACCI; \
+    hash ^= hash >> GLH_TEMPLATE_FIBONACCI_FOLD; \
+    return hash & (table_size - 1); \
+} \
+\
+/* probe for key \
+ * \
+ * returns 1 if key was found, *pos is set to it's slot \
+ * returns 0 if key was not found, *pos is set to the first empty slot \
+ *  or to table->size if there was no empty slot \
+ */ \
+static inline unsigned int name##_probe(const struct name *table, unsigned long int hash, key_type key, size_t *pos){ \
+    size_t i = 0; \
+    size_t n = 0; \
+    const struct name##_entry *cur = 0; \
+\
+    i = name##_pos(hash, table->size); \
+\
+    for( n=0; n < table->size; ++n ){ \
+        cur = &(table->entries[i]); \
+\
+        if( cur->state == glh_ENTRY_EMPTY ){ \
+            *pos = i; \
+            return 0; \
+        } \
+\
+        if( cur->hash == hash && ! (eq_fn(cur->key, key)) ){ \
+            *pos = i; \
+            return 1; \
+        } \
+\
+        i = (i + 1) & (table->size - 1); \
+    } \
+\
+    *pos = table->size; \
+    return 0; \
+} \
+\
+/* initialise an already allocated table to size size \
+ * size will be rounded up to a power of two \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_init(struct name *table, size_t size){ \
+    size_t p = 1; \
+\
+    if( ! table ){ \
+        puts(#name "_init: table undef"); \
+        return 0; \
+    } \
+\
+    if( size == 0 ){ \
+        puts(#name "_init: specified size of 0, impossible"); \
+        return 0; \
+    } \
+\
+    while( p < size ){ \
+        p <<= 1; \
+    } \
+\
+    table->size      = p; \
+    table->n_elems   = 0; \
+    table->threshold = GLH_TEMPLATE_DEFAULT_THRESHOLD; \
+\
+    table->entries = calloc(p, sizeof(struct name##_entry)); \
+    if( ! table->entries ){ \
+        puts(#name "_init: calloc failed"); \
+        return 0; \
+    } \
+\
+    return 1; \
+} \
+\
+/* allocate and initialise a new table of GLH_TEMPLATE_DEFAULT_SIZE slots \
+ * \
+ * returns pointer on success \
+ * returns 0 on failure \
+ */ \
+static inline struct name * name##_new(void){ \
+    struct name *table = 0; \
+\
+    table = calloc(1, sizeof(struct name)); \
+    if( ! table ){ \
+        puts(#name "_new: calloc failed"); \
+        return 0; \
+    } \
+\
+    if( ! name##_init(table, GLH_TEMPLATE_DEFAULT_SIZE) ){ \
+        puts(#name "_new: call to " #name "_init failed"); \
+        free(table); \
+        return 0; \
+    } \
+\
+    return table; \
+} \
+\
+/* free an existing table \
+ * this will only free the *table pointer if `free_table` is set to 1 \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_destroy(struct name *table, unsigned int free_table){ \
+    if( ! table ){ \
+        puts(#name "_destroy: table undef"); \
+        return 0; \
+    } \
+\
+    free(table->entries); \
+    table->entries = 0; \
+\
+    if( free_table ){ \
+        free(table); \
+    } \
+\
+    return 1; \
+} \
+\
+/* returns number of elements on success \
+ * returns 0 on failure \
+ */ \
+static inline size_t name##_nelems(const struct name *table){ \
+    if( ! table ){ \
+        puts(#name "_nelems: table undef"); \
+        return 0; \
+    } \
+\
+    return table->n_elems; \
+} \
+\
+/* returns loading factor 0 -> 10 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_load(const struct name *table){ \
+    if( ! table ){ \
+        puts(#name "_load: table undef"); \
+        return 0; \
+    } \
+\
+    return (table->n_elems * 10) / table->size; \
+} \
+\
+/* set the load that we resize at, 1 (10%) to 10 (100%) \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_tune_threshold(struct name *table, unsigned int threshold){ \
+    if( ! table ){ \
+        puts(#name "_tune_threshold: table undef"); \
+        return 0; \
+    } \
+\
+    if( threshold < 1 || threshold > 10 ){ \
+        puts(#name "_tune_threshold: threshold must be between 1 and 10 (inclusive)"); \
+        return 0; \
+    } \
+\
+    table->threshold = threshold; \
+    return 1; \
+} \
+\
+/* resize an existing table to new_size rounded up to a power of two \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_resize(struct name *table, size_t new_size){ \
+    struct name##_entry *new_entries = 0; \
+    size_t p = 1; \
+    size_t i = 0; \
+    size_t j = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_resize: table undef"); \
+        return 0; \
+    } \
+\
+    while( p < new_size ){ \
+        p <<= 1; \
+    } \
+\
+    if( p <= table->n_elems ){ \
+        puts(#name "_resize: asked for new_size smaller than number of existing elements, impossible"); \
+        return 0; \
+    } \
+\
+    new_entries = calloc(p, sizeof(struct name##_entry)); \
+    if( ! new_entries ){ \
+        puts(#name "_resize: calloc failed"); \
+        return 0; \
+    } \
+\
+    for( i=0; i < table->size; ++i ){ \
+        if( table->entries[i].state != glh_ENTRY_OCCUPIED ){ \
+            continue; \
+        } \
+\
+        j = name##_pos(table->entries[i].hash, p); \
+        while( new_entries[j].state == glh_ENTRY_OCCUPIED ){ \
+            j = (j + 1) & (p - 1); \
+        } \
+\
+        new_entries[j] = table->entries[i]; \
+    } \
+\
+    free(table->entries); \
+    table->entries = new_entries; \
+    table->size = p; \
+\
+    return 1; \
+} \
+\
+/* returns 1 if key exists \
+ * returns 0 if key doesn't exist or on failure \
+ */ \
+static inline unsigned int name##_exists(const struct name *table, key_type key){ \
+    size_t pos = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_exists: table undef"); \
+        return 0; \
+    } \
+\
+    return name##_probe(table, hash_fn(key), key, &pos); \
+} \
+\
+/* insert `value` under `key` \
+ * this will only succeed if key does not already exist \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_insert(struct name *table, key_type key, value_type value){ \
+    unsigned long int hash = 0; \
+    size_t pos = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_insert: table undef"); \
+        return 0; \
+    } \
+\
+    hash = hash_fn(key); \
+\
+    if( name##_probe(table, hash, key, &pos) ){ \
+        return 0; \
+    } \
+\
+    /* note we are checking the load before the insert */ \
+    if( (table->n_elems * 10) / table->size >= table->threshold ){ \
+        if( ! name##_resize(table, table->size * GLH_TEMPLATE_SCALING_FACTOR) ){ \
+            puts(#name "_insert: call to " #name "_resize failed"); \
+            return 0; \
+        } \
+\
+        name##_probe(table, hash, key, &pos); \
+    } \
+\
+    if( pos == table->size ){ \
+        puts(#name "_insert: unable to find insertion slot"); \
+        return 0; \
+    } \
+\
+    table->entries[pos].state = glh_ENTRY_OCCUPIED; \
+    table->entries[pos].hash  = hash; \
+    table->entries[pos].key   = key; \
+    table->entries[pos].value = value; \
+    ++table->n_elems; \
+\
+    return 1; \
+} \
+\
+/* set `value` under `key` \
+ * this will only succeed if key exists \
+ * \
+ * if old is non-null the previous value is stored in *old \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_set(struct name *table, key_type key, value_type value, value_type *old){ \
+    size_t pos = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_set: table undef"); \
+        return 0; \
+    } \
+\
+    if( ! name##_probe(table, hash_fn(key), key, &pos) ){ \
+        return 0; \
+    } \
+\
+    if( old ){ \
+        *old = table->entries[pos].value; \
+    } \
+    table->entries[pos].value = value; \
+\
+    return 1; \
+} \
+\
+/* get the value stored under `key` into *value \
+ * \
+ * returns 1 if key was found, *value is set \
+ * returns 0 if key was not found or on failure, *value is untouched \
+ */ \
+static inline unsigned int name##_get(const struct name *table, key_type key, value_type *value){ \
+    size_t pos = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_get: table undef"); \
+        return 0; \
+    } \
+\
+    if( ! value ){ \
+        puts(#name "_get: value undef"); \
+        return 0; \
+    } \
+\
+    if( ! name##_probe(table, hash_fn(key), key, &pos) ){ \
+        return 0; \
+    } \
+\
+    *value = table->entries[pos].value; \
+    return 1; \
+} \
+\
+/* delete the entry stored under `key` \
+ * later members of the cluster are shifted back so no dummy is left \
+ * \
+ * if value is non-null the deleted value is stored in *value \
+ * \
+ * returns 1 on success \
+ * returns 0 on failure \
+ */ \
+static inline unsigned int name##_delete(struct name *table, key_type key, value_type *value){ \
+    size_t hole = 0; \
+    size_t i = 0; \
+    size_t home = 0; \
+    size_t mask = 0; \
+\
+    if( ! table ){ \
+        puts(#name "_delete: table undef"); \
+        return 0; \
+    } \
+\
+    if( ! name##_probe(table, hash_fn(key), key, &hole) ){ \
+        return 0; \
+    } \
+\
+    if( value ){ \
+        *value = table->entries[hole].value; \
+    } \
+\
+    mask = table->size - 1; \
+\
+    /* see glh_backshift, stop at the end of the cluster or if we wrap around */ \
+    for( i = (hole + 1) & mask; i != hole && table->entries[i].state == glh_ENTRY_OCCUPIED; i = (i + 1) & mask ){ \
+        home = name##_pos(table->entries[i].hash, table->size); \
+\
+        /* hole is before i's home so i must stay */ \
+        if( ((i - home) & mask) < ((i - hole) & mask) ){ \
+            continue; \
+        } \
+\
+        table->entries[hole] = table->entries[i]; \
+        hole = i; \
+    } \
+\
+    table->entries[hole].state = glh_ENTRY_EMPTY; \
+    --table->n_elems; \
+\
+    return 1; \
+} \
+\
+struct name
+
+#endif // ifndef generic_linear_hash_template_H
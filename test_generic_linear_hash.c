@@ -5,8 +5,19 @@
 #include <stdio.h> /* puts */
 #include <stdlib.h> /* calloc */
 #include <string.h> /* strcmp */
+#include <stdint.h> /* uintptr_t */
+#include <pthread.h> /* pthread_create, pthread_join */
+#include <unistd.h> /* mkstemp, close, unlink, ftruncate, pwrite */
 
 #include "generic_linear_hash.h"
+#include "generic_linear_hash_template.h"
+#include "generic_linear_hash_mmap.h"
+#include "generic_linear_hash_locked.h"
+#include "generic_linear_hash_rcu.h"
+#include "generic_linear_hash_sharded.h"
+#include "generic_linear_hash_parallel.h"
+#include "generic_linear_hash_snapshot.h"
+#include "generic_linear_hash_frozen.h"
 
 /* headers for internal functions within generic_linear_hash.c
  * that are not exposed via the header
@@ -1228,6 +1239,3523 @@ void artificial(void){
     puts("success!");
 }
 
+/* check every control byte mirrors the state of it's entry */
+void check_ctrl(struct glh_table *table){
+    size_t i = 0;
+
+    assert(table->ctrl);
+
+    for( i=0; i < table->size; ++i ){
+        switch( table->entries[i].state ){
+            case glh_ENTRY_OCCUPIED:
+                assert( ! glh_CTRL_IS_FREE(table->ctrl[i]) );
+                break;
+            case glh_ENTRY_DUMMY:
+                assert( glh_CTRL_DUMMY == table->ctrl[i] );
+                break;
+            default:
+                assert( glh_CTRL_EMPTY == table->ctrl[i] );
+                break;
+        }
+    }
+}
+
+void ctrl(void){
+    struct glh_table *table = 0;
+
+    /* some keys */
+    char *keys[] = {"bacon", "chicken", "pork", "pig", "lettuce",
+                    "beetroot", "chocolate", "frying pan porcupine", "a4 paper"};
+    /* some data */
+    int datas[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    size_t n_keys = sizeof(keys) / sizeof(keys[0]);
+    size_t i = 0;
+
+    /* temporary data pointer used for testing get */
+    int *data = 0;
+
+    puts("\ntesting control byte layout");
+
+    assert( 0 == glh_tune_ctrl(0, 1) );
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == table->ctrl );
+
+    /* artificially shrink so that we collide and resize */
+    assert( glh_resize(table, 3) );
+
+    puts("enabling ctrl");
+    assert( glh_tune_ctrl(table, 1) );
+    assert( table->flags & glh_FLAG_CTRL );
+    check_ctrl(table);
+
+    puts("inserting");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+        assert( i+1 == glh_nelems(table) );
+        check_ctrl(table);
+        /* cannot double insert */
+        assert( 0 == glh_insert(table, keys[i], &datas[i]) );
+    }
+
+    puts("getting");
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    assert( 0 == glh_get(table, "not here") );
+    assert( 0 == glh_exists(table, "not here") );
+
+    puts("deleting every second key");
+    for( i=0; i < n_keys; i += 2 ){
+        data = glh_delete(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+        assert( 0 == glh_delete(table, keys[i]) );
+        check_ctrl(table);
+    }
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        if( i % 2 ){
+            assert(data);
+            assert( datas[i] == *data );
+        } else {
+            assert( 0 == data );
+        }
+    }
+
+    puts("reinserting into dummies");
+    for( i=0; i < n_keys; i += 2 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+        check_ctrl(table);
+    }
+    assert( n_keys == glh_nelems(table) );
+
+    puts("testing ctrl survives resize");
+    assert( glh_resize(table, 64) );
+    check_ctrl(table);
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    puts("testing full table");
+    assert( glh_resize(table, n_keys + 1) );
+    assert( glh_tune_threshold(table, 10) );
+    assert( glh_insert(table, "one more", &datas[0]) );
+    assert( 0 == glh_get(table, "not here") );
+    assert( 0 == glh_delete(table, "not here") );
+    assert( glh_delete(table, "one more") );
+    assert( 0 == glh_get(table, "not here") );
+
+    puts("disabling ctrl");
+    assert( glh_tune_ctrl(table, 0) );
+    assert( 0 == table->ctrl );
+    assert( ! (table->flags & glh_FLAG_CTRL) );
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+/* deliberately weak hash function only looking at the first character
+ * this gives us very long clusters to probe through
+ */
+unsigned long int weak_hash_func(const void *key_void){
+    const char *key = key_void;
+
+    if( ! key ){
+        puts("weak_hash_func: key was null");
+        return 0;
+    }
+
+    return key[0];
+}
+
+void ctrl_group(void){
+    struct glh_table *table = 0;
+
+    /* enough keys to span many groups of control bytes */
+    char keys[300][16];
+    int datas[300];
+    size_t n_keys = 300;
+    size_t i = 0;
+
+    /* temporary data pointer used for testing get */
+    int *data = 0;
+
+    puts("\ntesting control byte group probing");
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "%c%lu", (char) ('a' + (i % 4)), (unsigned long) i);
+        datas[i] = i;
+    }
+
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_ctrl(table, 1) );
+    assert( glh_tune_threshold(table, 9) );
+
+    puts("inserting keys into long clusters");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( n_keys == glh_nelems(table) );
+    check_ctrl(table);
+
+    puts("getting keys out of long clusters");
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    /* misses which share a cluster and misses which do not */
+    assert( 0 == glh_get(table, "a-miss") );
+    assert( 0 == glh_get(table, "d-miss") );
+    assert( 0 == glh_get(table, "z-miss") );
+
+    puts("deleting and reinserting within clusters");
+    for( i=0; i < n_keys; i += 3 ){
+        data = glh_delete(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    check_ctrl(table);
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        if( i % 3 ){
+            assert(data);
+            assert( datas[i] == *data );
+        } else {
+            assert( 0 == data );
+        }
+    }
+
+    for( i=0; i < n_keys; i += 3 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_ctrl(table);
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    puts("probing a cluster which wraps around the end");
+    assert( glh_resize(table, 400) );
+    /* wrap the 'a' cluster */
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_delete(table, keys[i]) );
+    }
+    assert( glh_resize(table, 'a' + 20) );
+    assert( glh_tune_threshold(table, 10) );
+    for( i=0; i < 60; ++i ){
+        sprintf(keys[i], "a%lu", (unsigned long) i);
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_ctrl(table);
+    for( i=0; i < 60; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    assert( 0 == glh_get(table, "a-miss") );
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+void pow2(void){
+    struct glh_table *table = 0;
+
+    char keys[100][16];
+    int datas[100];
+    size_t n_keys = 100;
+    size_t i = 0;
+
+    /* temporary data pointer used for testing get */
+    int *data = 0;
+
+    puts("\ntesting power of two sizing");
+
+    assert( 0 == glh_tune_pow2(0, 1) );
+
+    puts("testing glh_pos_pow2 stays in range");
+    for( i=0; i < 1000; ++i ){
+        assert( glh_pos_pow2(i, 1) == 0 );
+        assert( glh_pos_pow2(i, 16) < 16 );
+        assert( glh_pos_pow2(~i, 1024) < 1024 );
+    }
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "key %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+
+    /* make our size not a power of two before enabling */
+    assert( glh_resize(table, 9) );
+    assert( 9 == table->size );
+
+    assert( glh_tune_pow2(table, 1) );
+    assert( table->flags & glh_FLAG_POW2 );
+    assert( 16 == table->size );
+
+    puts("testing resize rounds up");
+    assert( glh_resize(table, 33) );
+    assert( 64 == table->size );
+    assert( glh_resize(table, 3) );
+    assert( 4 == table->size );
+
+    puts("inserting");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+        /* size must always remain a power of two */
+        assert( 0 == (table->size & (table->size - 1)) );
+    }
+    assert( n_keys == glh_nelems(table) );
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    assert( 0 == glh_get(table, "not here") );
+
+    puts("deleting");
+    for( i=0; i < n_keys; i += 2 ){
+        data = glh_delete(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    for( i=1; i < n_keys; i += 2 ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    puts("combining with control bytes");
+    assert( glh_tune_ctrl(table, 1) );
+    check_ctrl(table);
+    for( i=1; i < n_keys; i += 2 ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    for( i=0; i < n_keys; i += 2 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_ctrl(table);
+
+    puts("disabling");
+    assert( glh_tune_pow2(table, 0) );
+    assert( ! (table->flags & glh_FLAG_POW2) );
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+void find_or_insert(void){
+    struct glh_table *table = 0;
+
+    /* words to count, "the" 3 times, "cat" twice, "sat" once */
+    char *words[] = {"the", "cat", "sat", "the", "cat", "the"};
+    size_t n_words = sizeof(words) / sizeof(words[0]);
+    size_t i = 0;
+
+    /* slot returned from glh_find_or_insert */
+    void **slot = 0;
+    unsigned int created = 0;
+
+    /* data from glh_try_get */
+    void *data = 0;
+    int value = 7;
+
+    puts("\ntesting find_or_insert and try_get");
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+
+    puts("testing error handling");
+    assert( 0 == glh_find_or_insert(0, "the", &created) );
+    assert( 0 == glh_find_or_insert(table, 0, &created) );
+    assert( 0 == glh_find_or_insert(table, "the", 0) );
+    assert( 0 == glh_try_get(0, "the", &data) );
+    assert( 0 == glh_try_get(table, 0, &data) );
+    assert( 0 == glh_try_get(table, "the", 0) );
+
+    /* artificially shrink so that counting has to resize */
+    assert( glh_resize(table, 2) );
+
+    puts("counting words");
+    for( i=0; i < n_words; ++i ){
+        slot = glh_find_or_insert(table, words[i], &created);
+        assert(slot);
+        if( created ){
+            assert( 0 == *slot );
+        }
+        /* we store our count directly in the data pointer */
+        *slot = (char *) *slot + 1;
+    }
+
+    assert( 3 == glh_nelems(table) );
+    assert( 2 < table->size );
+
+    assert( glh_try_get(table, "the", &data) );
+    assert( (char *) 0 + 3 == data );
+    assert( glh_try_get(table, "cat", &data) );
+    assert( (char *) 0 + 2 == data );
+    assert( glh_try_get(table, "sat", &data) );
+    assert( (char *) 0 + 1 == data );
+
+    puts("testing find_or_insert of an existing key");
+    slot = glh_find_or_insert(table, "the", &created);
+    assert(slot);
+    assert( 0 == created );
+    assert( (char *) 0 + 3 == *slot );
+    assert( 3 == glh_nelems(table) );
+
+    puts("testing try_get can see a stored 0");
+    assert( glh_insert(table, "null", 0) );
+    data = &value;
+    assert( glh_try_get(table, "null", &data) );
+    assert( 0 == data );
+
+    /* misses leave data untouched */
+    data = &value;
+    assert( 0 == glh_try_get(table, "dog", &data) );
+    assert( &value == data );
+
+    puts("testing find_or_insert reuses dummies");
+    assert( glh_delete(table, "cat") );
+    slot = glh_find_or_insert(table, "cat", &created);
+    assert(slot);
+    assert( created );
+    assert( 0 == *slot );
+    assert( 4 == glh_nelems(table) );
+
+    puts("testing with control bytes");
+    assert( glh_tune_ctrl(table, 1) );
+    slot = glh_find_or_insert(table, "the", &created);
+    assert(slot);
+    assert( 0 == created );
+    slot = glh_find_or_insert(table, "mat", &created);
+    assert(slot);
+    assert( created );
+    check_ctrl(table);
+    assert( glh_try_get(table, "mat", &data) );
+    assert( 0 == data );
+
+    puts("testing find_or_insert into a full table fails");
+    assert( glh_resize(table, 8) );
+    assert( glh_tune_threshold(table, 10) );
+    /* mark every free slot occupied without telling n_elems */
+    for( i=0; i < table->size; ++i ){
+        if( table->entries[i].state != glh_ENTRY_OCCUPIED ){
+            table->entries[i].state = glh_ENTRY_OCCUPIED;
+            table->ctrl[i] = 0;
+        }
+    }
+    assert( 0 == glh_find_or_insert(table, "hat", &created) );
+    assert( 0 == glh_insert(table, "hat", &value) );
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+/* number of times counting_hash_func has been called */
+unsigned int hash_calls = 0;
+
+unsigned long int counting_hash_func(const void *key_void){
+    ++hash_calls;
+    return hash_func(key_void);
+}
+
+void hashed(void){
+    struct glh_table *table = 0;
+    struct glh_table *other = 0;
+
+    char *keys[] = {"bacon", "chicken", "pork", "pig", "lettuce", "beetroot"};
+    int datas[] = {1, 2, 3, 4, 5, 6};
+    unsigned long int hashes[6];
+    size_t n_keys = 6;
+    size_t i = 0;
+
+    int new_data = 14;
+    int *data = 0;
+    void *out = 0;
+    void **slot = 0;
+    unsigned int created = 0;
+
+    puts("\ntesting pre-hashed variants");
+
+    for( i=0; i < n_keys; ++i ){
+        hashes[i] = hash_func(keys[i]);
+    }
+
+    table = glh_new(counting_hash_func, equal_func);
+    assert(table);
+    other = glh_new(counting_hash_func, equal_func);
+    assert(other);
+
+    puts("testing error handling");
+    assert( 0 == glh_exists_hashed(0, hashes[0], keys[0]) );
+    assert( 0 == glh_exists_hashed(table, hashes[0], 0) );
+    assert( 0 == glh_insert_hashed(0, hashes[0], keys[0], 0) );
+    assert( 0 == glh_insert_hashed(table, hashes[0], 0, 0) );
+    assert( 0 == glh_find_or_insert_hashed(0, hashes[0], keys[0], &created) );
+    assert( 0 == glh_find_or_insert_hashed(table, hashes[0], 0, &created) );
+    assert( 0 == glh_find_or_insert_hashed(table, hashes[0], keys[0], 0) );
+    assert( 0 == glh_set_hashed(0, hashes[0], keys[0], 0) );
+    assert( 0 == glh_set_hashed(table, hashes[0], 0, 0) );
+    assert( 0 == glh_get_hashed(0, hashes[0], keys[0]) );
+    assert( 0 == glh_get_hashed(table, hashes[0], 0) );
+    assert( 0 == glh_try_get_hashed(0, hashes[0], keys[0], &out) );
+    assert( 0 == glh_try_get_hashed(table, hashes[0], 0, &out) );
+    assert( 0 == glh_try_get_hashed(table, hashes[0], keys[0], 0) );
+    assert( 0 == glh_delete_hashed(0, hashes[0], keys[0]) );
+    assert( 0 == glh_delete_hashed(table, hashes[0], 0) );
+
+    /* shrink so that we also resize along the way */
+    assert( glh_resize(table, 2) );
+
+    hash_calls = 0;
+
+    puts("inserting into both tables with one hash each");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert_hashed(table, hashes[i], keys[i], &datas[i]) );
+        assert( glh_insert_hashed(other, hashes[i], keys[i], &datas[i]) );
+        assert( 0 == glh_insert_hashed(table, hashes[i], keys[i], &datas[i]) );
+    }
+    assert( n_keys == glh_nelems(table) );
+
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_exists_hashed(table, hashes[i], keys[i]) );
+        data = glh_get_hashed(other, hashes[i], keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+        assert( glh_try_get_hashed(table, hashes[i], keys[i], &out) );
+        assert( &datas[i] == out );
+    }
+
+    data = glh_set_hashed(table, hashes[0], keys[0], &new_data);
+    assert( &datas[0] == data );
+    assert( &new_data == glh_get_hashed(table, hashes[0], keys[0]) );
+
+    slot = glh_find_or_insert_hashed(table, hashes[1], keys[1], &created);
+    assert(slot);
+    assert( 0 == created );
+    assert( &datas[1] == *slot );
+
+    data = glh_delete_hashed(table, hashes[2], keys[2]);
+    assert( &datas[2] == data );
+    assert( 0 == glh_exists_hashed(table, hashes[2], keys[2]) );
+    assert( 0 == glh_delete_hashed(table, hashes[2], keys[2]) );
+
+    /* none of the above should have called our hash function */
+    assert( 0 == hash_calls );
+
+    puts("testing hashed and unhashed agree");
+    assert( glh_exists(table, keys[3]) );
+    assert( 0 == glh_exists(table, keys[2]) );
+    assert( 0 < hash_calls );
+
+    assert( glh_destroy(table, 1, 0) );
+    assert( glh_destroy(other, 1, 0) );
+    puts("success!");
+}
+
+void tombstones(void){
+    struct glh_table *table = 0;
+
+    char key[16];
+    int data = 1;
+    size_t i = 0;
+    size_t j = 0;
+    /* number of empty slots seen */
+    size_t empties = 0;
+
+    puts("\ntesting dummies trigger a rebuild");
+
+    assert( 0 == glh_ndummies(0) );
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == glh_ndummies(table) );
+
+    assert( glh_insert(table, "keep", &data) );
+
+    puts("churning insert and delete");
+    for( i=0; i < 1000; ++i ){
+        sprintf(key, "churn %lu", (unsigned long) i);
+        assert( glh_insert(table, key, &data) );
+        assert( glh_delete(table, key) );
+
+        /* we only ever hold 1 or 2 elements so should never grow */
+        assert( 32 == table->size );
+
+        /* dummies are bounded by our threshold */
+        assert( ((glh_nelems(table) + glh_ndummies(table)) * 10) / table->size <= table->threshold );
+
+        /* so there must always be an empty to stop a miss */
+        empties = 0;
+        for( j=0; j < table->size; ++j ){
+            if( table->entries[j].state == glh_ENTRY_EMPTY ){
+                ++empties;
+            }
+        }
+        assert( empties );
+    }
+
+    assert( glh_get(table, "keep") );
+    assert( 0 == glh_get(table, "churn 1") );
+
+    puts("testing resize clears dummies");
+    assert( glh_ndummies(table) );
+    assert( glh_resize(table, 32) );
+    assert( 0 == glh_ndummies(table) );
+    assert( glh_get(table, "keep") );
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+/* check there are no dummies and every key can be found */
+void check_backshift(struct glh_table *table, char keys[][16], int *datas, size_t n_keys, size_t deleted_every){
+    size_t i = 0;
+    int *data = 0;
+
+    for( i=0; i < table->size; ++i ){
+        assert( table->entries[i].state != glh_ENTRY_DUMMY );
+    }
+    assert( 0 == glh_ndummies(table) );
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        if( deleted_every && 0 == i % deleted_every ){
+            assert( 0 == data );
+        } else {
+            assert(data);
+            assert( datas[i] == *data );
+        }
+    }
+}
+
+void backshift(void){
+    struct glh_table *table = 0;
+
+    char keys[200][16];
+    int datas[200];
+    size_t n_keys = 200;
+    size_t i = 0;
+    int *data = 0;
+
+    puts("\ntesting backshift deletion");
+
+    assert( 0 == glh_tune_backshift(0, 1) );
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "%c%lu", (char) ('a' + (i % 5)), (unsigned long) i);
+        datas[i] = i;
+    }
+
+    /* weak hash so that we get long interleaved clusters */
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+
+    puts("clearing existing dummies on enable");
+    assert( glh_insert(table, "x", &datas[0]) );
+    assert( glh_delete(table, "x") );
+    assert( 1 == glh_ndummies(table) );
+    assert( glh_tune_backshift(table, 1) );
+    assert( table->flags & glh_FLAG_BACKSHIFT );
+    assert( 0 == glh_ndummies(table) );
+
+    puts("inserting");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_backshift(table, keys, datas, n_keys, 0);
+
+    puts("deleting every third");
+    for( i=0; i < n_keys; i += 3 ){
+        data = glh_delete(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    check_backshift(table, keys, datas, n_keys, 3);
+
+    puts("reinserting");
+    for( i=0; i < n_keys; i += 3 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_backshift(table, keys, datas, n_keys, 0);
+
+    puts("deleting within a cluster which wraps around the end");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_delete(table, keys[i]) );
+    }
+    assert( 0 == glh_nelems(table) );
+    for( i=0; i < table->size; ++i ){
+        assert( table->entries[i].state == glh_ENTRY_EMPTY );
+    }
+
+    /* 'e' is 101, place it near the end so the cluster wraps */
+    assert( glh_resize(table, 104) );
+    assert( glh_tune_threshold(table, 10) );
+    for( i=0; i < 12; ++i ){
+        sprintf(keys[i], "%c%lu", (char) (i % 2 ? 'e' : 'a'), (unsigned long) i);
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    for( i=0; i < 12; i += 4 ){
+        assert( glh_delete(table, keys[i]) );
+    }
+    check_backshift(table, keys, datas, 12, 4);
+
+    puts("combining with control bytes and power of two");
+    assert( glh_tune_ctrl(table, 1) );
+    assert( glh_tune_pow2(table, 1) );
+    for( i=1; i < 12; i += 4 ){
+        assert( glh_delete(table, keys[i]) );
+        check_ctrl(table);
+    }
+    for( i=0; i < 12; ++i ){
+        data = glh_get(table, keys[i]);
+        if( i % 4 < 2 ){
+            assert( 0 == data );
+        } else {
+            assert(data);
+        }
+    }
+
+    puts("disabling");
+    assert( glh_tune_backshift(table, 0) );
+    assert( glh_delete(table, keys[2]) );
+    assert( 1 == glh_ndummies(table) );
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+/* check robin hood invariants hold for every slot
+ * returns the longest probe distance seen
+ */
+size_t check_robinhood(struct glh_table *table){
+    size_t i = 0;
+    size_t next = 0;
+    size_t home = 0;
+    size_t dist = 0;
+    size_t longest = 0;
+    struct glh_entry *cur = 0;
+
+    for( i=0; i < table->size; ++i ){
+        cur = &(table->entries[i]);
+        assert( cur->state != glh_ENTRY_DUMMY );
+        if( cur->state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+
+        /* tracked distance must match actual distance */
+        home = (table->flags & glh_FLAG_POW2) ? glh_pos_pow2(cur->hash, table->size) : glh_pos(cur->hash, table->size);
+        dist = i >= home ? i - home : i + table->size - home;
+        assert( dist == cur->dist );
+        if( dist > longest ){
+            longest = dist;
+        }
+
+        /* the next entry can be at most one further from home */
+        next = (i + 1) % table->size;
+        if( table->entries[next].state == glh_ENTRY_OCCUPIED ){
+            assert( table->entries[next].dist <= cur->dist + 1 );
+        }
+    }
+
+    return longest;
+}
+
+void robinhood(void){
+    struct glh_table *table = 0;
+
+    char keys[500][16];
+    int datas[500];
+    size_t n_keys = 500;
+    size_t i = 0;
+    int *data = 0;
+    void **slot = 0;
+    unsigned int created = 0;
+
+    puts("\ntesting robin hood hashing");
+
+    assert( 0 == glh_tune_robinhood(0, 1) );
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "rh key %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+
+    /* insert some before enabling so the rebuild has work to do */
+    for( i=0; i < 10; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( glh_delete(table, keys[0]) );
+
+    assert( glh_tune_robinhood(table, 1) );
+    assert( table->flags & glh_FLAG_ROBINHOOD );
+    assert( table->flags & glh_FLAG_BACKSHIFT );
+    assert( 0 == glh_tune_backshift(table, 0) );
+    check_robinhood(table);
+
+    /* run nearly full */
+    assert( glh_tune_threshold(table, 9) );
+
+    puts("inserting");
+    for( i=0; i < n_keys; ++i ){
+        if( i > 0 && i < 10 ){
+            assert( 0 == glh_insert(table, keys[i], &datas[i]) );
+            continue;
+        }
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( n_keys == glh_nelems(table) );
+    check_robinhood(table);
+
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    assert( 0 == glh_get(table, "not here") );
+
+    puts("deleting");
+    for( i=0; i < n_keys; i += 2 ){
+        data = glh_delete(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+    check_robinhood(table);
+    for( i=0; i < n_keys; ++i ){
+        data = glh_get(table, keys[i]);
+        if( i % 2 ){
+            assert(data);
+            assert( datas[i] == *data );
+        } else {
+            assert( 0 == data );
+        }
+    }
+
+    puts("find_or_insert into a robin hood table");
+    for( i=0; i < n_keys; ++i ){
+        slot = glh_find_or_insert(table, keys[i], &created);
+        assert(slot);
+        assert( created == (i % 2 == 0) );
+        if( created ){
+            *slot = &datas[i];
+        }
+        assert( &datas[i] == *slot );
+    }
+    check_robinhood(table);
+
+    puts("weak hashes with control bytes and power of two");
+    assert( glh_destroy(table, 1, 0) );
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_ctrl(table, 1) );
+    assert( glh_tune_robinhood(table, 1) );
+    for( i=0; i < 100; ++i ){
+        sprintf(keys[i], "%c%lu", (char) ('a' + (i % 7)), (unsigned long) i);
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    check_robinhood(table);
+    check_ctrl(table);
+    assert( glh_tune_pow2(table, 1) );
+    check_robinhood(table);
+    for( i=0; i < 100; i += 3 ){
+        assert( glh_delete(table, keys[i]) );
+    }
+    check_robinhood(table);
+    check_ctrl(table);
+    for( i=0; i < 100; ++i ){
+        data = glh_get(table, keys[i]);
+        if( i % 3 ){
+            assert(data);
+            assert( datas[i] == *data );
+        } else {
+            assert( 0 == data );
+        }
+    }
+
+    puts("full table");
+    assert( glh_resize(table, 128) );
+    assert( glh_tune_threshold(table, 10) );
+    for( i=0; i < 100; i += 3 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    for( i=100; i < 128; ++i ){
+        sprintf(keys[i], "%c%lu", (char) ('a' + (i % 7)), (unsigned long) i);
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( 128 == table->size );
+    check_robinhood(table);
+    assert( 0 == glh_get(table, "z") );
+
+    puts("disabling");
+    /* a completely full table cannot be rebuilt */
+    assert( 0 == glh_tune_robinhood(table, 0) );
+    assert( table->flags & glh_FLAG_ROBINHOOD );
+    assert( glh_delete(table, keys[0]) );
+    assert( glh_tune_robinhood(table, 0) );
+    assert( ! (table->flags & glh_FLAG_ROBINHOOD) );
+    for( i=1; i < 128; ++i ){
+        data = glh_get(table, keys[i]);
+        assert(data);
+        assert( datas[i] == *data );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+void incremental(void){
+    struct glh_table *table = 0;
+
+    char keys[600][16];
+    int datas[600];
+    size_t n_keys = 600;
+    size_t i = 0;
+    size_t j = 0;
+    int *data = 0;
+    void **slot = 0;
+    unsigned int created = 0;
+    int new_data = 14;
+    /* number of grows seen */
+    unsigned int grows = 0;
+    /* previous migrate position */
+    size_t last_pos = 0;
+    /* combination of flags being tested */
+    unsigned int round = 0;
+    /* entries before a churning delete and insert */
+    struct glh_entry *prev_entries = 0;
+#ifdef glh_STATS
+    struct glh_stats stats;
+#endif
+
+    puts("\ntesting incremental growth");
+
+    assert( 0 == glh_tune_incremental(0, 1) );
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "inc %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    for( round=0; round < 3; ++round ){
+        table = glh_new(hash_func, equal_func);
+        assert(table);
+        assert( glh_tune_incremental(table, 1) );
+        assert( table->flags & glh_FLAG_INCREMENTAL );
+
+        if( round == 1 ){
+            assert( glh_tune_ctrl(table, 1) );
+            assert( glh_tune_pow2(table, 1) );
+        }
+        if( round == 2 ){
+            assert( glh_tune_robinhood(table, 1) );
+        }
+
+        grows = 0;
+
+        puts("inserting");
+        for( i=0; i < n_keys; ++i ){
+            last_pos = table->migrate_pos;
+            if( ! table->old_entries ){
+                last_pos = 0;
+            }
+
+            assert( glh_insert(table, keys[i], &datas[i]) );
+            assert( i + 1 == glh_nelems(table) );
+
+            if( table->old_entries && table->migrate_pos == 0 ){
+                /* a grow has just started, nothing should be migrated yet
+                 * beyond this insert's share
+                 */
+                ++grows;
+            }
+
+            /* each insert only does a bounded amount of migration */
+            if( table->old_entries && table->migrate_pos ){
+                assert( table->migrate_pos - last_pos <= 16 );
+            }
+
+            /* every key is reachable mid-migration */
+            if( i % 37 == 0 ){
+                for( j=0; j <= i; ++j ){
+                    data = glh_get(table, keys[j]);
+                    assert(data);
+                    assert( datas[j] == *data );
+                }
+                assert( 0 == glh_get(table, "not here") );
+            }
+        }
+        assert( grows );
+        assert( n_keys == glh_nelems(table) );
+
+        puts("operating on keys not yet migrated");
+        /* force a fresh grow so everything is in old_entries */
+        assert( glh_resize(table, 1024) );
+        assert( 0 == table->old_entries );
+        assert( glh_tune_threshold(table, 5) );
+        assert( glh_insert(table, "trigger", &new_data) );
+        assert( table->old_entries );
+
+        /* set on an unmigrated key */
+        data = glh_set(table, keys[n_keys - 1], &new_data);
+        assert( &datas[n_keys - 1] == data );
+        assert( &new_data == glh_get(table, keys[n_keys - 1]) );
+
+        /* delete of an unmigrated key */
+        data = glh_delete(table, keys[n_keys - 2]);
+        assert( &datas[n_keys - 2] == data );
+        assert( 0 == glh_get(table, keys[n_keys - 2]) );
+        assert( 0 == glh_delete(table, keys[n_keys - 2]) );
+
+        /* insert of an unmigrated key must still fail */
+        assert( 0 == glh_insert(table, keys[n_keys - 3], &datas[0]) );
+
+        /* find_or_insert of an unmigrated key moves it across */
+        slot = glh_find_or_insert(table, keys[n_keys - 4], &created);
+        assert(slot);
+        assert( 0 == created );
+        assert( &datas[n_keys - 4] == *slot );
+
+        assert( n_keys == glh_nelems(table) );
+
+        puts("destroying mid-migration");
+        assert( table->old_entries );
+        assert( glh_destroy(table, 1, 0) );
+    }
+
+    puts("finishing migration");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    for( i=0; i < 100; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    while( table->old_entries ){
+        assert( glh_insert(table, "drain", &new_data) );
+        assert( glh_delete(table, "drain") );
+    }
+    for( i=0; i < 100; ++i ){
+        assert( glh_get(table, keys[i]) );
+    }
+
+    /* disabling finishes migration */
+    assert( glh_resize(table, 200) );
+    assert( glh_tune_threshold(table, 5) );
+    for( i=100; glh_load(table) < 5; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( glh_insert(table, keys[i], &datas[i]) );
+    assert( table->old_entries );
+    assert( glh_tune_incremental(table, 0) );
+    assert( 0 == table->old_entries );
+    for( j=0; j <= i; ++j ){
+        data = glh_get(table, keys[j]);
+        assert(data);
+        assert( datas[j] == *data );
+    }
+
+    puts("destroying with free_data mid-migration");
+    assert( glh_destroy(table, 1, 0) );
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    for( i=0; i < 40; ++i ){
+        data = calloc(1, sizeof(int));
+        assert(data);
+        assert( glh_insert(table, keys[i], data) );
+    }
+    assert( table->old_entries );
+    assert( glh_destroy(table, 1, 1) );
+
+    puts("testing delete and insert churn clears dummies in steps");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    /* fewer dummies needed to trigger a rebuild */
+    assert( glh_tune_threshold(table, 4) );
+    for( i=0; i < n_keys / 2; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    grows = 0;
+    for( i=0; i < 20 * n_keys; ++i ){
+        prev_entries = table->entries;
+
+        assert( glh_delete(table, keys[i % n_keys]) );
+        assert( glh_insert(table, keys[(i + n_keys / 2) % n_keys], &datas[0]) );
+
+        /* glh_resize would have left nothing to migrate */
+        if( table->entries != prev_entries ){
+            assert( table->old_entries == prev_entries );
+            ++grows;
+        }
+    }
+    assert( grows > 2 );
+    /* the load never changed, only dummies were cleared */
+    assert( table->size <= 1024 );
+    assert( n_keys / 2 == glh_nelems(table) );
+    for( i=0; i < n_keys / 2; ++i ){
+        assert( glh_get(table, keys[(20 * n_keys + i) % n_keys]) );
+    }
+#ifdef glh_STATS
+    assert( glh_stats(table, &stats) );
+    assert( 0 == stats.n_resizes );
+#endif
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("success!");
+}
+
+void batch(void){
+    struct glh_table *table = 0;
+
+    char keys[100][16];
+    const char *lookups[150];
+    int datas[100];
+    void *out[150];
+    unsigned int exists[150];
+    size_t n_keys = 100;
+    size_t i = 0;
+
+    puts("\ntesting batch lookups");
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "batch %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    /* interleave hits and misses */
+    for( i=0; i < 150; ++i ){
+        lookups[i] = i % 3 == 2 ? "not here" : keys[i % n_keys];
+    }
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+
+    puts("testing error handling");
+    assert( 0 == glh_get_batch(0, lookups, 150, out) );
+    assert( 0 == glh_get_batch(table, 0, 150, out) );
+    assert( 0 == glh_get_batch(table, lookups, 150, 0) );
+    assert( 0 == glh_exists_batch(0, lookups, 150, exists) );
+    assert( 0 == glh_exists_batch(table, 0, 150, exists) );
+    assert( 0 == glh_exists_batch(table, lookups, 150, 0) );
+
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+
+    puts("testing batches of various sizes");
+    assert( 0 == glh_get_batch(table, lookups, 0, out) );
+    assert( 1 == glh_get_batch(table, lookups, 1, out) );
+    assert( &datas[0] == out[0] );
+    assert( 100 == glh_get_batch(table, lookups, 150, out) );
+    assert( 100 == glh_exists_batch(table, lookups, 150, exists) );
+
+    for( i=0; i < 150; ++i ){
+        if( i % 3 == 2 ){
+            assert( 0 == out[i] );
+            assert( 0 == exists[i] );
+        } else {
+            assert( &datas[i % n_keys] == out[i] );
+            assert( 1 == exists[i] );
+        }
+    }
+
+    puts("testing with control bytes");
+    assert( glh_tune_ctrl(table, 1) );
+    assert( 100 == glh_get_batch(table, lookups, 150, out) );
+    for( i=0; i < 150; ++i ){
+        assert( (i % 3 == 2 ? 0 : &datas[i % n_keys]) == out[i] );
+    }
+
+    lookups[0] = 0;
+    assert( 0 == glh_get_batch(table, lookups, 150, out) );
+    assert( 0 == glh_exists_batch(table, lookups, 150, exists) );
+
+    assert( glh_destroy(table, 1, 0) );
+    puts("success!");
+}
+
+void stats(void){
+    struct glh_table *table = 0;
+    struct glh_stats st;
+    char long_keys[20][16];
+    int data = 1;
+    size_t i = 0;
+
+    puts("\ntesting stats");
+
+    /* every key starting with 'a' shares a home slot */
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+
+    puts("testing error handling");
+    assert( 0 == glh_stats(0, &st) );
+    assert( 0 == glh_stats(table, 0) );
+    assert( 0 == glh_stats_reset(0) );
+
+    puts("testing empty table");
+    assert( glh_stats(table, &st) );
+    assert( 32 == st.size );
+    assert( 0 == st.n_elems );
+    assert( 0 == st.n_dummies );
+    assert( 0 == st.longest_cluster );
+
+    puts("testing clusters and dummies");
+    assert( glh_insert(table, "a1", &data) );
+    assert( glh_insert(table, "a2", &data) );
+    assert( glh_insert(table, "a3", &data) );
+    assert( glh_insert(table, "z1", &data) );
+    assert( glh_delete(table, "a2") );
+    assert( glh_stats(table, &st) );
+    assert( 3 == st.n_elems );
+    assert( 1 == st.n_dummies );
+    /* the dummy still holds the cluster together */
+    assert( 3 == st.longest_cluster );
+
+    assert( glh_stats_reset(table) );
+    assert( glh_get(table, "a1") );
+    assert( glh_get(table, "a3") );
+    assert( 0 == glh_get(table, "a9") );
+    assert( glh_resize(table, 64) );
+    assert( glh_stats(table, &st) );
+
+    if( st.counting ){
+        puts("testing counters");
+        assert( 1 == st.probe_hits[0] );
+        /* a3 is past a1 and the dummy */
+        assert( 1 == st.probe_hits[2] );
+        /* a9 walks the whole cluster before hitting an empty */
+        assert( 1 == st.probe_misses[3] );
+        assert( 3 == st.hash_calls );
+        /* a1, a1 and a3, a1 and a3 */
+        assert( 5 == st.equal_calls );
+        assert( 1 == st.n_resizes );
+        assert( st.resize_max_usec <= st.resize_usec );
+
+        puts("testing reset");
+        assert( glh_stats_reset(table) );
+        assert( glh_stats(table, &st) );
+        assert( 0 == st.probe_hits[0] );
+        assert( 0 == st.hash_calls );
+        assert( 0 == st.n_resizes );
+
+        puts("testing long probes share the final bucket");
+        assert( glh_tune_ctrl(table, 1) );
+        for( i=0; i < 20; ++i ){
+            /* these all start with 'a' too */
+            sprintf(long_keys[i], "along %lu", (unsigned long) i);
+            assert( glh_insert(table, long_keys[i], &data) );
+        }
+        assert( glh_stats_reset(table) );
+        assert( 0 == glh_get(table, "ax") );
+        assert( glh_stats(table, &st) );
+        assert( 1 == st.probe_misses[glh_STATS_BUCKETS - 1] );
+    } else {
+        puts("counters not compiled in, testing they stay 0");
+        for( i=0; i < glh_STATS_BUCKETS; ++i ){
+            assert( 0 == st.probe_hits[i] );
+            assert( 0 == st.probe_misses[i] );
+        }
+        assert( 0 == st.hash_calls );
+        assert( 0 == st.equal_calls );
+        assert( 0 == st.n_resizes );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing a full table is one cluster");
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_threshold(table, 10) );
+    assert( glh_resize(table, 4) );
+    assert( glh_insert(table, "a", &data) );
+    assert( glh_insert(table, "b", &data) );
+    assert( glh_insert(table, "c", &data) );
+    assert( glh_insert(table, "d", &data) );
+    assert( glh_stats(table, &st) );
+    assert( 4 == st.size );
+    assert( 4 == st.longest_cluster );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("success!");
+}
+
+/* typed tables used by template(), see generic_linear_hash_template.h */
+unsigned long int int_hash(int key){
+    return key;
+}
+
+#define int_eq(a, b) ((a) != (b))
+
+GLH_DECLARE(int_table, int, double, int_hash, int_eq);
+
+struct point {
+    int x;
+    int y;
+};
+
+/* every point collides, equality has to tell them apart */
+#define point_hash(p) ((unsigned long int) 7)
+#define point_eq(a, b) ((a).x != (b).x || (a).y != (b).y)
+
+GLH_DECLARE(point_table, struct point, int, point_hash, point_eq);
+
+void template(void){
+    struct int_table *table = 0;
+    struct int_table static_table;
+    struct point_table *points = 0;
+    struct point p;
+    double d = 0;
+    int v = 0;
+    int i = 0;
+
+    puts("\ntesting macro generated tables");
+
+    puts("testing error handling");
+    assert( 0 == int_table_init(0, 32) );
+    assert( 0 == int_table_init(&static_table, 0) );
+    assert( 0 == int_table_destroy(0, 0) );
+    assert( 0 == int_table_nelems(0) );
+    assert( 0 == int_table_load(0) );
+    assert( 0 == int_table_tune_threshold(0, 5) );
+    assert( 0 == int_table_resize(0, 5) );
+    assert( 0 == int_table_exists(0, 1) );
+    assert( 0 == int_table_insert(0, 1, 1.0) );
+    assert( 0 == int_table_set(0, 1, 1.0, 0) );
+    assert( 0 == int_table_get(0, 1, &d) );
+    assert( 0 == int_table_delete(0, 1, 0) );
+
+    table = int_table_new();
+    assert(table);
+    assert( 32 == table->size );
+    assert( 0 == int_table_get(table, 1, 0) );
+    assert( 0 == int_table_tune_threshold(table, 0) );
+    assert( 0 == int_table_tune_threshold(table, 11) );
+
+    puts("testing insert, get and automatic resize");
+    for( i=0; i < 1000; ++i ){
+        assert( int_table_insert(table, i, i * 0.5) );
+    }
+    assert( 0 == int_table_insert(table, 10, 1.0) );
+    assert( 1000 == int_table_nelems(table) );
+    assert( 2048 == table->size );
+    assert( int_table_load(table) < 6 );
+
+    for( i=0; i < 1000; ++i ){
+        assert( int_table_exists(table, i) );
+        assert( int_table_get(table, i, &d) );
+        assert( i * 0.5 == d );
+    }
+    assert( 0 == int_table_exists(table, 1000) );
+    d = 42;
+    assert( 0 == int_table_get(table, -1, &d) );
+    assert( 42 == d );
+
+    puts("testing set");
+    assert( int_table_set(table, 10, 99.0, &d) );
+    assert( 5.0 == d );
+    assert( int_table_set(table, 10, 100.0, 0) );
+    assert( int_table_get(table, 10, &d) );
+    assert( 100.0 == d );
+    assert( 0 == int_table_set(table, 5000, 1.0, 0) );
+
+    puts("testing delete");
+    for( i=0; i < 1000; i += 2 ){
+        assert( int_table_delete(table, i, &d) );
+    }
+    assert( 0 == int_table_delete(table, 0, 0) );
+    assert( 500 == int_table_nelems(table) );
+    for( i=0; i < 1000; ++i ){
+        assert( (i % 2) == (int) int_table_exists(table, i) );
+    }
+
+    puts("testing resize");
+    assert( 0 == int_table_resize(table, 100) );
+    assert( int_table_resize(table, 600) );
+    assert( 1024 == table->size );
+    for( i=1; i < 1000; i += 2 ){
+        assert( int_table_get(table, i, &d) );
+    }
+
+    assert( int_table_destroy(table, 1) );
+
+    puts("testing full table");
+    assert( int_table_init(&static_table, 4) );
+    assert( int_table_tune_threshold(&static_table, 10) );
+    for( i=0; i < 4; ++i ){
+        assert( int_table_insert(&static_table, i, i) );
+    }
+    assert( 4 == static_table.size );
+    assert( 0 == int_table_exists(&static_table, 4) );
+    assert( int_table_delete(&static_table, 2, 0) );
+    assert( int_table_get(&static_table, 3, &d) );
+    assert( int_table_destroy(&static_table, 0) );
+
+    puts("testing struct keys which all collide");
+    points = point_table_new();
+    assert(points);
+    for( i=0; i < 20; ++i ){
+        p.x = i;
+        p.y = -i;
+        assert( point_table_insert(points, p, i) );
+    }
+    for( i=0; i < 20; ++i ){
+        p.x = i;
+        p.y = -i;
+        assert( point_table_get(points, p, &v) );
+        assert( i == v );
+    }
+    p.x = 3;
+    p.y = 3;
+    assert( 0 == point_table_exists(points, p) );
+
+    /* deleting from the middle of the cluster must keep it intact */
+    p.x = 5;
+    p.y = -5;
+    assert( point_table_delete(points, p, &v) );
+    assert( 5 == v );
+    for( i=0; i < 20; ++i ){
+        p.x = i;
+        p.y = -i;
+        assert( (i != 5) == (int) point_table_exists(points, p) );
+    }
+    assert( point_table_destroy(points, 1) );
+
+    puts("success!");
+}
+
+size_t key_len_func(const void *key){
+    return strlen(key);
+}
+
+void inline_keys(void){
+    struct glh_table *table = 0;
+    char keys[100][32];
+    int datas[100];
+    size_t n_keys = 100;
+    size_t i = 0;
+
+    puts("\ntesting inline keys");
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+
+    puts("testing error handling");
+    assert( 0 == glh_tune_inline(0, key_len_func) );
+
+#if ! glh_INLINE_KEY_LEN
+    puts("glh_INLINE_KEY_LEN not set, testing we refuse");
+    assert( 0 == glh_tune_inline(table, key_len_func) );
+    assert( 0 == (table->flags & glh_FLAG_INLINE) );
+#else
+    /* every 4th key is too long to go inline */
+    for( i=0; i < n_keys; ++i ){
+        if( i % 4 == 3 ){
+            sprintf(keys[i], "a much longer inline key %lu", (unsigned long) i);
+        } else {
+            sprintf(keys[i], "inl %lu", (unsigned long) i);
+        }
+        datas[i] = i;
+    }
+
+    puts("testing enabling on a table with existing keys");
+    for( i=0; i < n_keys / 2; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( glh_tune_inline(table, key_len_func) );
+    assert( table->flags & glh_FLAG_INLINE );
+    for( i=n_keys / 2; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+
+    for( i=0; i < table->size; ++i ){
+        if( table->entries[i].state != glh_ENTRY_OCCUPIED ){
+            continue;
+        }
+        if( strlen(table->entries[i].key) > glh_INLINE_KEY_LEN ){
+            assert( 0 == table->entries[i].key_len );
+        } else {
+            assert( strlen(table->entries[i].key) == table->entries[i].key_len );
+            assert( 0 == memcmp(table->entries[i].inline_key, table->entries[i].key, table->entries[i].key_len) );
+        }
+    }
+
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, keys[i]) );
+    }
+    assert( 0 == glh_get(table, "inl 1000") );
+    /* a prefix of a stored key must not match */
+    assert( 0 == glh_get(table, "inl") );
+
+    puts("testing inline keys do not follow the key pointer");
+    /* scribble over a short key, it's inline copy still matches */
+    assert( glh_exists(table, "inl 0") );
+    strcpy(keys[0], "xxxxx");
+    assert( &datas[0] == glh_get(table, "inl 0") );
+    strcpy(keys[0], "inl 0");
+
+    puts("testing delete and resize keep inline keys");
+    for( i=0; i < n_keys; i += 2 ){
+        assert( &datas[i] == glh_delete(table, keys[i]) );
+    }
+    assert( glh_resize(table, table->size * 2) );
+    for( i=0; i < n_keys; ++i ){
+        assert( (i % 2 ? &datas[i] : 0) == glh_get(table, keys[i]) );
+    }
+
+    puts("testing with other modes");
+    assert( glh_tune_ctrl(table, 1) );
+    assert( glh_tune_robinhood(table, 1) );
+    for( i=0; i < n_keys; i += 2 ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, keys[i]) );
+    }
+
+    puts("testing disabling");
+    assert( glh_tune_inline(table, 0) );
+    assert( 0 == (table->flags & glh_FLAG_INLINE) );
+    assert( 0 == table->key_len_func );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, keys[i]) );
+    }
+#endif
+
+    assert( glh_destroy(table, 1, 0) );
+
+    /* silence unused warnings when inline keys are not compiled in */
+    (void) keys;
+    (void) datas;
+    (void) n_keys;
+    (void) i;
+
+    puts("success!");
+}
+
+/* allocator used by allocator() which accounts for memory per tenant
+ * and gives every allocation the alignment asked for
+ */
+struct tenant {
+    /* bytes currently allocated */
+    size_t bytes;
+    /* number of live allocations */
+    size_t live;
+    /* allocations fail if they would take bytes over this */
+    size_t budget;
+};
+
+void * tenant_alloc(void *ctx, size_t size, size_t align){
+    struct tenant *tenant = ctx;
+    unsigned char *raw = 0;
+    unsigned char *aligned = 0;
+
+    if( tenant->bytes + size > tenant->budget ){
+        return 0;
+    }
+
+    /* room to align and to remember where raw was */
+    raw = malloc(size + align + sizeof(void *));
+    if( ! raw ){
+        return 0;
+    }
+
+    aligned = raw + sizeof(void *);
+    aligned += (align - ((uintptr_t) aligned % align)) % align;
+    memcpy(aligned - sizeof(void *), &raw, sizeof(void *));
+
+    tenant->bytes += size;
+    ++tenant->live;
+
+    return aligned;
+}
+
+void * tenant_zalloc(void *ctx, size_t size, size_t align){
+    void *p = tenant_alloc(ctx, size, align);
+
+    if( p ){
+        memset(p, 0, size);
+    }
+
+    return p;
+}
+
+void tenant_dealloc(void *ctx, void *ptr, size_t size){
+    struct tenant *tenant = ctx;
+    unsigned char *raw = 0;
+
+    memcpy(&raw, (unsigned char *) ptr - sizeof(void *), sizeof(void *));
+    free(raw);
+
+    assert( tenant->bytes >= size );
+    tenant->bytes -= size;
+    --tenant->live;
+}
+
+void allocator(void){
+    struct glh_table *table = 0;
+    struct glh_table static_table;
+    struct tenant tenant = {0, 0, (size_t) -1};
+    struct glh_allocator alloc = {tenant_alloc, tenant_zalloc, tenant_dealloc, 0};
+    struct glh_allocator broken = {tenant_alloc, 0, tenant_dealloc, 0};
+    char keys[200][16];
+    int datas[200];
+    size_t n_keys = 200;
+    size_t i = 0;
+
+    puts("\ntesting allocators");
+
+    alloc.ctx = &tenant;
+    broken.ctx = &tenant;
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "alloc %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_new_with_allocator(0, equal_func, &alloc) );
+    assert( 0 == glh_new_with_allocator(hash_func, equal_func, &broken) );
+    assert( 0 == glh_init_with_allocator(0, 32, hash_func, equal_func, &alloc) );
+    assert( 0 == glh_init_with_allocator(&static_table, 32, hash_func, equal_func, &broken) );
+    assert( 0 == tenant.bytes );
+    assert( 0 == tenant.live );
+
+    puts("testing all memory comes from our allocator");
+    table = glh_new_with_allocator(hash_func, equal_func, &alloc);
+    assert(table);
+    assert( tenant.bytes >= sizeof(struct glh_table) + 32 * sizeof(struct glh_entry) );
+    assert( 0 == (uintptr_t) table % 64 );
+    assert( 0 == (uintptr_t) table->entries % 64 );
+
+    assert( glh_tune_ctrl(table, 1) );
+    assert( glh_tune_incremental(table, 1) );
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, keys[i], &datas[i]) );
+    }
+    assert( 0 == (uintptr_t) table->entries % 64 );
+    assert( 0 == (uintptr_t) table->ctrl % 64 );
+
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, keys[i]) );
+    }
+
+    assert( glh_tune_robinhood(table, 1) );
+    assert( glh_resize(table, 1000) );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_delete(table, keys[i]) );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+    assert( 0 == tenant.bytes );
+    assert( 0 == tenant.live );
+
+    puts("testing with glh_init");
+    assert( glh_init_with_allocator(&static_table, 16, hash_func, equal_func, &alloc) );
+    assert( tenant.bytes );
+    assert( glh_insert(&static_table, keys[0], &datas[0]) );
+    assert( glh_destroy(&static_table, 0, 0) );
+    assert( 0 == tenant.bytes );
+
+    puts("testing running out of budget");
+    tenant.budget = 4096;
+    table = glh_new_with_allocator(hash_func, equal_func, &alloc);
+    assert(table);
+    for( i=0; i < n_keys; ++i ){
+        if( ! glh_insert(table, keys[i], &datas[i]) ){
+            break;
+        }
+    }
+    /* we ran out before inserting everything, but nothing was lost */
+    assert( i < n_keys );
+    assert( i == glh_nelems(table) );
+    assert( tenant.bytes <= tenant.budget );
+    while( i-- ){
+        assert( &datas[i] == glh_get(table, keys[i]) );
+    }
+    assert( glh_destroy(table, 1, 0) );
+    assert( 0 == tenant.bytes );
+    assert( 0 == tenant.live );
+
+    puts("testing default allocator");
+    table = glh_new_with_allocator(hash_func, equal_func, 0);
+    assert(table);
+    assert( glh_insert(table, keys[0], &datas[0]) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("success!");
+}
+
+void mmap_allocator(void){
+    struct glh_table *table = 0;
+    const struct glh_allocator *alloc = 0;
+    enum glh_mmap_mode modes[] = {glh_MMAP_PAGES, glh_MMAP_THP, glh_MMAP_HUGETLB};
+    unsigned char *big = 0;
+    char keys[200][16];
+    int datas[200];
+    size_t n_keys = 200;
+    size_t i = 0;
+    size_t m = 0;
+
+    puts("\ntesting mmap allocator");
+
+    for( i=0; i < n_keys; ++i ){
+        sprintf(keys[i], "mmap %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_mmap_allocator((enum glh_mmap_mode) 42) );
+
+    for( m=0; m < sizeof(modes) / sizeof(modes[0]); ++m ){
+        printf("testing mode %lu\n", (unsigned long) m);
+        alloc = glh_mmap_allocator(modes[m]);
+        assert(alloc);
+
+        /* large allocations are zero filled without us clearing them */
+        big = alloc->zalloc(alloc->ctx, glh_MMAP_MIN_SIZE * 3, 64);
+        assert(big);
+        for( i=0; i < glh_MMAP_MIN_SIZE * 3; i += 4096 ){
+            assert( 0 == big[i] );
+        }
+        big[glh_MMAP_MIN_SIZE * 3 - 1] = 1;
+        alloc->dealloc(alloc->ctx, big, glh_MMAP_MIN_SIZE * 3);
+
+        table = glh_new_with_allocator(hash_func, equal_func, alloc);
+        assert(table);
+        assert( glh_tune_ctrl(table, 1) );
+
+        for( i=0; i < n_keys; ++i ){
+            assert( glh_insert(table, keys[i], &datas[i]) );
+        }
+
+        /* big enough to be given it's own huge page aligned mapping */
+        assert( glh_resize(table, 2 * glh_MMAP_MIN_SIZE / sizeof(struct glh_entry)) );
+        assert( 0 == (uintptr_t) table->entries % glh_HUGE_PAGE_SIZE );
+
+        for( i=0; i < n_keys; ++i ){
+            assert( &datas[i] == glh_get(table, keys[i]) );
+        }
+
+        /* and back down again into malloc */
+        assert( glh_resize(table, 1024) );
+        for( i=0; i < n_keys; ++i ){
+            assert( &datas[i] == glh_delete(table, keys[i]) );
+        }
+
+        assert( glh_destroy(table, 1, 0) );
+    }
+
+    puts("success!");
+}
+
+void own_keys(void){
+    struct glh_table *table = 0;
+    struct tenant tenant = {0, 0, (size_t) -1};
+    struct glh_allocator alloc = {tenant_alloc, tenant_zalloc, tenant_dealloc, 0};
+    /* reused for every key, only works if the table copies them */
+    char buf[32];
+    char early[10][16];
+    char *long_key = 0;
+    const void *stored = 0;
+    int datas[10000];
+    size_t n_keys = 10000;
+    size_t i = 0;
+
+    puts("\ntesting table owned keys");
+
+    alloc.ctx = &tenant;
+
+    for( i=0; i < n_keys; ++i ){
+        datas[i] = i;
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_tune_own_keys(0, key_len_func) );
+
+    table = glh_new_with_allocator(hash_func, equal_func, &alloc);
+    assert(table);
+
+    puts("testing enabling on a table with existing keys");
+    for( i=0; i < 10; ++i ){
+        sprintf(early[i], "early %lu", (unsigned long) i);
+        assert( glh_insert(table, early[i], &datas[i]) );
+    }
+    assert( glh_tune_own_keys(table, key_len_func) );
+    assert( table->flags & glh_FLAG_OWN_KEYS );
+    /* enabling twice is fine and copies nothing more */
+    assert( glh_tune_own_keys(table, key_len_func) );
+    for( i=0; i < 10; ++i ){
+        strcpy(early[i], "scribbled");
+    }
+    for( i=0; i < 10; ++i ){
+        sprintf(buf, "early %lu", (unsigned long) i);
+        assert( &datas[i] == glh_get(table, buf) );
+    }
+
+    puts("testing inserting through a reused buffer");
+    for( i=10; i < n_keys; ++i ){
+        sprintf(buf, "owned %lu", (unsigned long) i);
+        assert( glh_insert(table, buf, &datas[i]) );
+    }
+    /* this needed more than one chunk */
+    assert( tenant.live > 3 );
+
+    sprintf(buf, "owned %lu", (unsigned long) 500);
+    stored = glh_find_entry(table, buf)->key;
+    assert( stored != buf );
+    assert( 0 == strcmp(stored, buf) );
+    /* our copies are not moved by a resize */
+    assert( glh_resize(table, table->size * 2) );
+    assert( stored == glh_find_entry(table, buf)->key );
+
+    for( i=10; i < n_keys; ++i ){
+        sprintf(buf, "owned %lu", (unsigned long) i);
+        assert( &datas[i] == glh_get(table, buf) );
+        assert( 0 == ((size_t) glh_find_entry(table, buf)->key) % 8 );
+    }
+
+    puts("testing a key larger than a chunk");
+    long_key = calloc(100 * 1000, 1);
+    assert(long_key);
+    memset(long_key, 'k', 100 * 1000 - 1);
+    assert( glh_insert(table, long_key, &datas[0]) );
+    assert( glh_find_entry(table, long_key)->key != long_key );
+    assert( &datas[0] == glh_get(table, long_key) );
+    free(long_key);
+    /* the current chunk is still being filled */
+    assert( glh_insert(table, "after long key", &datas[1]) );
+    assert( &datas[1] == glh_get(table, "after long key") );
+
+    puts("testing deletes");
+    for( i=10; i < n_keys; i += 2 ){
+        sprintf(buf, "owned %lu", (unsigned long) i);
+        assert( &datas[i] == glh_delete(table, buf) );
+    }
+    for( i=10; i < n_keys; ++i ){
+        sprintf(buf, "owned %lu", (unsigned long) i);
+        assert( (i % 2 ? &datas[i] : 0) == glh_get(table, buf) );
+    }
+
+    puts("testing disabling");
+    assert( glh_tune_own_keys(table, 0) );
+    assert( 0 == (table->flags & glh_FLAG_OWN_KEYS) );
+    assert( 0 == table->key_len_func );
+    assert( glh_insert(table, "not owned", &datas[2]) );
+    assert( !strcmp("not owned", glh_find_entry(table, "not owned")->key) );
+    /* earlier copies are still ours */
+    sprintf(buf, "owned %lu", (unsigned long) 501);
+    assert( &datas[501] == glh_get(table, buf) );
+
+    puts("testing destroy frees every chunk");
+    assert( glh_destroy(table, 1, 0) );
+    assert( 0 == tenant.bytes );
+    assert( 0 == tenant.live );
+
+    puts("testing running out of memory while copying");
+    tenant.budget = 64 * 1024;
+    table = glh_new_with_allocator(hash_func, equal_func, &alloc);
+    assert(table);
+    assert( glh_tune_own_keys(table, key_len_func) );
+    assert( 0 == glh_insert(table, "no room", &datas[0]) );
+    assert( 0 == glh_nelems(table) );
+    assert( 0 == glh_ndummies(table) );
+    assert( 0 == glh_exists(table, "no room") );
+    assert( glh_destroy(table, 1, 0) );
+    assert( 0 == tenant.bytes );
+
+    puts("success!");
+}
+
+void capacity(void){
+    struct glh_table *table = 0;
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 5000;
+    size_t size = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    puts("\ntesting capacity reservation");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "cap %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_reserve(0, 10) );
+    assert( 0 == glh_new_with_capacity(10, 0, equal_func) );
+    assert( 0 == glh_new_with_capacity((size_t) -1, hash_func, equal_func) );
+
+    puts("testing glh_new_with_capacity");
+    /* small requests still get a default sized table */
+    table = glh_new_with_capacity(0, hash_func, equal_func);
+    assert(table);
+    assert( 32 == table->size );
+    assert( glh_destroy(table, 1, 0) );
+
+    table = glh_new_with_capacity(n_keys, hash_func, equal_func);
+    assert(table);
+    size = table->size;
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+        assert( size == table->size );
+    }
+    assert( n_keys == glh_nelems(table) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing glh_reserve over every threshold");
+    for( j=1; j <= 10; ++j ){
+        table = glh_new(hash_func, equal_func);
+        assert(table);
+        assert( glh_tune_threshold(table, j) );
+        assert( glh_insert(table, &keys[0], 0) );
+        assert( glh_reserve(table, n_keys) );
+        size = table->size;
+        for( i=1; i < n_keys; ++i ){
+            assert( glh_insert(table, &keys[i * 16], 0) );
+        }
+        assert( size == table->size );
+        assert( n_keys == glh_nelems(table) );
+
+        /* never shrinks */
+        assert( glh_reserve(table, 1) );
+        assert( size == table->size );
+        assert( glh_destroy(table, 1, 0) );
+    }
+
+    puts("testing glh_reserve with power of two sizing");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_pow2(table, 1) );
+    assert( glh_reserve(table, n_keys) );
+    size = table->size;
+    assert( 0 == (size & (size - 1)) );
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], 0) );
+    }
+    assert( size == table->size );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing glh_reserve finishes an incremental grow");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    for( j=0; ! table->old_entries; ++j ){
+        assert( glh_insert(table, &keys[j * 16], 0) );
+    }
+    assert( glh_reserve(table, n_keys) );
+    assert( 0 == table->old_entries );
+    for( i=0; i < j; ++i ){
+        assert( glh_exists(table, &keys[i * 16]) );
+    }
+    assert( glh_destroy(table, 1, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+void shrink(void){
+    struct glh_table *table = 0;
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 10000;
+    size_t peak = 0;
+    size_t size = 0;
+    /* number of times size changed while oscillating */
+    size_t n_changes = 0;
+    size_t i = 0;
+    size_t j = 0;
+    unsigned int flags = 0;
+#ifdef glh_STATS
+    struct glh_stats stats;
+#endif
+
+    puts("\ntesting automatic shrinking");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "shrink %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_tune_shrink(0, 1) );
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    /* default threshold is 6 */
+    assert( 0 == glh_tune_shrink(table, 5) );
+    assert( 0 == glh_tune_shrink(table, 6) );
+    assert( glh_tune_shrink(table, 4) );
+    assert( 0 == glh_tune_threshold(table, 5) );
+    assert( glh_tune_threshold(table, 6) );
+    assert( glh_tune_shrink(table, 0) );
+    assert( glh_tune_threshold(table, 1) );
+    assert( 0 == glh_tune_shrink(table, 1) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing tables do not shrink by default");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == table->shrink_threshold );
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], 0) );
+    }
+    peak = table->size;
+    for( i=0; i < n_keys; ++i ){
+        glh_delete(table, &keys[i * 16]);
+    }
+    assert( peak == table->size );
+    assert( glh_destroy(table, 1, 0) );
+
+    /* 0 is linear probing with dummies, then pow2, backshift and robin hood */
+    for( j=0; j < 4; ++j ){
+        flags = j == 0 ? 0 : j == 1 ? glh_FLAG_POW2 : j == 2 ? glh_FLAG_BACKSHIFT : glh_FLAG_ROBINHOOD;
+        printf("testing shrinking with flags %u\n", flags);
+
+        table = glh_new(hash_func, equal_func);
+        assert(table);
+        assert( glh_tune_pow2(table, flags == glh_FLAG_POW2) );
+        assert( glh_tune_backshift(table, flags == glh_FLAG_BACKSHIFT) );
+        assert( glh_tune_robinhood(table, flags == glh_FLAG_ROBINHOOD) );
+        assert( glh_tune_shrink(table, 1) );
+
+        for( i=0; i < n_keys; ++i ){
+            assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+        }
+        peak = table->size;
+
+        /* delete 95%, the table must have shrunk but never below the default */
+        for( i=0; i < n_keys - n_keys / 20; ++i ){
+            assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+            assert( table->size >= 32 );
+        }
+        assert( table->size < peak / 4 );
+        assert( glh_load(table) >= 1 );
+        for( i=0; i < n_keys; ++i ){
+            assert( (i < n_keys - n_keys / 20 ? 0 : &keys[i * 16]) == glh_get(table, &keys[i * 16]) );
+        }
+
+        /* oscillate around the size we shrunk to, this must not thrash */
+        size = table->size;
+        for( i=0; i < 1000; ++i ){
+            assert( glh_insert(table, &keys[0], 0) );
+            n_changes += size != table->size;
+            size = table->size;
+            assert( 0 == glh_delete(table, &keys[0]) );
+            n_changes += size != table->size;
+            size = table->size;
+        }
+        assert( 0 == n_changes );
+
+        /* delete everything, shrinks down to but not below the default */
+        for( i=n_keys - n_keys / 20; i < n_keys; ++i ){
+            assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+        }
+        assert( 32 == table->size );
+        assert( 0 == glh_nelems(table) );
+
+        assert( glh_destroy(table, 1, 0) );
+    }
+
+    puts("testing no shrinking during an incremental grow");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    assert( glh_tune_shrink(table, 2) );
+    for( i=0; ! table->old_entries; ++i ){
+        assert( glh_insert(table, &keys[i * 16], 0) );
+    }
+    size = table->size;
+    glh_delete(table, &keys[0]);
+    assert( size == table->size );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing incremental shrinking");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    assert( glh_tune_shrink(table, 1) );
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    /* finish the last grow so the next change in size is a shrink */
+    assert( glh_tune_incremental(table, 0) );
+    assert( glh_tune_incremental(table, 1) );
+    assert( 0 == table->old_entries );
+    peak = table->size;
+    for( i=0; table->size == peak; ++i ){
+        assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+    }
+    /* the shrinking delete only started the migration */
+    assert( table->size < peak );
+    assert( table->old_entries );
+    assert( peak == table->old_size );
+    for( j=0; j < n_keys; ++j ){
+        assert( (j < i ? 0 : &keys[j * 16]) == glh_get(table, &keys[j * 16]) );
+    }
+    /* delete 95% as above, every shrink is migrated a step at a time */
+    for( ; i < n_keys - n_keys / 20; ++i ){
+        assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+        assert( table->size >= 32 );
+    }
+    assert( table->size < peak / 4 );
+    for( i=0; i < n_keys; ++i ){
+        assert( (i < n_keys - n_keys / 20 ? 0 : &keys[i * 16]) == glh_get(table, &keys[i * 16]) );
+    }
+#ifdef glh_STATS
+    assert( glh_stats(table, &stats) );
+    assert( 0 == stats.n_resizes );
+#endif
+    assert( glh_destroy(table, 1, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+void iter(void){
+    struct glh_table *table = 0;
+    struct glh_iter it;
+    /* every key we insert, 16 bytes each
+     * the second half is only used to start an incremental grow
+     */
+    char *keys = 0;
+    /* number of times each key was visited */
+    size_t *seen = 0;
+    size_t n_keys = 2000;
+    /* number of keys inserted */
+    size_t n_inserted = 0;
+    const char *key = 0;
+    void *data = 0;
+    size_t n = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    puts("\ntesting iteration");
+
+    keys = calloc(n_keys * 2, 16);
+    seen = calloc(n_keys * 2, sizeof(size_t));
+    assert(keys);
+    assert(seen);
+    for( i=0; i < n_keys * 2; ++i ){
+        sprintf(&keys[i * 16], "iter %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_iter_init(0, 0) );
+    assert( 0 == glh_iter_init(&it, 0) );
+    assert( 0 == glh_iter_next(0, &key, &data) );
+
+    /* default, ctrl, robin hood, incremental and compact */
+    for( j=0; j < 5; ++j ){
+        printf("testing iteration over layout %lu\n", (unsigned long) j);
+
+        table = glh_new(hash_func, equal_func);
+        assert(table);
+        assert( glh_tune_ctrl(table, j == 1) );
+        assert( glh_tune_robinhood(table, j == 2) );
+        assert( glh_tune_incremental(table, j == 3) );
+        assert( glh_tune_compact(table, j == 4) );
+
+        /* an empty table has nothing to visit */
+        assert( glh_iter_init(&it, table) );
+        assert( 0 == glh_iter_next(&it, &key, &data) );
+
+        for( i=0; i < n_keys; ++i ){
+            assert( glh_insert(table, &keys[i * 16], &seen[i]) );
+        }
+        for( i=0; i < n_keys; i += 3 ){
+            assert( &seen[i] == glh_delete(table, &keys[i * 16]) );
+        }
+
+        n_inserted = n_keys;
+
+        /* stop part way through an incremental grow */
+        if( j == 3 ){
+            for( ; ! table->old_entries; ++n_inserted ){
+                assert( n_inserted < n_keys * 2 );
+                assert( glh_insert(table, &keys[n_inserted * 16], &seen[n_inserted]) );
+            }
+        }
+
+        memset(seen, 0, n_keys * 2 * sizeof(size_t));
+        n = 0;
+        assert( glh_iter_init(&it, table) );
+        while( glh_iter_next(&it, &key, &data) ){
+            assert( data == glh_get(table, key) );
+            ++*(size_t *) data;
+            ++n;
+        }
+        assert( n == glh_nelems(table) );
+        /* finished iterations stay finished */
+        assert( 0 == glh_iter_next(&it, 0, 0) );
+
+        for( i=0; i < n_inserted; ++i ){
+            assert( seen[i] == (size_t) glh_exists(table, &keys[i * 16]) );
+        }
+
+        assert( glh_destroy(table, 1, 0) );
+    }
+
+    free(keys);
+    free(seen);
+
+    puts("success!");
+}
+
+void compact(void){
+    struct glh_table *table = 0;
+    struct glh_iter it;
+    struct tenant tenant = {0, 0, (size_t) -1};
+    struct glh_allocator alloc = {tenant_alloc, tenant_zalloc, tenant_dealloc, 0};
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    /* data for each key */
+    int *datas = 0;
+    const char *batch[4];
+    void *out[4];
+    size_t n_keys = 4000;
+    const char *key = 0;
+    void *data = 0;
+    unsigned int created = 0;
+    size_t size = 0;
+    size_t n = 0;
+    size_t i = 0;
+
+    puts("\ntesting compact layout");
+
+    alloc.ctx = &tenant;
+
+    keys = calloc(n_keys, 16);
+    datas = calloc(n_keys, sizeof(int));
+    assert(keys);
+    assert(datas);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "compact %lu", (unsigned long) i);
+        datas[i] = i;
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_tune_compact(0, 1) );
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_ctrl(table, 1) );
+    assert( 0 == glh_tune_compact(table, 1) );
+    assert( glh_tune_ctrl(table, 0) );
+    assert( glh_tune_compact(table, 1) );
+    assert( table->flags & glh_FLAG_COMPACT );
+    assert( 0 == glh_tune_ctrl(table, 1) );
+    assert( 0 == glh_tune_backshift(table, 1) );
+    assert( 0 == glh_tune_robinhood(table, 1) );
+    assert( 0 == glh_tune_incremental(table, 1) );
+    /* disabling those is fine */
+    assert( glh_tune_ctrl(table, 0) );
+    assert( glh_tune_incremental(table, 0) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing insertion order");
+    table = glh_new_with_allocator(hash_func, equal_func, &alloc);
+    assert(table);
+    assert( glh_tune_compact(table, 1) );
+    assert( table->index );
+    /* entries are only sized for what threshold allows */
+    assert( table->entries_size < table->size );
+
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &datas[i]) );
+        assert( table->entries_size < table->size );
+    }
+    assert( 0 == glh_insert(table, &keys[0], &datas[0]) );
+
+    n = 0;
+    assert( glh_iter_init(&it, table) );
+    while( glh_iter_next(&it, &key, &data) ){
+        assert( key == &keys[n * 16] );
+        assert( data == &datas[n] );
+        ++n;
+    }
+    assert( n_keys == n );
+
+    puts("testing lookups");
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, &keys[i * 16]) );
+        assert( glh_exists(table, &keys[i * 16]) );
+    }
+    assert( 0 == glh_get(table, "not there") );
+    assert( &datas[7] == glh_set(table, &keys[7 * 16], &datas[8]) );
+    assert( &datas[8] == glh_get(table, &keys[7 * 16]) );
+    assert( &datas[8] == glh_set(table, &keys[7 * 16], &datas[7]) );
+    assert( &datas[9] == *glh_find_or_insert(table, &keys[9 * 16], &created) );
+    assert( 0 == created );
+
+    batch[0] = &keys[0];
+    batch[1] = "not there";
+    batch[2] = &keys[100 * 16];
+    batch[3] = &keys[3999 * 16];
+    assert( 3 == glh_get_batch(table, batch, 4, out) );
+    assert( &datas[0] == out[0] );
+    assert( 0 == out[1] );
+    assert( &datas[100] == out[2] );
+    assert( &datas[3999] == out[3] );
+
+    puts("testing deletes keep the order of what is left");
+    for( i=0; i < n_keys; i += 2 ){
+        assert( &datas[i] == glh_delete(table, &keys[i * 16]) );
+    }
+    assert( 0 == glh_delete(table, &keys[0]) );
+    assert( n_keys / 2 == glh_ndummies(table) );
+
+    n = 1;
+    assert( glh_iter_init(&it, table) );
+    while( glh_iter_next(&it, &key, &data) ){
+        assert( key == &keys[n * 16] );
+        n += 2;
+    }
+    assert( n_keys + 1 == n );
+
+    puts("testing resizing drops dummies and keeps order");
+    size = table->size;
+    assert( glh_resize(table, size * 2) );
+    assert( 0 == glh_ndummies(table) );
+    assert( n_keys / 2 == glh_nelems(table) );
+    /* live entries are now packed to the front */
+    for( i=0; i < n_keys / 2; ++i ){
+        assert( table->entries[i].key == &keys[(i * 2 + 1) * 16] );
+    }
+
+    puts("testing reinserting, deleted keys go on the end");
+    for( i=0; i < n_keys; i += 2 ){
+        assert( glh_insert(table, &keys[i * 16], &datas[i]) );
+    }
+    n = 0;
+    assert( glh_iter_init(&it, table) );
+    while( glh_iter_next(&it, &key, &data) ){
+        if( n < n_keys / 2 ){
+            assert( key == &keys[(n * 2 + 1) * 16] );
+        } else {
+            assert( key == &keys[(n - n_keys / 2) * 2 * 16] );
+        }
+        ++n;
+    }
+    assert( n_keys == n );
+
+    puts("testing changing threshold");
+    /* raising threshold runs out of entries before the load check */
+    assert( glh_tune_threshold(table, 10) );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_delete(table, &keys[i * 16]) );
+        assert( glh_insert(table, &keys[i * 16], &datas[i]) );
+    }
+    assert( glh_tune_threshold(table, 2) );
+    assert( glh_insert(table, "one more", 0) );
+    assert( (glh_nelems(table) * 10) / table->size < 2 );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, &keys[i * 16]) );
+    }
+
+    puts("testing disabling");
+    assert( glh_tune_compact(table, 0) );
+    assert( 0 == table->index );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, &keys[i * 16]) );
+    }
+    assert( glh_tune_compact(table, 1) );
+    assert( glh_tune_pow2(table, 1) );
+    assert( 0 == (table->size & (table->size - 1)) );
+    for( i=0; i < n_keys; ++i ){
+        assert( &datas[i] == glh_get(table, &keys[i * 16]) );
+    }
+
+    assert( glh_destroy(table, 1, 0) );
+    assert( 0 == tenant.bytes );
+
+    puts("testing compact with owned keys and shrinking");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_compact(table, 1) );
+    assert( glh_tune_own_keys(table, key_len_func) );
+    assert( glh_tune_shrink(table, 1) );
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &datas[i]) );
+    }
+    size = table->size;
+    for( i=0; i < n_keys - 10; ++i ){
+        assert( &datas[i] == glh_delete(table, &keys[i * 16]) );
+    }
+    assert( table->size < size );
+    n = 0;
+    assert( glh_iter_init(&it, table) );
+    while( glh_iter_next(&it, &key, &data) ){
+        assert( key != &keys[(n_keys - 10 + n) * 16] );
+        assert( 0 == strcmp(key, &keys[(n_keys - 10 + n) * 16]) );
+        ++n;
+    }
+    assert( 10 == n );
+    assert( glh_destroy(table, 1, 0) );
+
+    free(keys);
+    free(datas);
+
+    puts("success!");
+}
+
+/* glh_locked_apply callbacks */
+unsigned int locked_tune_ctrl(struct glh_table *table, void *ctx){
+    (void) ctx;
+    return glh_tune_ctrl(table, 1);
+}
+
+unsigned int locked_count(struct glh_table *table, void *ctx){
+    *(size_t *) ctx += glh_nelems(table);
+    return 1;
+}
+
+unsigned int locked_fail(struct glh_table *table, void *ctx){
+    (void) table;
+    ++*(size_t *) ctx;
+    return 0;
+}
+
+/* glh_locked_apply callback failing on any empty stripe */
+unsigned int locked_nonempty(struct glh_table *table, void *ctx){
+    (void) ctx;
+    return table->n_elems != 0;
+}
+
+/* one thread hammering a glh_locked */
+struct locked_worker {
+    struct glh_locked *locked;
+    /* every thread's keys, 16 bytes each */
+    char *keys;
+    /* this thread's keys are keys[first..first + n) */
+    size_t first;
+    size_t n;
+    /* total number of keys over every thread */
+    size_t n_total;
+    /* number of failed operations on this thread's own keys */
+    size_t failures;
+};
+
+void * locked_work(void *arg){
+    struct locked_worker *w = arg;
+    size_t i = 0;
+
+    for( i=w->first; i < w->first + w->n; ++i ){
+        w->failures += ! glh_locked_insert(w->locked, &w->keys[i * 16], &w->keys[i * 16]);
+
+        /* read every other thread's keys while they are being inserted */
+        glh_locked_get(w->locked, &w->keys[((i * 7) % w->n_total) * 16]);
+    }
+
+    for( i=w->first; i < w->first + w->n; ++i ){
+        w->failures += &w->keys[i * 16] != glh_locked_get(w->locked, &w->keys[i * 16]);
+    }
+
+    /* delete the odd ones */
+    for( i=w->first + 1; i < w->first + w->n; i += 2 ){
+        w->failures += &w->keys[i * 16] != glh_locked_delete(w->locked, &w->keys[i * 16]);
+    }
+
+    return 0;
+}
+
+void locked(void){
+    struct glh_locked *locked = 0;
+    struct locked_worker workers[4];
+    pthread_t threads[4];
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 20000;
+    size_t n_threads = 4;
+    size_t count = 0;
+    size_t i = 0;
+    int data = 0;
+
+    puts("\ntesting lock striped tables");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "locked %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_locked_new(0, hash_func, equal_func) );
+    assert( 0 == glh_locked_new(4, 0, equal_func) );
+    assert( 0 == glh_locked_destroy(0, 0) );
+    assert( 0 == glh_locked_nstripes(0) );
+    assert( 0 == glh_locked_nelems(0) );
+    assert( 0 == glh_locked_resize(0, 10) );
+    assert( 0 == glh_locked_apply(0, locked_count, &count) );
+    assert( 0 == glh_locked_exists(0, "a") );
+    assert( 0 == glh_locked_insert(0, "a", 0) );
+    assert( 0 == glh_locked_set(0, "a", 0) );
+    assert( 0 == glh_locked_get(0, "a") );
+    assert( 0 == glh_locked_delete(0, "a") );
+
+    locked = glh_locked_new(5, hash_func, equal_func);
+    assert(locked);
+    /* rounded up to a power of two */
+    assert( 8 == glh_locked_nstripes(locked) );
+    assert( 0 == glh_locked_resize(locked, 0) );
+    assert( 0 == glh_locked_apply(locked, 0, 0) );
+    assert( 0 == glh_locked_exists(locked, 0) );
+    assert( 0 == glh_locked_insert(locked, 0, 0) );
+    assert( 0 == glh_locked_set(locked, 0, 0) );
+    assert( 0 == glh_locked_get(locked, 0) );
+    assert( 0 == glh_locked_delete(locked, 0) );
+
+    puts("testing basic operations");
+    assert( glh_locked_insert(locked, "hello", &data) );
+    assert( 0 == glh_locked_insert(locked, "hello", &data) );
+    assert( glh_locked_exists(locked, "hello") );
+    assert( &data == glh_locked_get(locked, "hello") );
+    assert( &data == glh_locked_set(locked, "hello", keys) );
+    assert( keys == glh_locked_get(locked, "hello") );
+    assert( 1 == glh_locked_nelems(locked) );
+    assert( keys == glh_locked_delete(locked, "hello") );
+    assert( 0 == glh_locked_exists(locked, "hello") );
+    assert( 0 == glh_locked_nelems(locked) );
+
+    puts("testing apply");
+    assert( glh_locked_apply(locked, locked_tune_ctrl, 0) );
+    count = 0;
+    assert( 0 == glh_locked_apply(locked, locked_fail, &count) );
+    /* stopped at the first stripe */
+    assert( 1 == count );
+
+    puts("testing keys spread over every stripe");
+    for( i=0; i < 1000; ++i ){
+        assert( glh_locked_insert(locked, &keys[i * 16], &keys[i * 16]) );
+    }
+    count = 0;
+    assert( glh_locked_apply(locked, locked_count, &count) );
+    assert( 1000 == count );
+    assert( 1000 == glh_locked_nelems(locked) );
+    assert( glh_locked_apply(locked, locked_nonempty, 0) );
+
+    puts("testing resize");
+    assert( glh_locked_resize(locked, 8 * 1024) );
+    /* never so small that elements no longer fit */
+    assert( glh_locked_resize(locked, 1) );
+    for( i=0; i < 1000; ++i ){
+        assert( &keys[i * 16] == glh_locked_delete(locked, &keys[i * 16]) );
+    }
+    assert( glh_locked_destroy(locked, 0) );
+
+    puts("testing a single stripe");
+    locked = glh_locked_new(1, hash_func, equal_func);
+    assert(locked);
+    assert( 1 == glh_locked_nstripes(locked) );
+    assert( glh_locked_insert(locked, "hello", &data) );
+    assert( &data == glh_locked_get(locked, "hello") );
+    assert( glh_locked_destroy(locked, 0) );
+
+    puts("testing threads");
+    locked = glh_locked_new(16, hash_func, equal_func);
+    assert(locked);
+    for( i=0; i < n_threads; ++i ){
+        workers[i].locked = locked;
+        workers[i].keys = keys;
+        workers[i].first = i * (n_keys / n_threads);
+        workers[i].n = n_keys / n_threads;
+        workers[i].n_total = n_keys;
+        workers[i].failures = 0;
+        assert( 0 == pthread_create(&threads[i], 0, locked_work, &workers[i]) );
+    }
+    for( i=0; i < n_threads; ++i ){
+        assert( 0 == pthread_join(threads[i], 0) );
+        assert( 0 == workers[i].failures );
+    }
+    assert( n_keys / 2 == glh_locked_nelems(locked) );
+    for( i=0; i < n_keys; ++i ){
+        assert( (i % 2 ? 0 : &keys[i * 16]) == glh_locked_get(locked, &keys[i * 16]) );
+    }
+    assert( glh_locked_destroy(locked, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+/* one reader thread of a glh_rcu */
+struct rcu_worker {
+    struct glh_rcu *rcu;
+    /* every key, 16 bytes each, the first n_stable are never removed */
+    char *keys;
+    size_t n_stable;
+    size_t n_total;
+    /* set once the writer is done */
+    int *stop;
+    /* number of lookups seeing something they should not */
+    size_t failures;
+};
+
+void * rcu_work(void *arg){
+    struct rcu_worker *w = arg;
+    struct glh_rcu_reader *reader = 0;
+    /* data seen for a key which comes and goes */
+    void *data = 0;
+    size_t i = 0;
+
+    reader = glh_rcu_reader_register(w->rcu);
+    if( ! reader ){
+        ++w->failures;
+        return 0;
+    }
+
+    for( i=0; ! __atomic_load_n(w->stop, __ATOMIC_ACQUIRE); ++i ){
+        /* stable keys must always be found */
+        w->failures += &w->keys[(i % w->n_stable) * 16] != glh_rcu_get(w->rcu, &w->keys[(i % w->n_stable) * 16]);
+
+        /* the rest may or may not be there, but never mixed up */
+        data = glh_rcu_get(w->rcu, &w->keys[(w->n_stable + (i * 7) % (w->n_total - w->n_stable)) * 16]);
+        w->failures += data && data != &w->keys[(w->n_stable + (i * 7) % (w->n_total - w->n_stable)) * 16];
+
+        glh_rcu_quiescent(w->rcu, reader);
+    }
+
+    w->failures += ! glh_rcu_reader_unregister(w->rcu, reader);
+
+    return 0;
+}
+
+void rcu(void){
+    struct glh_rcu *rcu = 0;
+    struct glh_rcu *other = 0;
+    struct glh_rcu_reader *reader = 0;
+    struct rcu_worker workers[4];
+    pthread_t threads[4];
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 20000;
+    size_t n_stable = 1000;
+    size_t n_threads = 4;
+    size_t round = 0;
+    size_t i = 0;
+    int data = 0;
+    int stop = 0;
+    /* data handed back to rcu to free */
+    char *owned = 0;
+
+    puts("\ntesting rcu tables");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "rcu %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_rcu_new(0, equal_func) );
+    assert( 0 == glh_rcu_destroy(0, 0) );
+    assert( 0 == glh_rcu_reader_register(0) );
+    assert( 0 == glh_rcu_reader_unregister(0, 0) );
+    assert( 0 == glh_rcu_reclaim(0) );
+    assert( 0 == glh_rcu_retire(0, keys) );
+    assert( 0 == glh_rcu_nelems(0) );
+    assert( 0 == glh_rcu_resize(0, 10) );
+    assert( 0 == glh_rcu_exists(0, "a") );
+    assert( 0 == glh_rcu_insert(0, "a", 0) );
+    assert( 0 == glh_rcu_set(0, "a", 0) );
+    assert( 0 == glh_rcu_get(0, "a") );
+    assert( 0 == glh_rcu_delete(0, "a") );
+    /* does nothing */
+    glh_rcu_quiescent(0, 0);
+
+    rcu = glh_rcu_new(hash_func, equal_func);
+    assert(rcu);
+    assert( 0 == glh_rcu_reader_unregister(rcu, 0) );
+    assert( 0 == glh_rcu_retire(rcu, 0) );
+    assert( 0 == glh_rcu_resize(rcu, 0) );
+    assert( 0 == glh_rcu_exists(rcu, 0) );
+    assert( 0 == glh_rcu_insert(rcu, 0, 0) );
+    assert( 0 == glh_rcu_set(rcu, 0, 0) );
+    assert( 0 == glh_rcu_get(rcu, 0) );
+    assert( 0 == glh_rcu_delete(rcu, 0) );
+
+    puts("testing basic operations");
+    assert( glh_rcu_insert(rcu, "hello", &data) );
+    assert( 0 == glh_rcu_insert(rcu, "hello", &data) );
+    assert( glh_rcu_exists(rcu, "hello") );
+    assert( &data == glh_rcu_get(rcu, "hello") );
+    assert( &data == glh_rcu_set(rcu, "hello", keys) );
+    assert( keys == glh_rcu_get(rcu, "hello") );
+    assert( 0 == glh_rcu_set(rcu, "world", keys) );
+    assert( 1 == glh_rcu_nelems(rcu) );
+    assert( keys == glh_rcu_delete(rcu, "hello") );
+    assert( 0 == glh_rcu_delete(rcu, "hello") );
+    assert( 0 == glh_rcu_exists(rcu, "hello") );
+    assert( 0 == glh_rcu_get(rcu, "hello") );
+    assert( 0 == glh_rcu_nelems(rcu) );
+    /* deleted slots are not reused */
+    assert( glh_rcu_insert(rcu, "hello", &data) );
+    assert( &data == glh_rcu_get(rcu, "hello") );
+
+    puts("testing growth and dummy clean up");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_rcu_insert(rcu, &keys[i * 16], &keys[i * 16]) );
+    }
+    assert( n_keys + 1 == glh_rcu_nelems(rcu) );
+    for( round=0; round < 3; ++round ){
+        for( i=0; i < n_keys; ++i ){
+            assert( &keys[i * 16] == glh_rcu_delete(rcu, &keys[i * 16]) );
+        }
+        for( i=0; i < n_keys; ++i ){
+            assert( glh_rcu_insert(rcu, &keys[i * 16], &keys[i * 16]) );
+        }
+    }
+    for( i=0; i < n_keys; ++i ){
+        assert( &keys[i * 16] == glh_rcu_get(rcu, &keys[i * 16]) );
+    }
+    assert( glh_rcu_resize(rcu, 64 * 1024) );
+    assert( 0 == glh_rcu_resize(rcu, 1) );
+    for( i=0; i < n_keys; ++i ){
+        assert( &keys[i * 16] == glh_rcu_get(rcu, &keys[i * 16]) );
+    }
+
+    puts("testing reclamation");
+    /* with no readers everything is freed as soon as it is replaced */
+    assert( glh_rcu_resize(rcu, 32 * 1024) );
+    assert( 0 == glh_rcu_reclaim(rcu) );
+    reader = glh_rcu_reader_register(rcu);
+    assert(reader);
+    /* a reader on a different table cannot be unregistered here */
+    other = glh_rcu_new(hash_func, equal_func);
+    assert(other);
+    assert( 0 == glh_rcu_reader_unregister(other, reader) );
+    assert( glh_rcu_destroy(other, 0) );
+    /* old entries and the old snapshot wait for our reader */
+    assert( glh_rcu_resize(rcu, 64 * 1024) );
+    owned = calloc(1, 16);
+    assert(owned);
+    assert( glh_rcu_insert(rcu, "owned", owned) );
+    assert( owned == glh_rcu_delete(rcu, "owned") );
+    assert( glh_rcu_retire(rcu, owned) );
+    assert( 0 == glh_rcu_reclaim(rcu) );
+    glh_rcu_quiescent(rcu, reader);
+    assert( 3 == glh_rcu_reclaim(rcu) );
+    assert( 0 == glh_rcu_reclaim(rcu) );
+    /* anything left over is freed on destroy */
+    assert( glh_rcu_resize(rcu, 32 * 1024) );
+    assert( glh_rcu_reader_unregister(rcu, reader) );
+    assert( glh_rcu_destroy(rcu, 0) );
+
+    puts("testing readers alongside a writer");
+    rcu = glh_rcu_new(hash_func, equal_func);
+    assert(rcu);
+    for( i=0; i < n_stable; ++i ){
+        assert( glh_rcu_insert(rcu, &keys[i * 16], &keys[i * 16]) );
+    }
+    for( i=0; i < n_threads; ++i ){
+        workers[i].rcu = rcu;
+        workers[i].keys = keys;
+        workers[i].n_stable = n_stable;
+        workers[i].n_total = n_keys;
+        workers[i].stop = &stop;
+        workers[i].failures = 0;
+        assert( 0 == pthread_create(&threads[i], 0, rcu_work, &workers[i]) );
+    }
+    /* insert and delete everything else, growing and rebuilding as we go */
+    for( round=0; round < 4; ++round ){
+        for( i=n_stable; i < n_keys; ++i ){
+            assert( glh_rcu_insert(rcu, &keys[i * 16], &keys[i * 16]) );
+            if( i % 3 == 0 ){
+                assert( &keys[i * 16] == glh_rcu_set(rcu, &keys[i * 16], 0) );
+                assert( 0 == glh_rcu_set(rcu, &keys[i * 16], &keys[i * 16]) );
+            }
+        }
+        assert( glh_rcu_resize(rcu, 4 * n_keys) );
+        for( i=n_stable; i < n_keys; ++i ){
+            assert( &keys[i * 16] == glh_rcu_delete(rcu, &keys[i * 16]) );
+        }
+        glh_rcu_reclaim(rcu);
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for( i=0; i < n_threads; ++i ){
+        assert( 0 == pthread_join(threads[i], 0) );
+        assert( 0 == workers[i].failures );
+    }
+    assert( n_stable == glh_rcu_nelems(rcu) );
+    assert( glh_rcu_destroy(rcu, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+/* glh_sharded_apply callback counting elements into *(size_t *) ctx */
+unsigned int sharded_count(struct glh_table *table, void *ctx){
+    *(size_t *) ctx += table->n_elems;
+    return 1;
+}
+
+void sharded(void){
+    struct glh_sharded *sharded = 0;
+    struct glh_table *shard = 0;
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 20000;
+    size_t count = 0;
+    size_t i = 0;
+    /* smallest and largest shard */
+    size_t min_size = 0;
+    size_t max_size = 0;
+    int data = 0;
+    void *out = 0;
+    void **slot = 0;
+    unsigned int created = 0;
+
+    puts("\ntesting sharded tables");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "sharded %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_sharded_new(0, hash_func, equal_func) );
+    assert( 0 == glh_sharded_new(4, 0, equal_func) );
+    assert( 0 == glh_sharded_destroy(0, 0) );
+    assert( 0 == glh_sharded_nshards(0) );
+    assert( 0 == glh_sharded_nelems(0) );
+    assert( 0 == glh_sharded_shard(0, 0) );
+    assert( 0 == glh_sharded_which(0, "a") );
+    assert( 0 == glh_sharded_resize(0, 10) );
+    assert( 0 == glh_sharded_reserve(0, 10) );
+    assert( 0 == glh_sharded_apply(0, sharded_count, &count) );
+    assert( 0 == glh_sharded_exists(0, "a") );
+    assert( 0 == glh_sharded_insert(0, "a", 0) );
+    assert( 0 == glh_sharded_set(0, "a", 0) );
+    assert( 0 == glh_sharded_get(0, "a") );
+    assert( 0 == glh_sharded_try_get(0, "a", &out) );
+    assert( 0 == glh_sharded_find_or_insert(0, "a", &created) );
+    assert( 0 == glh_sharded_delete(0, "a") );
+
+    sharded = glh_sharded_new(5, hash_func, equal_func);
+    assert(sharded);
+    /* rounded up to a power of two */
+    assert( 8 == glh_sharded_nshards(sharded) );
+    assert( 0 == glh_sharded_shard(sharded, 8) );
+    assert( 8 == glh_sharded_which(sharded, 0) );
+    assert( 0 == glh_sharded_resize(sharded, 0) );
+    assert( 0 == glh_sharded_apply(sharded, 0, 0) );
+    assert( 0 == glh_sharded_exists(sharded, 0) );
+    assert( 0 == glh_sharded_insert(sharded, 0, 0) );
+    assert( 0 == glh_sharded_set(sharded, 0, 0) );
+    assert( 0 == glh_sharded_get(sharded, 0) );
+    assert( 0 == glh_sharded_try_get(sharded, 0, &out) );
+    assert( 0 == glh_sharded_find_or_insert(sharded, 0, &created) );
+    assert( 0 == glh_sharded_delete(sharded, 0) );
+
+    puts("testing basic operations");
+    assert( glh_sharded_insert(sharded, "hello", &data) );
+    assert( 0 == glh_sharded_insert(sharded, "hello", &data) );
+    assert( glh_sharded_exists(sharded, "hello") );
+    assert( &data == glh_sharded_get(sharded, "hello") );
+    assert( glh_sharded_try_get(sharded, "hello", &out) );
+    assert( &data == out );
+    assert( &data == glh_sharded_set(sharded, "hello", keys) );
+    assert( keys == glh_sharded_get(sharded, "hello") );
+    assert( 1 == glh_sharded_nelems(sharded) );
+    /* the key lives in the shard it is routed to */
+    shard = glh_sharded_shard(sharded, glh_sharded_which(sharded, "hello"));
+    assert(shard);
+    assert( keys == glh_get(shard, "hello") );
+    assert( keys == glh_sharded_delete(sharded, "hello") );
+    assert( 0 == glh_sharded_exists(sharded, "hello") );
+    assert( 0 == glh_sharded_nelems(sharded) );
+    slot = glh_sharded_find_or_insert(sharded, "hello", &created);
+    assert(slot);
+    assert(created);
+    *slot = &data;
+    assert( slot == glh_sharded_find_or_insert(sharded, "hello", &created) );
+    assert( ! created );
+    assert( &data == glh_sharded_delete(sharded, "hello") );
+
+    puts("testing keys spread over every shard");
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_sharded_insert(sharded, &keys[i * 16], &keys[i * 16]) );
+    }
+    assert( n_keys == glh_sharded_nelems(sharded) );
+    count = 0;
+    assert( glh_sharded_apply(sharded, sharded_count, &count) );
+    assert( n_keys == count );
+    for( i=0; i < glh_sharded_nshards(sharded); ++i ){
+        shard = glh_sharded_shard(sharded, i);
+        /* every shard got a fair share and grew on it's own */
+        assert( shard->n_elems > n_keys / 16 );
+        assert( shard->size > 32 );
+    }
+
+    puts("testing resize and reserve");
+    assert( glh_sharded_resize(sharded, 64 * 1024) );
+    for( i=0; i < glh_sharded_nshards(sharded); ++i ){
+        assert( 8 * 1024 == glh_sharded_shard(sharded, i)->size );
+    }
+    /* never so small that elements no longer fit */
+    assert( glh_sharded_resize(sharded, 1) );
+    assert( glh_sharded_reserve(sharded, 4 * n_keys) );
+    for( i=0; i < glh_sharded_nshards(sharded); ++i ){
+        shard = glh_sharded_shard(sharded, i);
+        if( ! min_size || shard->size < min_size ){
+            min_size = shard->size;
+        }
+        if( shard->size > max_size ){
+            max_size = shard->size;
+        }
+    }
+    assert( min_size == max_size );
+    for( i=0; i < n_keys; ++i ){
+        assert( &keys[i * 16] == glh_sharded_get(sharded, &keys[i * 16]) );
+    }
+    for( i=0; i < n_keys; ++i ){
+        assert( &keys[i * 16] == glh_sharded_delete(sharded, &keys[i * 16]) );
+    }
+    assert( 0 == glh_sharded_nelems(sharded) );
+    assert( glh_sharded_destroy(sharded, 0) );
+
+    puts("testing a single shard");
+    sharded = glh_sharded_new(1, hash_func, equal_func);
+    assert(sharded);
+    assert( 1 == glh_sharded_nshards(sharded) );
+    assert( 0 == glh_sharded_which(sharded, "hello") );
+    assert( glh_sharded_insert(sharded, "hello", &data) );
+    assert( &data == glh_sharded_get(sharded, "hello") );
+    assert( glh_sharded_destroy(sharded, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+/* hash for parallel, "edge N" and "wrap N" keys are packed two to a slot
+ * just before the end of the first of 4 ranges and the end of a table
+ * of 512K slots, so that their probes run off the end of their range
+ */
+unsigned long int parallel_hash(const void *key_void){
+    const char *key = key_void;
+
+    if( ! strncmp(key, "edge ", 5) ){
+        return 128 * 1024 - 100 + strtoul(key + 5, 0, 10) / 2;
+    }
+
+    if( ! strncmp(key, "wrap ", 5) ){
+        return 512 * 1024 - 100 + strtoul(key + 5, 0, 10) / 2;
+    }
+
+    return hash_func(key);
+}
+
+/* build a table for parallel, resize it and check every key survived */
+void parallel_check(char *keys, size_t n_keys, unsigned int ctrl, unsigned int pow2, size_t n_threads){
+    struct glh_table *table = 0;
+    size_t i = 0;
+
+    table = glh_new(parallel_hash, equal_func);
+    assert(table);
+    assert( glh_tune_ctrl(table, ctrl) );
+    assert( glh_tune_pow2(table, pow2) );
+
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    /* leave some dummies behind */
+    for( i=0; i < n_keys; i += 5 ){
+        assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+    }
+
+    assert( glh_resize_parallel(table, 512 * 1024, n_threads) );
+    assert( 512 * 1024 == table->size );
+    assert( 0 == table->n_dummies );
+    assert( n_keys - (n_keys + 4) / 5 == table->n_elems );
+    for( i=0; i < n_keys; ++i ){
+        assert( (i % 5 ? &keys[i * 16] : 0) == glh_get(table, &keys[i * 16]) );
+    }
+    assert( 0 == glh_get(table, "edge 100000") );
+
+    /* and it carries on working as normal */
+    for( i=0; i < n_keys; i += 5 ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    for( i=0; i < n_keys; ++i ){
+        assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+    }
+    assert( 0 == table->n_elems );
+
+    assert( glh_destroy(table, 1, 0) );
+}
+
+void parallel(void){
+    struct glh_table *table = 0;
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 100 * 1000;
+    /* number of edge and wrap keys each */
+    size_t n_edge = 200;
+    /* last key inserted before a grow was left part way */
+    size_t n_grow = 0;
+    size_t i = 0;
+
+    puts("\ntesting parallel resize");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_edge; ++i ){
+        sprintf(&keys[i * 16], "edge %lu", (unsigned long) i);
+        sprintf(&keys[(n_edge + i) * 16], "wrap %lu", (unsigned long) i);
+    }
+    for( i=2 * n_edge; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "parallel %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_resize_parallel(0, 10, 4) );
+    assert( 0 == glh_reserve_parallel(0, 10, 4) );
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == glh_resize_parallel(table, 0, 4) );
+    assert( 0 == glh_reserve_parallel(table, (size_t) -1, 4) );
+
+    puts("testing small tables fall back to glh_resize");
+    assert( glh_insert(table, "hello", keys) );
+    assert( glh_resize_parallel(table, 1000, 4) );
+    assert( 1000 == table->size );
+    assert( keys == glh_get(table, "hello") );
+    assert( glh_reserve_parallel(table, 10, 4) );
+    assert( 1000 == table->size );
+    assert( glh_reserve_parallel(table, 1000, 4) );
+    assert( table->size > 1000 );
+    assert( keys == glh_get(table, "hello") );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing entries overflowing their range");
+    parallel_check(keys, n_keys, 0, 0, 4);
+
+    puts("testing with control bytes and power of two sizes");
+    parallel_check(keys, n_keys, 1, 1, 4);
+
+    puts("testing odd thread counts");
+    parallel_check(keys, n_keys, 0, 1, 3);
+    parallel_check(keys, n_keys, 1, 0, 1000);
+
+    puts("testing an incremental grow is finished first");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    /* stop part way through a grow, with enough elements to split */
+    for( n_grow=2 * n_edge; n_grow < n_keys; ++n_grow ){
+        assert( glh_insert(table, &keys[n_grow * 16], &keys[n_grow * 16]) );
+        if( n_grow > 70 * 1000 && table->old_entries ){
+            break;
+        }
+    }
+    assert( table->old_entries );
+    /* less than the elements it holds */
+    assert( 0 == glh_resize_parallel(table, 1000, 4) );
+    assert( glh_reserve_parallel(table, 4 * n_keys, 4) );
+    assert( 0 == table->old_entries );
+    for( i=2 * n_edge; i <= n_grow; ++i ){
+        assert( &keys[i * 16] == glh_get(table, &keys[i * 16]) );
+    }
+
+    puts("testing robin hood tables fall back to glh_resize");
+    assert( glh_tune_incremental(table, 0) );
+    assert( glh_tune_robinhood(table, 1) );
+    assert( glh_resize_parallel(table, 8 * n_keys, 4) );
+    for( i=2 * n_edge; i <= n_grow; ++i ){
+        assert( &keys[i * 16] == glh_get(table, &keys[i * 16]) );
+    }
+    assert( glh_destroy(table, 1, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
+/* saved data length for snapshot, strings including their 0 byte */
+size_t snapshot_data_len(const void *data){
+    return strlen(data) + 1;
+}
+
+void snapshot(void){
+    struct glh_table *table = 0;
+    struct glh_table *mapped = 0;
+    /* a valid slot of a snapshot, a corrupted copy and where it lives */
+    struct glh_map_slot good;
+    struct glh_map_slot bad;
+    size_t slot_off = 0;
+    /* keys of the large table, 16 bytes each */
+    char *big = 0;
+    size_t n_big = 100 * 1000;
+    char path[] = "/tmp/test_glh_snapshot_XXXXXX";
+    int fd = -1;
+    char keys[1000][16];
+    const char *lookups[1000];
+    void *out[1000];
+    struct glh_iter iter;
+    struct glh_stats stats;
+    const char *key = 0;
+    void *data = 0;
+    size_t n = 0;
+    size_t i = 0;
+
+    puts("\ntesting snapshot save and mmap loading");
+
+    for( i=0; i < 1000; ++i ){
+        sprintf(keys[i], "snapshot %lu", (unsigned long) i);
+        lookups[i] = keys[i];
+    }
+
+    fd = mkstemp(path);
+    assert( fd >= 0 );
+
+    puts("testing error handling");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == glh_save(0, fd) );
+    assert( 0 == glh_save(table, -1) );
+    assert( 0 == glh_map(0, hash_func, equal_func) );
+    assert( 0 == glh_map(path, 0, equal_func) );
+    assert( 0 == glh_map("/nonexistent/glh_snapshot", hash_func, equal_func) );
+    /* still empty */
+    assert( 0 == glh_map(path, hash_func, equal_func) );
+
+    puts("testing an empty table");
+    assert( glh_save(table, fd) );
+    mapped = glh_map(path, hash_func, equal_func);
+    assert(mapped);
+    assert( 0 == glh_nelems(mapped) );
+    assert( 0 == glh_exists(mapped, "hello") );
+    assert( glh_iter_init(&iter, mapped) );
+    assert( 0 == glh_iter_next(&iter, 0, 0) );
+    assert( glh_destroy(mapped, 1, 0) );
+
+    puts("testing saved data values");
+    for( i=0; i < 1000; ++i ){
+        assert( glh_insert(table, keys[i], (void *) (uintptr_t) (i + 1)) );
+    }
+    /* leave a dummy behind, which is not saved */
+    assert( (void *) 1 == glh_delete(table, keys[0]) );
+    assert( 0 == ftruncate(fd, 0) );
+    assert( 0 == lseek(fd, 0, SEEK_SET) );
+    assert( glh_save(table, fd) );
+
+    mapped = glh_map(path, hash_func, equal_func);
+    assert(mapped);
+    assert( mapped->flags & glh_FLAG_MAPPED );
+    assert( 999 == glh_nelems(mapped) );
+    assert( 0 == glh_exists(mapped, keys[0]) );
+    assert( 0 == glh_get(mapped, keys[0]) );
+    assert( 0 == glh_try_get(mapped, keys[0], &data) );
+    for( i=1; i < 1000; ++i ){
+        assert( glh_exists(mapped, keys[i]) );
+        assert( (void *) (uintptr_t) (i + 1) == glh_get(mapped, keys[i]) );
+        assert( glh_try_get(mapped, keys[i], &data) );
+        assert( (void *) (uintptr_t) (i + 1) == data );
+    }
+    assert( 999 == glh_get_batch(mapped, lookups, 1000, out) );
+    assert( 0 == out[0] );
+    assert( (void *) 1000 == out[999] );
+
+    puts("testing iteration visits keys within the mapping");
+    assert( glh_iter_init(&iter, mapped) );
+    while( glh_iter_next(&iter, &key, &data) ){
+        assert( (void *) key > (void *) mapped->map );
+        assert( key < (const char *) mapped->map + mapped->map_len );
+        assert( data == glh_get(table, key) );
+        ++n;
+    }
+    assert( 999 == n );
+
+    assert( glh_stats(mapped, &stats) );
+    assert( 999 == stats.n_elems );
+    assert( 0 == stats.n_dummies );
+
+    puts("testing mapped tables are read only");
+    assert( 0 == glh_insert(mapped, "hello", table) );
+    assert( 0 == glh_set(mapped, keys[1], table) );
+    assert( 0 == glh_delete(mapped, keys[1]) );
+    assert( 0 == glh_resize(mapped, 4096) );
+    assert( 0 == glh_tune_ctrl(mapped, 1) );
+    assert( 0 == glh_save(mapped, fd) );
+    assert( 999 == glh_nelems(mapped) );
+    assert( (void *) 2 == glh_get(mapped, keys[1]) );
+    assert( glh_destroy(mapped, 1, 0) );
+
+    puts("testing the wrong hash_func is caught");
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing stored hashes are saved, part way through a grow");
+    table = glh_new(counting_hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    for( i=0; i < 1000 && ! (i > 100 && table->old_entries); ++i ){
+        assert( glh_insert(table, keys[i], keys[i]) );
+    }
+    assert( table->old_entries );
+    n = i;
+    assert( 0 == ftruncate(fd, 0) );
+    assert( 0 == lseek(fd, 0, SEEK_SET) );
+    hash_calls = 0;
+    assert( glh_save(table, fd) );
+    assert( 0 == hash_calls );
+    mapped = glh_map(path, hash_func, equal_func);
+    assert(mapped);
+    assert( n == glh_nelems(mapped) );
+    for( i=0; i < n; ++i ){
+        assert( keys[i] == glh_get(mapped, keys[i]) );
+    }
+    assert( glh_destroy(mapped, 1, 0) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing saved data and colliding hashes");
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    for( i=0; i < 100; ++i ){
+        assert( glh_insert(table, keys[i], keys[999 - i]) );
+    }
+    assert( 0 == ftruncate(fd, 0) );
+    assert( 0 == lseek(fd, 0, SEEK_SET) );
+    assert( glh_save_with_data(table, fd, snapshot_data_len) );
+
+    mapped = glh_map(path, weak_hash_func, equal_func);
+    assert(mapped);
+    for( i=0; i < 100; ++i ){
+        data = glh_get(mapped, keys[i]);
+        assert(data);
+        /* a copy within the mapping */
+        assert( data != keys[999 - i] );
+        assert( 0 == strcmp(data, keys[999 - i]) );
+        assert( 0 == ((uintptr_t) data % 16) );
+    }
+    assert( 0 == glh_exists(mapped, keys[100]) );
+
+    /* the last occupied slot, glh_map checks the first one anyway */
+    for( i=mapped->size; ! mapped->map_slots[i - 1].key; --i ){
+    }
+    slot_off = (const unsigned char *) &(mapped->map_slots[i - 1]) - mapped->map;
+    good = mapped->map_slots[i - 1];
+    assert( good.data_len );
+    assert( glh_destroy(mapped, 1, 0) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing every slot of a mapping is checked");
+    bad = good;
+    bad.key_len = 1 << 30;
+    assert( sizeof(bad) == pwrite(fd, &bad, sizeof(bad), slot_off) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    bad = good;
+    /* pointing back into the slots */
+    bad.key = 4096;
+    assert( sizeof(bad) == pwrite(fd, &bad, sizeof(bad), slot_off) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    bad = good;
+    bad.data_len = 1 << 30;
+    assert( sizeof(bad) == pwrite(fd, &bad, sizeof(bad), slot_off) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    assert( sizeof(good) == pwrite(fd, &good, sizeof(good), slot_off) );
+    /* overwrite the key's 0 byte */
+    assert( 1 == pwrite(fd, "x", 1, good.key + good.key_len) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    assert( 1 == pwrite(fd, "", 1, good.key + good.key_len) );
+    mapped = glh_map(path, weak_hash_func, equal_func);
+    assert(mapped);
+    assert( glh_destroy(mapped, 1, 0) );
+
+    puts("testing parallel resize refuses a mapping");
+    /* large enough that glh_resize_parallel does not fall back to glh_resize */
+    big = calloc(n_big, 16);
+    assert(big);
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    for( i=0; i < n_big; ++i ){
+        sprintf(&big[i * 16], "big %lu", (unsigned long) i);
+        assert( glh_insert(table, &big[i * 16], (void *) (uintptr_t) (i + 1)) );
+    }
+    assert( 0 == ftruncate(fd, 0) );
+    assert( 0 == lseek(fd, 0, SEEK_SET) );
+    assert( glh_save(table, fd) );
+    assert( glh_destroy(table, 1, 0) );
+
+    mapped = glh_map(path, hash_func, equal_func);
+    assert(mapped);
+    assert( 0 == glh_resize_parallel(mapped, 1 << 20, 4) );
+    assert( 0 == glh_reserve_parallel(mapped, 1 << 20, 4) );
+    for( i=0; i < n_big; ++i ){
+        assert( (void *) (uintptr_t) (i + 1) == glh_get(mapped, &big[i * 16]) );
+    }
+    assert( glh_destroy(mapped, 1, 0) );
+    free(big);
+
+    puts("testing truncated and foreign files are refused");
+    assert( 0 == ftruncate(fd, 5000) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+    assert( 0 == lseek(fd, 0, SEEK_SET) );
+    assert( 5 == write(fd, "hello", 5) );
+    assert( 0 == glh_map(path, weak_hash_func, equal_func) );
+
+    close(fd);
+    unlink(path);
+
+    puts("success!");
+}
+
+/* freeze a table of n_keys keys made with the given tune_* settings
+ * and check every key is still found in it's one slot
+ */
+void freeze_check(char *keys, size_t n_keys, unsigned int ctrl, unsigned int compact, unsigned int own_keys){
+    struct glh_table *table = 0;
+    const char *lookups[100];
+    void *out[100];
+    struct glh_iter iter;
+    const char *key = 0;
+    void *data = 0;
+    char miss[32];
+    size_t n = 0;
+    size_t i = 0;
+
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_ctrl(table, ctrl) );
+    assert( glh_tune_compact(table, compact) );
+    if( own_keys ){
+        assert( glh_tune_own_keys(table, key_len_func) );
+#if glh_INLINE_KEY_LEN
+        assert( glh_tune_inline(table, key_len_func) );
+#endif
+    }
+    for( i=0; i < n_keys; ++i ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    /* leave some dummies behind */
+    for( i=0; i < n_keys; i += 7 ){
+        assert( &keys[i * 16] == glh_delete(table, &keys[i * 16]) );
+    }
+    n = glh_nelems(table);
+
+    assert( glh_freeze(table) );
+    assert( table->flags & glh_FLAG_FROZEN );
+    assert( n == glh_nelems(table) );
+    /* barely any headroom */
+    assert( table->size > n );
+    assert( table->size <= n + n / 99 + 1 );
+    assert( 0 == table->n_dummies );
+    assert( 0 == table->ctrl );
+    assert( 0 == table->index );
+
+    for( i=0; i < n_keys; ++i ){
+        if( i % 7 ){
+            assert( glh_exists(table, &keys[i * 16]) );
+            assert( &keys[i * 16] == glh_get(table, &keys[i * 16]) );
+            assert( glh_try_get(table, &keys[i * 16], &data) );
+            assert( &keys[i * 16] == data );
+        } else {
+            assert( 0 == glh_exists(table, &keys[i * 16]) );
+            assert( 0 == glh_get(table, &keys[i * 16]) );
+        }
+    }
+    for( i=0; i < n_keys; ++i ){
+        sprintf(miss, "missing %lu", (unsigned long) i);
+        assert( 0 == glh_exists(table, miss) );
+    }
+
+    for( i=0; i < 100; ++i ){
+        lookups[i] = &keys[i * 16];
+    }
+    assert( 100 - 15 == glh_get_batch(table, lookups, 100, out) );
+    assert( 0 == out[0] );
+    assert( &keys[16] == out[1] );
+
+    i = 0;
+    assert( glh_iter_init(&iter, table) );
+    while( glh_iter_next(&iter, &key, &data) ){
+        assert( 0 == strcmp(key, data) );
+        ++i;
+    }
+    assert( n == i );
+
+    assert( glh_destroy(table, 1, 0) );
+}
+
+void freeze(void){
+    struct glh_table *table = 0;
+    struct glh_table *mapped = 0;
+    /* keys of the large table, 16 bytes each */
+    char *big = 0;
+    size_t n_big = 100 * 1000;
+    char path[] = "/tmp/test_glh_freeze_XXXXXX";
+    int fd = -1;
+    /* every key we insert, 16 bytes each */
+    char *keys = 0;
+    size_t n_keys = 10 * 1000;
+    size_t i = 0;
+    size_t n = 0;
+
+    puts("\ntesting frozen minimal perfect hash tables");
+
+    keys = calloc(n_keys, 16);
+    assert(keys);
+    for( i=0; i < n_keys; ++i ){
+        sprintf(&keys[i * 16], "frozen %lu", (unsigned long) i);
+    }
+
+    puts("testing error handling");
+    assert( 0 == glh_freeze(0) );
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( 0 == glh_freeze(table) );
+
+    puts("testing a single key");
+    assert( glh_insert(table, "hello", keys) );
+    assert( glh_freeze(table) );
+    assert( 2 == table->size );
+    assert( keys == glh_get(table, "hello") );
+    assert( 0 == glh_get(table, "world") );
+    assert( 0 == glh_freeze(table) );
+
+    puts("testing frozen tables are read only");
+    assert( 0 == glh_insert(table, "world", keys) );
+    assert( 0 == glh_set(table, "hello", 0) );
+    assert( 0 == glh_delete(table, "hello") );
+    assert( 0 == glh_resize(table, 100) );
+    assert( 0 == glh_tune_ctrl(table, 1) );
+    assert( keys == glh_get(table, "hello") );
+    assert( 1 == glh_nelems(table) );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing plain, control byte, compact and own key tables");
+    freeze_check(keys, n_keys, 0, 0, 0);
+    freeze_check(keys, n_keys, 1, 0, 0);
+    freeze_check(keys, n_keys, 0, 1, 0);
+    freeze_check(keys, n_keys, 0, 0, 1);
+
+    puts("testing an incremental grow is finished first");
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    for( i=0; i < n_keys && ! (i > 1000 && table->old_entries); ++i ){
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    assert( table->old_entries );
+    assert( glh_freeze(table) );
+    assert( 0 == table->old_entries );
+    assert( 0 == table->old_size );
+    assert( i + i / 99 + 1 == table->size );
+    while( i-- ){
+        assert( &keys[i * 16] == glh_get(table, &keys[i * 16]) );
+    }
+
+    puts("testing frozen tables can be saved");
+    fd = mkstemp(path);
+    assert( fd >= 0 );
+    assert( glh_save(table, fd) );
+    close(fd);
+    mapped = glh_map(path, hash_func, equal_func);
+    assert(mapped);
+    assert( glh_nelems(table) == glh_nelems(mapped) );
+    assert( 0 == glh_freeze(mapped) );
+    assert( glh_destroy(mapped, 1, 0) );
+    unlink(path);
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing parallel resize refuses a frozen table");
+    /* large enough that glh_resize_parallel does not fall back to glh_resize */
+    big = calloc(n_big, 16);
+    assert(big);
+    table = glh_new(hash_func, equal_func);
+    assert(table);
+    for( i=0; i < n_big; ++i ){
+        sprintf(&big[i * 16], "big %lu", (unsigned long) i);
+        assert( glh_insert(table, &big[i * 16], &big[i * 16]) );
+    }
+    assert( glh_freeze(table) );
+    assert( 0 == glh_resize_parallel(table, 1 << 20, 4) );
+    assert( 0 == glh_reserve_parallel(table, 1 << 20, 4) );
+    for( i=0; i < n_big; ++i ){
+        assert( &big[i * 16] == glh_get(table, &big[i * 16]) );
+    }
+    assert( glh_destroy(table, 1, 0) );
+    free(big);
+
+    puts("testing keys sharing a hash are refused");
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    assert( glh_insert(table, "hello", keys) );
+    assert( glh_insert(table, "help", keys) );
+    assert( 0 == glh_freeze(table) );
+    assert( 0 == (table->flags & glh_FLAG_FROZEN) );
+    assert( glh_insert(table, "world", keys) );
+    assert( keys == glh_get(table, "help") );
+    assert( glh_destroy(table, 1, 0) );
+
+    puts("testing a failed freeze leaves an incremental grow alone");
+    table = glh_new(weak_hash_func, equal_func);
+    assert(table);
+    assert( glh_tune_incremental(table, 1) );
+    assert( glh_insert(table, "hello", keys) );
+    assert( glh_insert(table, "help", keys) );
+    /* single character keys, each with their own hash */
+    for( i=0; i < 64 && ! table->old_entries; ++i ){
+        sprintf(&keys[i * 16], "%c", (char) ('0' + i));
+        assert( glh_insert(table, &keys[i * 16], &keys[i * 16]) );
+    }
+    assert( table->old_entries );
+    n = table->old_size;
+    assert( 0 == glh_freeze(table) );
+    assert( table->old_entries );
+    assert( n == table->old_size );
+    assert( i + 2 == glh_nelems(table) );
+    assert( keys == glh_get(table, "hello") );
+    assert( keys == glh_get(table, "help") );
+    while( i-- ){
+        assert( &keys[i * 16] == glh_get(table, &keys[i * 16]) );
+    }
+    assert( glh_destroy(table, 1, 0) );
+
+    free(keys);
+
+    puts("success!");
+}
+
 int main(void){
     new_insert_get_destroy();
 
@@ -1253,6 +4781,58 @@ int main(void){
 
     artificial();
 
+    ctrl();
+
+    ctrl_group();
+
+    pow2();
+
+    find_or_insert();
+
+    hashed();
+
+    tombstones();
+
+    backshift();
+
+    robinhood();
+
+    incremental();
+
+    batch();
+
+    stats();
+
+    template();
+
+    inline_keys();
+
+    allocator();
+
+    mmap_allocator();
+
+    own_keys();
+
+    capacity();
+
+    shrink();
+
+    iter();
+
+    compact();
+
+    locked();
+
+    rcu();
+
+    sharded();
+
+    parallel();
+
+    snapshot();
+
+    freeze();
+
     puts("\noverall testing success!");
 
     return 0;